@@ -9,6 +9,7 @@
 #include <utilstrencodings.h>
 #include <crypto/common.h>
 
+#include <limits>
 #include <stdio.h>
 #include <string.h>
 
@@ -82,6 +83,30 @@ base_uint<BITS>& base_uint<BITS>::operator*=(const base_uint& b)
     return *this;
 }
 
+template <unsigned int BITS>
+base_uint<BITS>& base_uint<BITS>::operator/=(uint64_t b64)
+{
+    // Divisors wider than a word (and signed ones like the int64_t timespans in
+    // pow.cpp, which convert to this overload) take the generic long division.
+    if (b64 > std::numeric_limits<uint32_t>::max()) {
+        base_uint b;
+        b = b64;
+        return *this /= b;
+    }
+    // Schoolbook division by a single word, much faster than the bitwise
+    // long division below and with exactly the same (truncated) result.
+    const uint32_t b32 = b64;
+    if (b32 == 0)
+        throw uint_error("Division by zero");
+    uint64_t rem = 0;
+    for (int i = WIDTH - 1; i >= 0; i--) {
+        uint64_t n = (rem << 32) | pn[i];
+        pn[i] = n / b32;
+        rem = n % b32;
+    }
+    return *this;
+}
+
 template <unsigned int BITS>
 base_uint<BITS>& base_uint<BITS>::operator/=(const base_uint& b)
 {
@@ -191,6 +216,7 @@ template base_uint<256>& base_uint<256>::operator<<=(unsigned int);
 template base_uint<256>& base_uint<256>::operator>>=(unsigned int);
 template base_uint<256>& base_uint<256>::operator*=(uint32_t b32);
 template base_uint<256>& base_uint<256>::operator*=(const base_uint<256>& b);
+template base_uint<256>& base_uint<256>::operator/=(uint64_t b64);
 template base_uint<256>& base_uint<256>::operator/=(const base_uint<256>& b);
 template int base_uint<256>::CompareTo(const base_uint<256>&) const;
 template bool base_uint<256>::EqualTo(uint64_t) const;
@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 
 #include <crypto/sha256.h>
+#include <crypto/x11.h>
 #include <key.h>
 #include <stacktraces.h>
 #include <validation.h>
@@ -21,6 +22,7 @@ int
 main(int argc, char** argv)
 {
     SHA256AutoDetect();
+    X11AutoDetect();
 
     RegisterPrettySignalHandlers();
     RegisterPrettyTerminateHander();
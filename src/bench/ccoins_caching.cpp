@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 #include <coins.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <wallet/crypter.h>
 
 #include <vector>
@@ -84,4 +85,39 @@ static void CCoinsCaching(benchmark::State& state)
     }
 }
 
+// Pulls a block worth of coins from a large parent cache into a child cache, modifies some of them and flushes the
+// child back (BatchWrite), which is what ConnectBlock and FlushStateToDisk do with pcoinsTip during IBD and
+// -reindex-chainstate.
+static void CCoinsCachingFetchFlush(benchmark::State& state)
+{
+    static const size_t COIN_COUNT = 200000;
+    static const size_t COINS_PER_BLOCK = 5000;
+
+    FastRandomContext rnd(true);
+    CScript script = CScript() << OP_DUP << OP_HASH160 << rnd.randbytes(20) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    CCoinsView coinsDummy;
+    CCoinsViewCache base(&coinsDummy);
+    std::vector<COutPoint> outpoints;
+    for (size_t i = 0; i < COIN_COUNT; i++) {
+        outpoints.emplace_back(rnd.rand256(), i % 4);
+        base.AddCoin(outpoints.back(), Coin(CTxOut(1000, script), 1, false), false);
+    }
+
+    size_t pos = 0;
+    while (state.KeepRunning()) {
+        CCoinsViewCache cache(&base);
+        for (size_t i = 0; i < COINS_PER_BLOCK; i++) {
+            auto& outpoint = outpoints[pos++ % outpoints.size()];
+            Coin coin = cache.AccessCoin(outpoint);
+            if (i % 2 == 0) {
+                cache.AddCoin(outpoint, std::move(coin), true);
+            }
+        }
+        bool flushed = cache.Flush();
+        assert(flushed);
+    }
+}
+
 BENCHMARK(CCoinsCaching);
+BENCHMARK(CCoinsCachingFetchFlush);
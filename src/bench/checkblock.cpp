@@ -50,5 +50,46 @@ static void DeserializeAndCheckBlockTest(benchmark::State& state)
     }
 }
 
+// Estimated number of times a block's hash is asked for between it arriving off
+// the wire and ConnectBlock, apart from CheckBlock. This is not measured: it is
+// a count of the GetHash() call sites on that path as read from the code
+// (net_processing (2), AcceptBlockHeader, ActivateBestChain, ConnectBlock (3),
+// the deterministic MN list (2), the quorum block processor and the masternode
+// payment checks), and the real number varies with the block's contents and
+// with how often the same block is looked at again. Without the header hash
+// cache each of these, and CheckBlock's own, was a full X11 evaluation; with
+// it a block costs one.
+static const int BLOCK_HASH_QUERIES = 10;
+
+static void DeserializeCheckAndHashBlockTest(benchmark::State& state)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << chainParams->GenesisBlock();
+    const size_t nBlockSize = stream.size();
+    char a = '\0';
+    stream.write(&a, 1); // Prevent compaction
+
+    uint64_t nBlocks = 0;
+    const uint64_t nHashCount = GetBlockHeaderHashCount();
+    while (state.KeepRunning()) {
+        CBlock block;
+        stream >> block;
+        assert(stream.Rewind(nBlockSize));
+
+        CValidationState validationState;
+        assert(CheckBlock(block, validationState, chainParams->GetConsensus()));
+        for (int i = 0; i < BLOCK_HASH_QUERIES; i++) {
+            assert(block.GetHash() == chainParams->GetConsensus().hashGenesisBlock);
+        }
+        nBlocks++;
+    }
+    // at most one X11 evaluation per block, down from BLOCK_HASH_QUERIES + 1 (the same block is replayed, so all
+    // but the first one find the hash in the cache)
+    assert(GetBlockHeaderHashCount() - nHashCount <= nBlocks);
+}
+
 BENCHMARK(DeserializeBlockTest);
 BENCHMARK(DeserializeAndCheckBlockTest);
+BENCHMARK(DeserializeCheckAndHashBlockTest);
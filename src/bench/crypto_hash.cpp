@@ -217,6 +217,14 @@ static void HASH_X11_2048b_single(benchmark::State& state)
         hash = HashX11(in.begin(), in.end());
 }
 
+static void HASH_X11_0176b_8way(benchmark::State& state)
+{
+    std::vector<uint8_t> in(176 * 8, 0);
+    std::vector<uint8_t> out(32 * 8);
+    while (state.KeepRunning())
+        HashX11xN(out.data(), in.data(), 176, 8);
+}
+
 BENCHMARK(HASH_RIPEMD160);
 BENCHMARK(HASH_SHA1);
 BENCHMARK(HASH_SHA256);
@@ -241,5 +249,6 @@ BENCHMARK(HASH_X11_0128b_single);
 BENCHMARK(HASH_X11_0512b_single);
 BENCHMARK(HASH_X11_1024b_single);
 BENCHMARK(HASH_X11_2048b_single);
+BENCHMARK(HASH_X11_0176b_8way);
 BENCHMARK(FastRandom_32bit);
 BENCHMARK(FastRandom_1bit);
@@ -0,0 +1,117 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <dbwrapper.h>
+#include <random.h>
+
+// Mimics the evodb usage during block processing: keys are a short string prefix plus a hash and values are diffs,
+// commitments and similar objects of a few hundred bytes. Each block writes to a fresh current transaction which is
+// then committed into the long-living root transaction.
+static const size_t WRITES_PER_BLOCK = 200;
+static const size_t BLOCKS_PER_FLUSH = 100;
+
+typedef std::pair<std::string, uint256> Key;
+
+static std::vector<Key> MakeKeys(FastRandomContext& rnd, size_t count)
+{
+    static const std::string prefixes[] = {"dmn_D3", "dmn_S3", "q_mc", "q_mcih", "is_i"};
+    std::vector<Key> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        keys.emplace_back(prefixes[i % 5], rnd.rand256());
+    }
+    return keys;
+}
+
+template <template <typename, typename> class Transaction>
+struct EvoDBLike
+{
+    typedef Transaction<CDBWrapper, CDBBatch> RootTransaction;
+    typedef Transaction<RootTransaction, RootTransaction> CurTransaction;
+
+    CDBWrapper db{fs::path(), 1 << 20, true};
+    CDBBatch rootBatch{db};
+    RootTransaction rootTransaction{db, rootBatch};
+    CurTransaction curTransaction{rootTransaction, rootTransaction};
+};
+
+template <template <typename, typename> class Transaction>
+static void DBTransactionWrite(benchmark::State& state)
+{
+    FastRandomContext rnd(true);
+    auto keys = MakeKeys(rnd, WRITES_PER_BLOCK);
+    std::vector<unsigned char> value(300);
+
+    EvoDBLike<Transaction> evoDb;
+    while (state.KeepRunning()) {
+        for (auto& k : keys) {
+            evoDb.curTransaction.Write(k, value);
+        }
+        evoDb.curTransaction.Clear();
+    }
+}
+
+template <template <typename, typename> class Transaction>
+static void DBTransactionRead(benchmark::State& state)
+{
+    FastRandomContext rnd(true);
+    auto keys = MakeKeys(rnd, WRITES_PER_BLOCK * BLOCKS_PER_FLUSH);
+    std::vector<unsigned char> value(300);
+
+    // most reads are served by the root transaction, some by the current one
+    EvoDBLike<Transaction> evoDb;
+    for (size_t i = 0; i < keys.size(); i++) {
+        evoDb.curTransaction.Write(keys[i], value);
+        if (i < keys.size() - WRITES_PER_BLOCK) {
+            evoDb.curTransaction.Commit();
+        }
+    }
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        for (size_t j = 0; j < WRITES_PER_BLOCK; j++) {
+            bool ok = evoDb.curTransaction.Read(keys[i++ % keys.size()], value);
+            assert(ok);
+        }
+    }
+}
+
+template <template <typename, typename> class Transaction>
+static void DBTransactionCommit(benchmark::State& state)
+{
+    FastRandomContext rnd(true);
+    std::vector<std::vector<Key>> blocks;
+    for (size_t i = 0; i < BLOCKS_PER_FLUSH; i++) {
+        blocks.emplace_back(MakeKeys(rnd, WRITES_PER_BLOCK));
+    }
+    std::vector<unsigned char> value(300);
+
+    EvoDBLike<Transaction> evoDb;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        for (auto& k : blocks[i % blocks.size()]) {
+            evoDb.curTransaction.Write(k, value);
+        }
+        evoDb.curTransaction.Commit();
+        if (++i % BLOCKS_PER_FLUSH == 0) {
+            evoDb.rootTransaction.Commit();
+            evoDb.rootBatch.Clear();
+        }
+    }
+}
+
+static void DBTransaction_Write_Map(benchmark::State& state) { DBTransactionWrite<CDBTransaction>(state); }
+static void DBTransaction_Write_Flat(benchmark::State& state) { DBTransactionWrite<CDBFlatTransaction>(state); }
+static void DBTransaction_Read_Map(benchmark::State& state) { DBTransactionRead<CDBTransaction>(state); }
+static void DBTransaction_Read_Flat(benchmark::State& state) { DBTransactionRead<CDBFlatTransaction>(state); }
+static void DBTransaction_Commit_Map(benchmark::State& state) { DBTransactionCommit<CDBTransaction>(state); }
+static void DBTransaction_Commit_Flat(benchmark::State& state) { DBTransactionCommit<CDBFlatTransaction>(state); }
+
+BENCHMARK(DBTransaction_Write_Map);
+BENCHMARK(DBTransaction_Write_Flat);
+BENCHMARK(DBTransaction_Read_Map);
+BENCHMARK(DBTransaction_Read_Flat);
+BENCHMARK(DBTransaction_Commit_Map);
+BENCHMARK(DBTransaction_Commit_Flat);
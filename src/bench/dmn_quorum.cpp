@@ -0,0 +1,51 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <evo/deterministicmns.h>
+#include <random.h>
+
+static CDeterministicMNList BuildMNList(size_t count)
+{
+    FastRandomContext rnd(true);
+
+    CDeterministicMNList mnList(uint256(), 0, 0);
+    for (size_t i = 0; i < count; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>(i);
+        dmn->proTxHash = rnd.rand256();
+        dmn->collateralOutpoint = COutPoint(rnd.rand256(), 0);
+        auto dmnState = std::make_shared<CDeterministicMNState>();
+        std::vector<unsigned char> keyId = rnd.randbytes(20);
+        dmnState->keyIDOwner = CKeyID(uint160(keyId));
+        dmnState->UpdateConfirmedHash(dmn->proTxHash, rnd.rand256());
+        dmn->pdmnState = dmnState;
+        mnList.AddMN(dmn);
+    }
+    return mnList;
+}
+
+static void CalculateQuorum(benchmark::State& state, size_t mnCount, size_t quorumSize)
+{
+    auto mnList = BuildMNList(mnCount);
+    FastRandomContext rnd(true);
+
+    while (state.KeepRunning()) {
+        auto members = mnList.CalculateQuorum(quorumSize, rnd.rand256());
+        assert(members.size() == quorumSize);
+    }
+}
+
+static void DMN_CalculateQuorum_5000_50(benchmark::State& state) { CalculateQuorum(state, 5000, 50); }
+static void DMN_CalculateQuorum_5000_400(benchmark::State& state) { CalculateQuorum(state, 5000, 400); }
+static void DMN_CalculateQuorum_10000_50(benchmark::State& state) { CalculateQuorum(state, 10000, 50); }
+static void DMN_CalculateQuorum_10000_400(benchmark::State& state) { CalculateQuorum(state, 10000, 400); }
+static void DMN_CalculateQuorum_50000_50(benchmark::State& state) { CalculateQuorum(state, 50000, 50); }
+static void DMN_CalculateQuorum_50000_400(benchmark::State& state) { CalculateQuorum(state, 50000, 400); }
+
+BENCHMARK(DMN_CalculateQuorum_5000_50);
+BENCHMARK(DMN_CalculateQuorum_5000_400);
+BENCHMARK(DMN_CalculateQuorum_10000_50);
+BENCHMARK(DMN_CalculateQuorum_10000_400);
+BENCHMARK(DMN_CalculateQuorum_50000_50);
+BENCHMARK(DMN_CalculateQuorum_50000_400);
@@ -0,0 +1,53 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <net_processing.h>
+#include <random.h>
+#include <txmempool.h>
+#include <utiltime.h>
+
+// Mimics the transaction trickle of a busy node: every peer has the same backlog of transactions queued for
+// announcement and picks the best ones in mempool order, up to the per trickle limit. The remaining ones are
+// dropped, so that every iteration starts with full queues again.
+static const size_t PEER_COUNT = 200;
+static const size_t MEMPOOL_TX_COUNT = 5000;
+static const size_t QUEUED_TX_COUNT = 1000;
+static const size_t MAX_ANNOUNCED_TX_COUNT = 280;
+
+static void InvRelayTrickle(benchmark::State& state)
+{
+    FastRandomContext rnd(true);
+    CTxMemPool pool;
+    LockPoints lp;
+    std::vector<uint256> vHashes;
+    for (size_t i = 0; i < MEMPOOL_TX_COUNT; i++) {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(COutPoint(rnd.rand256(), 0));
+        tx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+        CTransactionRef ptx = MakeTransactionRef(tx);
+        pool.addUnchecked(ptx->GetHash(), CTxMemPoolEntry(ptx, 100 + rnd.randrange(10000), 0, 1, false, 1, lp));
+        vHashes.emplace_back(ptx->GetHash());
+    }
+
+    std::vector<std::vector<uint256>> vQueues(PEER_COUNT);
+    CTxRelayOrder txRelayOrder;
+    size_t nAnnounced = 0;
+    while (state.KeepRunning()) {
+        for (auto& vQueue : vQueues) {
+            // RelayTransaction queues the same txs for all peers
+            vQueue.assign(vHashes.begin(), vHashes.begin() + QUEUED_TX_COUNT);
+        }
+        LOCK(pool.cs);
+        for (auto& vQueue : vQueues) {
+            txRelayOrder.Select(pool, vQueue, MAX_ANNOUNCED_TX_COUNT, GetTime<std::chrono::microseconds>(), [&](const CTransactionRef& tx) {
+                nAnnounced++;
+                return true;
+            });
+        }
+    }
+    assert(nAnnounced % MAX_ANNOUNCED_TX_COUNT == 0);
+}
+
+BENCHMARK(InvRelayTrickle);
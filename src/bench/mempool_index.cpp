@@ -0,0 +1,72 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <random.h>
+#include <script/standard.h>
+#include <txmempool.h>
+
+// Mimics a node running with -addressindex -spentindex: every transaction accepted to the mempool is also added to
+// the address and spent indexes, explorers query them and the transactions are removed again when they get mined.
+static const size_t TX_COUNT = 2000;
+static const size_t ADDRESS_COUNT = 500;
+
+static void MempoolAddressSpentIndex(benchmark::State& state)
+{
+    FastRandomContext rnd(true);
+
+    std::vector<CKeyID> addresses;
+    for (size_t i = 0; i < ADDRESS_COUNT; i++) {
+        addresses.emplace_back(uint160(rnd.randbytes(20)));
+    }
+
+    CCoinsView viewDummy;
+    CCoinsViewCache view(&viewDummy);
+    std::vector<CTransactionRef> txs;
+    for (size_t i = 0; i < TX_COUNT; i++) {
+        CMutableTransaction tx;
+        for (size_t j = 0; j < 2; j++) {
+            COutPoint prevout(rnd.rand256(), j);
+            view.AddCoin(prevout, Coin(CTxOut(COIN, GetScriptForDestination(addresses[rnd.randrange(ADDRESS_COUNT)])), 1, false), false);
+            tx.vin.emplace_back(prevout);
+        }
+        for (size_t j = 0; j < 2; j++) {
+            tx.vout.emplace_back(COIN - 1000, GetScriptForDestination(addresses[rnd.randrange(ADDRESS_COUNT)]));
+        }
+        txs.emplace_back(MakeTransactionRef(tx));
+    }
+
+    CTxMemPool pool;
+    LockPoints lp;
+    std::vector<std::pair<uint160, int>> queryAddresses;
+    for (size_t i = 0; i < 10; i++) {
+        queryAddresses.emplace_back(addresses[i], 1);
+    }
+
+    while (state.KeepRunning()) {
+        for (auto& tx : txs) {
+            CTxMemPoolEntry entry(tx, 1000, 0, 1, false, 4, lp);
+            pool.addUnchecked(tx->GetHash(), entry);
+            pool.addAddressIndex(entry, view);
+            pool.addSpentIndex(entry, view);
+        }
+
+        std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>> deltas;
+        pool.getAddressIndex(queryAddresses, deltas);
+        assert(!deltas.empty());
+        for (auto& tx : txs) {
+            CSpentIndexKey key(tx->vin[0].prevout.hash, tx->vin[0].prevout.n);
+            CSpentIndexValue value;
+            bool found = pool.getSpentIndex(key, value);
+            assert(found);
+        }
+
+        for (auto& tx : txs) {
+            pool.removeRecursive(*tx);
+        }
+    }
+}
+
+BENCHMARK(MempoolAddressSpentIndex);
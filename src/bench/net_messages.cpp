@@ -0,0 +1,50 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <net.h>
+#include <netmessagemaker.h>
+
+// Splits a stream of transaction sized messages into CNetMessages like CNode::ReceiveMsgBytes does, reading from the
+// socket in 64 KiB chunks, and drops them again like the message handler does after processing them.
+static const size_t MSG_COUNT = 1000;
+static const size_t MSG_SIZE = 250;
+static const size_t RECV_CHUNK_SIZE = 64 * 1024;
+
+static void NetMessageReceive(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    std::vector<unsigned char> stream;
+    for (size_t i = 0; i < MSG_COUNT; i++) {
+        CSerializedNetMsg msg;
+        msg.command = NetMsgType::TX;
+        msg.data.assign(MSG_SIZE, (unsigned char)i);
+        CSendMsgBufferRef buf = MakeSendMsgBuffer(std::move(msg));
+        stream.insert(stream.end(), buf->header.begin(), buf->header.end());
+        stream.insert(stream.end(), buf->data.begin(), buf->data.end());
+    }
+
+    std::list<CNetMessage> msgs;
+    while (state.KeepRunning()) {
+        for (size_t nPos = 0; nPos < stream.size(); nPos += RECV_CHUNK_SIZE) {
+            const char* pch = (const char*)stream.data() + nPos;
+            int nBytes = std::min(RECV_CHUNK_SIZE, stream.size() - nPos);
+            while (nBytes > 0) {
+                if (msgs.empty() || msgs.back().complete()) {
+                    msgs.emplace_back(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+                }
+                CNetMessage& msg = msgs.back();
+                int handled = msg.in_data ? msg.readData(pch, nBytes) : msg.readHeader(pch, nBytes);
+                assert(handled > 0);
+                pch += handled;
+                nBytes -= handled;
+            }
+        }
+        assert(msgs.size() == MSG_COUNT && msgs.back().complete());
+        msgs.clear();
+    }
+}
+
+BENCHMARK(NetMessageReceive);
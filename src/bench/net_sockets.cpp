@@ -0,0 +1,159 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <net.h>
+#include <netbase.h>
+#include <netmessagemaker.h>
+#include <scheduler.h>
+#include <util.h>
+
+#ifdef USE_EPOLL
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+
+// Connects thousands of loopback peers to a CConnman and lets all of them send a PING at the same time. The message
+// handler answers each one with a PONG and an iteration ends when every peer got its answer, so the time per iteration
+// is the round trip latency under load and PEER_COUNT * 2 / time is the number of messages per second.
+static const int PEER_COUNT = 2000;
+
+class PongMsgProc : public NetEventsInterface
+{
+public:
+    CConnman* connman{nullptr};
+
+    bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) override
+    {
+        std::list<CNetMessage> msgs;
+        {
+            LOCK(pnode->cs_vProcessMsg);
+            msgs.swap(pnode->vProcessMsg);
+            pnode->nProcessQueueSize = 0;
+            pnode->fPauseRecv = false;
+        }
+        const CNetMsgMaker msgMaker(INIT_PROTO_VERSION);
+        for (auto& msg : msgs) {
+            uint64_t nonce;
+            msg.vRecv >> nonce;
+            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::PONG, nonce));
+        }
+        return false;
+    }
+    bool SendMessages(CNode* pnode, std::atomic<bool>& interrupt) override { return true; }
+    bool IsConcurrentMessage(const std::string& strCommand) const override { return false; }
+    bool ProcessConcurrentMessage(CNode* pnode, std::atomic<bool>& interrupt) override { return false; }
+    void InitializeNode(CNode* pnode) override {}
+    void FinalizeNode(NodeId id, bool& update_connection_time) override {}
+};
+
+static void NetSocketsPingPong(benchmark::State& state, int nSocketThreads)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    fs::path pathTemp = fs::temp_directory_path() / fs::unique_path("bench_zenx_%%%%%%%%");
+    fs::create_directories(pathTemp);
+    gArgs.ForceSetArg("-datadir", pathTemp.string());
+    gArgs.ForceSetArg("-dnsseed", "0");
+    ClearDatadirCache();
+
+    // two sockets per peer
+    int nPeers = std::min(PEER_COUNT, (RaiseFileDescriptorLimit(2 * PEER_COUNT + 200) - 200) / 2);
+
+    // let the OS pick a free port
+    SOCKET hProbe = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in sockaddr{};
+    sockaddr.sin_family = AF_INET;
+    sockaddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(sockaddr);
+    bool fProbed = bind(hProbe, (struct sockaddr*)&sockaddr, len) == 0 && getsockname(hProbe, (struct sockaddr*)&sockaddr, &len) == 0;
+    assert(fProbed);
+    CloseSocket(hProbe);
+
+    PongMsgProc msgProc;
+    CConnman connman(0x1337, 0x1337);
+    msgProc.connman = &connman;
+    CScheduler scheduler;
+
+    CConnman::Options options;
+    options.nMaxConnections = nPeers + 10;
+    options.nMaxAddnode = MAX_ADDNODE_CONNECTIONS;
+    options.m_msgproc = &msgProc;
+    options.nSendBufferMaxSize = 1000 * DEFAULT_MAXSENDBUFFER;
+    options.nReceiveFloodSize = 1000 * DEFAULT_MAXRECEIVEBUFFER;
+    options.vWhiteBinds.emplace_back(CService(CNetAddr(sockaddr.sin_addr), ntohs(sockaddr.sin_port)));
+    options.m_use_addrman_outgoing = false;
+    options.socketEventsMode = CConnman::SOCKETEVENTS_EPOLL;
+    options.nSocketThreads = nSocketThreads;
+    bool fStarted = connman.Start(scheduler, options);
+    assert(fStarted);
+
+    int clientEpollfd = epoll_create1(0);
+    std::vector<SOCKET> vClients;
+    for (int i = 0; i < nPeers; i++) {
+        SOCKET hSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        bool fConnected = connect(hSocket, (struct sockaddr*)&sockaddr, sizeof(sockaddr)) == 0;
+        assert(fConnected);
+        SetSocketNoDelay(hSocket);
+        fcntl(hSocket, F_SETFL, fcntl(hSocket, F_GETFL, 0) | O_NONBLOCK);
+        epoll_event e;
+        e.events = EPOLLIN;
+        e.data.fd = hSocket;
+        epoll_ctl(clientEpollfd, EPOLL_CTL_ADD, hSocket, &e);
+        vClients.emplace_back(hSocket);
+        // don't overflow the listen backlog
+        while (i % 100 == 99 && connman.GetNodeCount(CConnman::CONNECTIONS_IN) < (size_t)i + 1) {
+            MilliSleep(1);
+        }
+    }
+    while (connman.GetNodeCount(CConnman::CONNECTIONS_IN) < (size_t)nPeers) {
+        MilliSleep(1);
+    }
+
+    CSendMsgBufferRef ping = MakeSendMsgBuffer(CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::PING, (uint64_t)0));
+    std::vector<unsigned char> vPing(ping->header.begin(), ping->header.end());
+    vPing.insert(vPing.end(), ping->data.begin(), ping->data.end());
+    // a PONG has the same size as a PING
+    size_t nExpected = 0;
+    size_t nReceived = 0;
+
+    const size_t maxEvents = 256;
+    epoll_event events[maxEvents];
+    unsigned char buf[4096];
+    while (state.KeepRunning()) {
+        for (SOCKET hSocket : vClients) {
+            ssize_t nBytes = send(hSocket, vPing.data(), vPing.size(), MSG_NOSIGNAL);
+            assert(nBytes == (ssize_t)vPing.size());
+        }
+        nExpected += vClients.size() * vPing.size();
+        while (nReceived < nExpected) {
+            int n = epoll_wait(clientEpollfd, events, maxEvents, 1000);
+            assert(n > 0);
+            for (int i = 0; i < n; i++) {
+                ssize_t nBytes;
+                while ((nBytes = recv(events[i].data.fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+                    nReceived += nBytes;
+                }
+            }
+        }
+    }
+
+    for (SOCKET hSocket : vClients) {
+        CloseSocket(hSocket);
+    }
+    close(clientEpollfd);
+    connman.Interrupt();
+    connman.Stop();
+    fs::remove_all(pathTemp);
+    gArgs.ForceSetArg("-datadir", "");
+    ClearDatadirCache();
+}
+
+static void NetSocketsPingPong_NetworkThread(benchmark::State& state) { NetSocketsPingPong(state, 0); }
+static void NetSocketsPingPong_4SocketThreads(benchmark::State& state) { NetSocketsPingPong(state, 4); }
+
+BENCHMARK(NetSocketsPingPong_NetworkThread);
+BENCHMARK(NetSocketsPingPong_4SocketThreads);
+
+#endif // USE_EPOLL
@@ -0,0 +1,94 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <policy/fees.h>
+#include <random.h>
+#include <txmempool.h>
+
+#include <map>
+
+// Replays a deterministic block/mempool trace: every block interval a batch of txs with random fees enters the
+// mempool and miners pick the best paying ones for the next block, so low fee txs wait for several blocks. The last
+// block of the trace empties the mempool, which allows replaying the trace over and over at increasing heights.
+static const size_t TRACE_BLOCKS = 100;
+static const size_t TXS_PER_BLOCK = 200;
+static const size_t BLOCK_TXS = 180;
+
+struct TraceBlock
+{
+    std::vector<std::pair<CTransactionRef, CAmount>> accepted;
+    std::vector<CTransactionRef> mined;
+};
+
+static std::vector<TraceBlock> MakeTrace()
+{
+    FastRandomContext rnd(true);
+    std::vector<TraceBlock> trace(TRACE_BLOCKS);
+    // all txs have the same size, so ordering by fee is ordering by feerate
+    std::multimap<CAmount, CTransactionRef> waiting;
+    for (size_t i = 0; i < TRACE_BLOCKS; i++) {
+        for (size_t j = 0; j < TXS_PER_BLOCK; j++) {
+            CMutableTransaction tx;
+            tx.vin.emplace_back(COutPoint(rnd.rand256(), 0));
+            tx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+            CAmount nFee = 100 + rnd.randrange(10000);
+            CTransactionRef ptx = MakeTransactionRef(tx);
+            trace[i].accepted.emplace_back(ptx, nFee);
+            waiting.emplace(nFee, ptx);
+        }
+        size_t nMined = i + 1 == TRACE_BLOCKS ? waiting.size() : std::min(BLOCK_TXS, waiting.size());
+        for (size_t j = 0; j < nMined; j++) {
+            auto it = std::prev(waiting.end());
+            trace[i].mined.emplace_back(it->second);
+            waiting.erase(it);
+        }
+    }
+    return trace;
+}
+
+// Feeds the estimator like CTxMemPool::addUnchecked and the BlockConnected callback do
+static void ReplayBlock(const TraceBlock& block, CBlockPolicyEstimator& feeEst, unsigned int& nHeight)
+{
+    LockPoints lp;
+    for (const auto& p : block.accepted) {
+        feeEst.processTransaction(CTxMemPoolEntry(p.first, p.second, 0, nHeight, false, 1, lp), true);
+    }
+    feeEst.processBlock(++nHeight, block.mined);
+}
+
+static void PolicyEstimatorProcessBlock(benchmark::State& state)
+{
+    auto trace = MakeTrace();
+    CBlockPolicyEstimator feeEst;
+    unsigned int nHeight = 0;
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        ReplayBlock(trace[i++ % trace.size()], feeEst, nHeight);
+    }
+}
+
+static void PolicyEstimatorSmartFee(benchmark::State& state)
+{
+    auto trace = MakeTrace();
+    CBlockPolicyEstimator feeEst;
+    unsigned int nHeight = 0;
+    for (size_t i = 0; i < 3 * trace.size(); i++) {
+        ReplayBlock(trace[i % trace.size()], feeEst, nHeight);
+    }
+
+    // the targets wallets and RPC clients usually ask for
+    static const int targets[] = {1, 2, 3, 6, 12, 24, 48, 144, 504, 1008};
+    while (state.KeepRunning()) {
+        for (int confTarget : targets) {
+            FeeCalculation feeCalc;
+            feeEst.estimateSmartFee(confTarget, &feeCalc, true);
+            feeEst.estimateSmartFee(confTarget, &feeCalc, false);
+        }
+    }
+}
+
+BENCHMARK(PolicyEstimatorProcessBlock);
+BENCHMARK(PolicyEstimatorSmartFee);
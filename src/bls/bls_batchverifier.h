@@ -97,29 +97,59 @@ public:
                 badSources.emplace(p.first);
 
                 if (perMessageFallback) {
-                    // revert to per-message verification
-                    if (p.second.size() == 1) {
-                        // no need to re-verify a single message
-                        badMessages.emplace(p.second[0]->second.msgId);
-                    } else {
-                        for (const auto& msgIt : p.second) {
-                            if (badMessages.count(msgIt->first)) {
-                                // same message might be invalid from different source, so no need to re-verify it
-                                continue;
-                            }
-
-                            const auto& msg = msgIt->second;
-                            if (!msg.sig.VerifyInsecure(msg.pubKey, msg.msgHash)) {
-                                badMessages.emplace(msg.msgId);
-                            }
+                    // find the invalid messages of this source
+                    std::vector<MessageMapIterator> msgIts;
+                    msgIts.reserve(p.second.size());
+                    for (const auto& msgIt : p.second) {
+                        // same message might be invalid from different source, so no need to re-verify it
+                        if (!badMessages.count(msgIt->first)) {
+                            msgIts.emplace_back(msgIt);
                         }
                     }
+                    if (msgIts.size() == p.second.size()) {
+                        // we already know that at least one message is invalid
+                        BisectBadMessages(msgIts, 0, msgIts.size());
+                    } else if (!msgIts.empty() && !VerifyRange(msgIts, 0, msgIts.size())) {
+                        BisectBadMessages(msgIts, 0, msgIts.size());
+                    }
                 }
             }
         }
     }
 
 private:
+    // Verifies [start, start+count) of msgIts as one batch
+    bool VerifyRange(const std::vector<MessageMapIterator>& msgIts, size_t start, size_t count)
+    {
+        std::map<uint256, std::vector<MessageMapIterator>> byMessageHash;
+        for (size_t i = start; i < start + count; i++) {
+            byMessageHash[msgIts[i]->second.msgHash].emplace_back(msgIts[i]);
+        }
+        return VerifyBatch(byMessageHash);
+    }
+
+    // [start, start+count) of msgIts is known to contain at least one invalid message. Splits the range into halves
+    // and only descends into the invalid halves, which finds k invalid messages out of n with O(k*log(n)) batch
+    // verifications instead of n individual verifications
+    void BisectBadMessages(const std::vector<MessageMapIterator>& msgIts, size_t start, size_t count)
+    {
+        if (count == 1) {
+            badMessages.emplace(msgIts[start]->first);
+            return;
+        }
+
+        size_t half = count / 2;
+        if (VerifyRange(msgIts, start, half)) {
+            // first half is valid, so the invalid message(s) must be in the second half
+            BisectBadMessages(msgIts, start + half, count - half);
+            return;
+        }
+        BisectBadMessages(msgIts, start, half);
+        if (!VerifyRange(msgIts, start + half, count - half)) {
+            BisectBadMessages(msgIts, start + half, count - half);
+        }
+    }
+
     // All Verify methods take ownership of the passed byMessageHash map and thus might modify the map. This is to avoid
     // unnecessary copies
 
@@ -887,6 +887,13 @@ bool CBLSWorker::IsAsyncVerifyInProgress()
     return sigVerifyBatchesInProgress != 0;
 }
 
+std::future<void> CBLSWorker::AsyncRun(std::function<void()> job)
+{
+    return workerPool.push([job](int threadId) {
+        job();
+    });
+}
+
 // sigVerifyMutex must be held while calling
 void CBLSWorker::PushSigVerifyBatch()
 {
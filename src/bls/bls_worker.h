@@ -139,6 +139,9 @@ public:
     std::future<bool> AsyncVerifySig(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& msgHash, CancelCond cancelCond = [] { return false; });
     bool IsAsyncVerifyInProgress();
 
+    // Runs an arbitrary job on the worker pool, e.g. verification of independent batches
+    std::future<void> AsyncRun(std::function<void()> job);
+
 private:
     void PushSigVerifyBatch();
 };
@@ -11,6 +11,7 @@ bool CCoinsView::GetCoin(const COutPoint &outpoint, Coin &coin) const { return f
 uint256 CCoinsView::GetBestBlock() const { return uint256(); }
 std::vector<uint256> CCoinsView::GetHeadBlocks() const { return std::vector<uint256>(); }
 bool CCoinsView::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) { return false; }
+bool CCoinsView::BatchWritePartial(CCoinsMap &mapCoins, const uint256 &hashBlock) { return false; }
 CCoinsViewCursor *CCoinsView::Cursor() const { return nullptr; }
 
 bool CCoinsView::HaveCoin(const COutPoint &outpoint) const
@@ -26,12 +27,48 @@ uint256 CCoinsViewBacked::GetBestBlock() const { return base->GetBestBlock(); }
 std::vector<uint256> CCoinsViewBacked::GetHeadBlocks() const { return base->GetHeadBlocks(); }
 void CCoinsViewBacked::SetBackend(CCoinsView &viewIn) { base = &viewIn; }
 bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) { return base->BatchWrite(mapCoins, hashBlock); }
+bool CCoinsViewBacked::BatchWritePartial(CCoinsMap &mapCoins, const uint256 &hashBlock) { return base->BatchWritePartial(mapCoins, hashBlock); }
 CCoinsViewCursor *CCoinsViewBacked::Cursor() const { return base->Cursor(); }
 size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
 
 SaltedOutpointHasher::SaltedOutpointHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) :
+    CCoinsViewBacked(baseIn),
+    cacheCoins(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &cacheCoinsMemoryResource),
+    cachedCoinsUsage(0)
+{
+    ResetDirty();
+}
+
+void CCoinsViewCache::LinkDirty(CCoinsMap::value_type& entry)
+{
+    if (entry.second.pNextDirty) {
+        return;
+    }
+    CCoinsMap::value_type* pLast = dirtySentinel.second.pPrevDirty;
+    entry.second.pPrevDirty = pLast;
+    entry.second.pNextDirty = &dirtySentinel;
+    pLast->second.pNextDirty = &entry;
+    dirtySentinel.second.pPrevDirty = &entry;
+}
+
+void CCoinsViewCache::UnlinkDirty(CCoinsMap::value_type& entry)
+{
+    if (!entry.second.pNextDirty) {
+        return;
+    }
+    entry.second.pPrevDirty->second.pNextDirty = entry.second.pNextDirty;
+    entry.second.pNextDirty->second.pPrevDirty = entry.second.pPrevDirty;
+    entry.second.pPrevDirty = nullptr;
+    entry.second.pNextDirty = nullptr;
+}
+
+void CCoinsViewCache::ResetDirty()
+{
+    dirtySentinel.second.pPrevDirty = &dirtySentinel;
+    dirtySentinel.second.pNextDirty = &dirtySentinel;
+}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
     return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
@@ -81,9 +118,21 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
     }
     it->second.coin = std::move(coin);
     it->second.flags |= CCoinsCacheEntry::DIRTY | (fresh ? CCoinsCacheEntry::FRESH : 0);
+    LinkDirty(*it);
     cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
 }
 
+bool CCoinsViewCache::AddFetchedCoin(const COutPoint& outpoint, Coin&& coin) {
+    assert(!coin.IsSpent());
+    CCoinsMap::iterator it;
+    bool inserted;
+    std::tie(it, inserted) = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(coin)));
+    if (inserted) {
+        cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+    }
+    return inserted;
+}
+
 void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight, bool check) {
     bool fCoinbase = tx.IsCoinBase();
     const uint256& txid = tx.GetHash();
@@ -103,9 +152,11 @@ bool CCoinsViewCache::SpendCoin(const COutPoint &outpoint, Coin* moveout) {
         *moveout = std::move(it->second.coin);
     }
     if (it->second.flags & CCoinsCacheEntry::FRESH) {
+        UnlinkDirty(*it);
         cacheCoins.erase(it);
     } else {
         it->second.flags |= CCoinsCacheEntry::DIRTY;
+        LinkDirty(*it);
         it->second.coin.Clear();
     }
     return true;
@@ -155,7 +206,8 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
             if (!(it->second.flags & CCoinsCacheEntry::FRESH && it->second.coin.IsSpent())) {
                 // Otherwise we will need to create it in the parent
                 // and move the data up and mark it as dirty
-                CCoinsCacheEntry& entry = cacheCoins[it->first];
+                CCoinsMap::iterator itNew = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(it->first), std::tuple<>()).first;
+                CCoinsCacheEntry& entry = itNew->second;
                 entry.coin = std::move(it->second.coin);
                 cachedCoinsUsage += entry.coin.DynamicMemoryUsage();
                 entry.flags = CCoinsCacheEntry::DIRTY;
@@ -165,6 +217,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
                 if (it->second.flags & CCoinsCacheEntry::FRESH) {
                     entry.flags |= CCoinsCacheEntry::FRESH;
                 }
+                LinkDirty(*itNew);
             }
         } else {
             // Assert that the child cache entry was not marked FRESH if the
@@ -181,6 +234,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
                 // modified and being pruned. This means we can just delete
                 // it from the parent.
                 cachedCoinsUsage -= itUs->second.coin.DynamicMemoryUsage();
+                UnlinkDirty(*itUs);
                 cacheCoins.erase(itUs);
             } else {
                 // A normal modification.
@@ -188,6 +242,7 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
                 itUs->second.coin = std::move(it->second.coin);
                 cachedCoinsUsage += itUs->second.coin.DynamicMemoryUsage();
                 itUs->second.flags |= CCoinsCacheEntry::DIRTY;
+                LinkDirty(*itUs);
                 // NOTE: It is possible the child has a FRESH flag here in
                 // the event the entry we found in the parent is pruned. But
                 // we must not copy that FRESH flag to the parent as that
@@ -200,13 +255,80 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
     return true;
 }
 
+bool CCoinsViewCache::BatchWritePartial(CCoinsMap &mapCoins, const uint256 &hashBlockIn) {
+    // A cache has no durable state, so merging the entries without moving on to hashBlockIn is all there is to do
+    uint256 hashBlockOld = hashBlock;
+    bool ret = BatchWrite(mapCoins, hashBlockIn);
+    hashBlock = hashBlockOld;
+    return ret;
+}
+
 bool CCoinsViewCache::Flush() {
     bool fOk = base->BatchWrite(cacheCoins, hashBlock);
     cacheCoins.clear();
+    ResetDirty();
     cachedCoinsUsage = 0;
+    ReallocateCache();
     return fOk;
 }
 
+bool CCoinsViewCache::WriteDirtyEntries(size_t nMaxEntries, size_t& nWritten)
+{
+    nWritten = 0;
+
+    CCoinsMapMemoryResource resource;
+    CCoinsMap mapDirty(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource);
+    std::vector<CCoinsMap::value_type*> vDirty;
+    for (CCoinsMap::value_type* p = dirtySentinel.second.pNextDirty; p != &dirtySentinel && vDirty.size() < nMaxEntries; p = p->second.pNextDirty) {
+        mapDirty.emplace(p->first, p->second);
+        vDirty.emplace_back(p);
+    }
+    if (vDirty.empty()) {
+        return true;
+    }
+
+    if (!base->BatchWritePartial(mapDirty, GetBestBlock())) {
+        return false;
+    }
+    for (CCoinsMap::value_type* p : vDirty) {
+        UnlinkDirty(*p);
+        if (p->second.coin.IsSpent()) {
+            cachedCoinsUsage -= p->second.coin.DynamicMemoryUsage();
+            cacheCoins.erase(cacheCoins.find(p->first));
+        } else {
+            p->second.flags = 0;
+        }
+    }
+    nWritten = vDirty.size();
+    return true;
+}
+
+bool CCoinsViewCache::Sync(size_t nBatchEntries, size_t& nWritten)
+{
+    nWritten = 0;
+    size_t nBatchWritten;
+    do {
+        if (!WriteDirtyEntries(nBatchEntries, nBatchWritten)) {
+            return false;
+        }
+        nWritten += nBatchWritten;
+    } while (nBatchWritten == nBatchEntries);
+
+    // all modifications are in the base now, let it know that it's consistent with our best block again
+    CCoinsMapMemoryResource resource;
+    CCoinsMap mapEmpty(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource);
+    return base->BatchWrite(mapEmpty, GetBestBlock());
+}
+
+void CCoinsViewCache::ReallocateCache()
+{
+    assert(cacheCoins.empty());
+    cacheCoins.~CCoinsMap();
+    cacheCoinsMemoryResource.~CCoinsMapMemoryResource();
+    ::new (&cacheCoinsMemoryResource) CCoinsMapMemoryResource();
+    ::new (&cacheCoins) CCoinsMap(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &cacheCoinsMemoryResource);
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
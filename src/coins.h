@@ -12,11 +12,13 @@
 #include <hash.h>
 #include <memusage.h>
 #include <serialize.h>
+#include <support/allocators/pool.h>
 #include <uint256.h>
 
 #include <assert.h>
 #include <stdint.h>
 
+#include <functional>
 #include <unordered_map>
 
 /**
@@ -115,11 +117,30 @@ struct CCoinsCacheEntry
          */
     };
 
+    /* Neighbours in the list of DIRTY entries of the owning CCoinsViewCache, nullptr while not in the list. */
+    std::pair<const COutPoint, CCoinsCacheEntry>* pPrevDirty{nullptr};
+    std::pair<const COutPoint, CCoinsCacheEntry>* pNextDirty{nullptr};
+
     CCoinsCacheEntry() : flags(0) {}
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
+
+    // The list links belong to the map node, so copies start out unlinked and assignments keep them
+    CCoinsCacheEntry(const CCoinsCacheEntry& other) : coin(other.coin), flags(other.flags) {}
+    CCoinsCacheEntry(CCoinsCacheEntry&& other) : coin(std::move(other.coin)), flags(other.flags) {}
+    CCoinsCacheEntry& operator=(const CCoinsCacheEntry& other) { coin = other.coin; flags = other.flags; return *this; }
+    CCoinsCacheEntry& operator=(CCoinsCacheEntry&& other) { coin = std::move(other.coin); flags = other.flags; return *this; }
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * Nodes of the coins map are allocated from a PoolResource: this saves the malloc overhead of one allocation per
+ * coin and keeps nodes that were fetched together in the same chunks. The block size covers the node (key, entry,
+ * next pointer and cached hash) with some room for differences between STL implementations.
+ */
+typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher, std::equal_to<COutPoint>,
+                           PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>,
+                                         sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4,
+                                         alignof(void*)>> CCoinsMap;
+typedef CCoinsMap::allocator_type::ResourceType CCoinsMapMemoryResource;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -167,6 +188,11 @@ public:
     //! The passed mapCoins can be modified.
     virtual bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
 
+    //! Like BatchWrite, but only for a part of the modifications leading to hashBlock. The view is left
+    //! in an intermediate state until a BatchWrite for hashBlock or a later block completes it.
+    //! Returns false if not supported.
+    virtual bool BatchWritePartial(CCoinsMap &mapCoins, const uint256 &hashBlock);
+
     //! Get a cursor to iterate over the whole state
     virtual CCoinsViewCursor *Cursor() const;
 
@@ -192,6 +218,7 @@ public:
     std::vector<uint256> GetHeadBlocks() const override;
     void SetBackend(CCoinsView &viewIn);
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    bool BatchWritePartial(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
     size_t EstimateSize() const override;
 };
@@ -206,11 +233,25 @@ protected:
      * declared as "const".  
      */
     mutable uint256 hashBlock;
+    mutable CCoinsMapMemoryResource cacheCoinsMemoryResource{};
     mutable CCoinsMap cacheCoins;
 
     /* Cached dynamic memory usage for the inner Coin objects. */
     mutable size_t cachedCoinsUsage;
 
+    /**
+     * Sentinel of the circular list of DIRTY entries of cacheCoins, in the order in which they became DIRTY. It lets
+     * WriteDirtyEntries find the entries to write without scanning the whole cache.
+     */
+    CCoinsMap::value_type dirtySentinel;
+
+    /** Append an entry of cacheCoins to the dirty list, unless it is in it already */
+    void LinkDirty(CCoinsMap::value_type& entry);
+    /** Remove an entry of cacheCoins from the dirty list, if it is in it */
+    void UnlinkDirty(CCoinsMap::value_type& entry);
+    /** Empty the dirty list without touching its entries, e.g. after they were erased */
+    void ResetDirty();
+
 public:
     CCoinsViewCache(CCoinsView *baseIn);
 
@@ -225,6 +266,7 @@ public:
     uint256 GetBestBlock() const override;
     void SetBestBlock(const uint256 &hashBlock);
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    bool BatchWritePartial(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor* Cursor() const override {
         throw std::logic_error("CCoinsViewCache cursor iteration not supported.");
     }
@@ -254,6 +296,12 @@ public:
      */
     void AddCoin(const COutPoint& outpoint, Coin&& coin, bool potential_overwrite);
 
+    /**
+     * Add an unspent coin that the caller has read from the backing view, as if it was
+     * fetched by this cache. Does nothing and returns false if the outpoint is already cached.
+     */
+    bool AddFetchedCoin(const COutPoint& outpoint, Coin&& coin);
+
     /**
      * Spend a coin. Pass moveto in order to get the deleted data.
      * If no unspent output exists for the passed outpoint, this call
@@ -268,6 +316,21 @@ public:
      */
     bool Flush();
 
+    /**
+     * Write up to nMaxEntries modified entries to the base view (see BatchWritePartial). The entries stay
+     * cached as unmodified ones, except for spent coins, which are dropped. The entries are written in the order
+     * in which they were first modified, so successive calls cover all of them eventually. Only the written entries
+     * are visited, not the whole cache.
+     * If false is returned, the state of this cache (and its backing view) will be undefined.
+     */
+    bool WriteDirtyEntries(size_t nMaxEntries, size_t& nWritten);
+
+    /**
+     * Like Flush(), but keeps the cached entries. The modified entries are written in batches of up to
+     * nBatchEntries, so that the base view never has to hold more than that at once.
+     */
+    bool Sync(size_t nBatchEntries, size_t& nWritten);
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is
      * not modified.
@@ -280,6 +343,12 @@ public:
     //! Calculate the size of the cache (in bytes)
     size_t DynamicMemoryUsage() const;
 
+    /**
+     * Free the memory pool of the (empty) cache, so that memory released by Flush() is really given back
+     * instead of being kept for reuse.
+     */
+    void ReallocateCache();
+
     /** 
      * Amount of zenx coming in to a transaction
      * Note that lightweight clients may not know anything besides the hash of previous transactions,
@@ -0,0 +1,208 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/x11.h>
+
+#include <crypto/sph_blake.h>
+#include <crypto/sph_bmw.h>
+#include <crypto/sph_groestl.h>
+#include <crypto/sph_jh.h>
+#include <crypto/sph_keccak.h>
+#include <crypto/sph_skein.h>
+#include <crypto/sph_luffa.h>
+#include <crypto/sph_cubehash.h>
+#include <crypto/sph_shavite.h>
+#include <crypto/sph_simd.h>
+#include <crypto/sph_echo.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(USE_ASM)
+#include <cpuid.h>
+#endif
+#endif
+
+namespace x11_sse41
+{
+void CubeHash512(unsigned char* state, size_t lanes);
+}
+
+namespace x11_avx2
+{
+void CubeHash512(unsigned char* state, size_t lanes);
+}
+
+namespace x11_aesni
+{
+void Echo512(unsigned char* state, size_t lanes);
+}
+
+namespace
+{
+
+namespace x11
+{
+
+/** Maximum number of inputs that are carried through the stages together. */
+static const size_t MAX_LANES = 8;
+
+/** Run one of the sph_* 512-bit primitives over each 64-byte lane of state, in place. */
+template<typename Context, void (*Init)(void*), void (*Update)(void*, const void*, size_t), void (*Close)(void*, void*)>
+void Stage(unsigned char* state, size_t lanes)
+{
+    Context ctx;
+    unsigned char out[64];
+    for (size_t i = 0; i < lanes; ++i, state += 64) {
+        Init(&ctx);
+        Update(&ctx, state, 64);
+        Close(&ctx, out);
+        memcpy(state, out, 64);
+    }
+}
+
+/** The first stage is the only one that sees the (variable sized) input. */
+void Blake512(unsigned char* state, const unsigned char* in, size_t len, size_t lanes)
+{
+    static const unsigned char blank[1] = {0};
+    sph_blake512_context ctx;
+    for (size_t i = 0; i < lanes; ++i, state += 64, in += len) {
+        sph_blake512_init(&ctx);
+        sph_blake512(&ctx, len ? in : blank, len);
+        sph_blake512_close(&ctx, state);
+    }
+}
+
+} // namespace x11
+
+typedef void (*StageType)(unsigned char*, size_t);
+
+const StageType GenericCubeHash512 = x11::Stage<sph_cubehash512_context, sph_cubehash512_init, sph_cubehash512, sph_cubehash512_close>;
+const StageType GenericEcho512 = x11::Stage<sph_echo512_context, sph_echo512_init, sph_echo512, sph_echo512_close>;
+
+StageType Bmw512 = x11::Stage<sph_bmw512_context, sph_bmw512_init, sph_bmw512, sph_bmw512_close>;
+StageType Groestl512 = x11::Stage<sph_groestl512_context, sph_groestl512_init, sph_groestl512, sph_groestl512_close>;
+StageType Skein512 = x11::Stage<sph_skein512_context, sph_skein512_init, sph_skein512, sph_skein512_close>;
+StageType Jh512 = x11::Stage<sph_jh512_context, sph_jh512_init, sph_jh512, sph_jh512_close>;
+StageType Keccak512 = x11::Stage<sph_keccak512_context, sph_keccak512_init, sph_keccak512, sph_keccak512_close>;
+StageType Luffa512 = x11::Stage<sph_luffa512_context, sph_luffa512_init, sph_luffa512, sph_luffa512_close>;
+StageType CubeHash512 = GenericCubeHash512;
+StageType Shavite512 = x11::Stage<sph_shavite512_context, sph_shavite512_init, sph_shavite512, sph_shavite512_close>;
+StageType Simd512 = x11::Stage<sph_simd512_context, sph_simd512_init, sph_simd512, sph_simd512_close>;
+StageType Echo512 = GenericEcho512;
+
+/** Compare a (possibly vectorized) stage against the generic sph_* implementation. */
+bool SelfTestStage(StageType stage, StageType generic)
+{
+    unsigned char expected[x11::MAX_LANES * 64];
+    unsigned char state[x11::MAX_LANES * 64];
+    for (size_t i = 0; i < sizeof(state); ++i) {
+        expected[i] = state[i] = (unsigned char)(i * 7 + (i >> 6));
+    }
+    // Odd lane count, so both the multi-lane and the remainder paths are covered.
+    generic(expected, x11::MAX_LANES - 1);
+    stage(state, x11::MAX_LANES - 1);
+    return memcmp(state, expected, sizeof(state)) == 0;
+}
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+// We can't use cpuid.h's __get_cpuid as it does not support subleafs.
+void inline cpuid(uint32_t leaf, uint32_t subleaf, uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d)
+{
+#ifdef __GNUC__
+    __cpuid_count(leaf, subleaf, a, b, c, d);
+#else
+  __asm__ ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(leaf), "2"(subleaf));
+#endif
+}
+
+/** Check whether the OS has enabled AVX registers. */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
+} // namespace
+
+std::string X11AutoDetect()
+{
+    std::string ret = "standard";
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    bool have_sse4 = false;
+    bool have_aesni = false;
+    bool have_xsave = false;
+    bool have_avx = false;
+    bool have_avx2 = false;
+    bool enabled_avx = false;
+
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, 0, eax, ebx, ecx, edx);
+    have_sse4 = (ecx >> 19) & 1;
+    have_aesni = (ecx >> 25) & 1;
+    have_xsave = (ecx >> 27) & 1;
+    have_avx = (ecx >> 28) & 1;
+    if (have_xsave && have_avx) {
+        enabled_avx = AVXEnabled();
+    }
+    if (have_sse4) {
+        cpuid(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+    }
+
+#if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_sse4) {
+        CubeHash512 = x11_sse41::CubeHash512;
+        ret = "sse41(cubehash 2way)";
+    }
+#endif
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2 && have_avx && enabled_avx) {
+        CubeHash512 = x11_avx2::CubeHash512;
+        ret = "avx2(cubehash 2way)";
+    }
+#endif
+
+#if defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_sse4 && have_aesni) {
+        Echo512 = x11_aesni::Echo512;
+        ret += ",aesni(echo)";
+    }
+#endif
+
+#endif
+
+    assert(SelfTestStage(CubeHash512, GenericCubeHash512));
+    assert(SelfTestStage(Echo512, GenericEcho512));
+    return ret;
+}
+
+void HashX11xN(unsigned char* output, const unsigned char* input, size_t len, size_t blocks)
+{
+    unsigned char state[x11::MAX_LANES * 64];
+    while (blocks) {
+        const size_t lanes = std::min(blocks, x11::MAX_LANES);
+        x11::Blake512(state, input, len, lanes);
+        Bmw512(state, lanes);
+        Groestl512(state, lanes);
+        Skein512(state, lanes);
+        Jh512(state, lanes);
+        Keccak512(state, lanes);
+        Luffa512(state, lanes);
+        CubeHash512(state, lanes);
+        Shavite512(state, lanes);
+        Simd512(state, lanes);
+        Echo512(state, lanes);
+        for (size_t i = 0; i < lanes; ++i) {
+            memcpy(output + i * 32, state + i * 64, 32);
+        }
+        output += lanes * 32;
+        input += lanes * len;
+        blocks -= lanes;
+    }
+}
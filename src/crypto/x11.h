@@ -0,0 +1,27 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_X11_H
+#define BITCOIN_CRYPTO_X11_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+/** Autodetect the best available implementations of the X11 stages.
+ *  Returns the name of the selected implementation.
+ */
+std::string X11AutoDetect();
+
+/** Compute multiple X11 hashes of equally sized blobs (e.g. serialized block headers).
+ *  The inputs are hashed in groups of up to 8 lanes, stage by stage, so that the
+ *  vectorized stage implementations can process several lanes per call.
+ *  output:  pointer to a blocks*32 byte output buffer
+ *  input:   pointer to a blocks*len byte input buffer
+ *  len:     the size of each input blob
+ *  blocks:  the number of hashes to compute.
+ */
+void HashX11xN(unsigned char* output, const unsigned char* input, size_t len, size_t blocks);
+
+#endif // BITCOIN_CRYPTO_X11_H
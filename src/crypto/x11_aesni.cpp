@@ -0,0 +1,117 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AESNI
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/x11.h>
+#include <crypto/common.h>
+
+namespace x11_aesni {
+namespace {
+
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+
+/** Multiply each byte by 2 in GF(2^8) with the AES polynomial. */
+__m128i inline Mul2(__m128i x)
+{
+    const __m128i carry = _mm_cmplt_epi8(x, _mm_setzero_si128());
+    return Xor(_mm_add_epi8(x, x), _mm_and_si128(carry, _mm_set1_epi8(0x1b)));
+}
+
+void inline MixColumn(__m128i* w, int ia, int ib, int ic, int id)
+{
+    const __m128i a = w[ia];
+    const __m128i b = w[ib];
+    const __m128i c = w[ic];
+    const __m128i d = w[id];
+    const __m128i ab = Xor(a, b);
+    const __m128i bc = Xor(b, c);
+    const __m128i cd = Xor(c, d);
+    const __m128i abx = Mul2(ab);
+    const __m128i bcx = Mul2(bc);
+    const __m128i cdx = Mul2(cd);
+    w[ia] = Xor(Xor(abx, bc), d);
+    w[ib] = Xor(Xor(bcx, a), cd);
+    w[ic] = Xor(Xor(cdx, ab), d);
+    w[id] = Xor(Xor(Xor(abx, bcx), Xor(cdx, ab)), c);
+}
+
+void inline ShiftRow1(__m128i* w, int a, int b, int c, int d)
+{
+    const __m128i tmp = w[a];
+    w[a] = w[b];
+    w[b] = w[c];
+    w[c] = w[d];
+    w[d] = tmp;
+}
+
+void inline ShiftRow2(__m128i* w, int a, int b, int c, int d)
+{
+    __m128i tmp = w[a];
+    w[a] = w[c];
+    w[c] = tmp;
+    tmp = w[b];
+    w[b] = w[d];
+    w[d] = tmp;
+}
+
+}
+
+/** ECHO-512 of a single 64-byte block per lane, in place.
+ *  A 64-byte message always fits in one (padded) 1024-bit block, so this is a
+ *  single compression with the counter, padding and salt (zero) precomputed.
+ */
+void Echo512(unsigned char* state, size_t lanes)
+{
+    for (size_t lane = 0; lane < lanes; ++lane, state += 64) {
+        __m128i w[16];
+        __m128i m[8];
+        // Chaining value: the output length (512) in every 128-bit word.
+        for (int i = 0; i < 8; ++i) {
+            w[i] = _mm_set_epi32(0, 0, 0, 512);
+        }
+        // Message block: data, 0x80 padding, output length, bit counter.
+        for (int i = 0; i < 4; ++i) {
+            m[i] = _mm_loadu_si128((const __m128i*)(state + i * 16));
+        }
+        m[4] = _mm_set_epi32(0, 0, 0, 0x80);
+        m[5] = _mm_setzero_si128();
+        m[6] = _mm_set_epi32(0x02000000, 0, 0, 0);
+        m[7] = _mm_set_epi32(0, 0, 0, 512);
+        for (int i = 0; i < 8; ++i) {
+            w[i + 8] = m[i];
+        }
+
+        uint32_t k = 512;
+        for (int round = 0; round < 10; ++round) {
+            // BIG.SubWords: two AES rounds per word, keyed by the counter and the salt.
+            for (int i = 0; i < 16; ++i) {
+                w[i] = _mm_aesenc_si128(w[i], _mm_set_epi32(0, 0, 0, k++));
+                w[i] = _mm_aesenc_si128(w[i], _mm_setzero_si128());
+            }
+            // BIG.ShiftRows
+            ShiftRow1(w, 1, 5, 9, 13);
+            ShiftRow2(w, 2, 6, 10, 14);
+            ShiftRow1(w, 15, 11, 7, 3);
+            // BIG.MixColumns
+            MixColumn(w, 0, 1, 2, 3);
+            MixColumn(w, 4, 5, 6, 7);
+            MixColumn(w, 8, 9, 10, 11);
+            MixColumn(w, 12, 13, 14, 15);
+        }
+
+        // BIG.Final; only the first four words of the chaining value are output.
+        for (int i = 0; i < 4; ++i) {
+            const __m128i v = Xor(Xor(_mm_set_epi32(0, 0, 0, 512), m[i]), Xor(w[i], w[i + 8]));
+            _mm_storeu_si128((__m128i*)(state + i * 16), v);
+        }
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,122 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include <crypto/x11.h>
+#include <crypto/common.h>
+
+namespace x11_avx2 {
+namespace {
+
+/** CubeHash16/32-512 initial state (as produced by sph_cubehash512_init). */
+const uint32_t IV512[32] = {
+    0x2AEA2A61, 0x50F494D4, 0x2D538B8B, 0x4167D83E, 0x3FEE2313, 0xC701CF8C, 0xCC39968E, 0x50AC5695,
+    0x4D42C787, 0xA647A8B3, 0x97CF0BEF, 0x825B4537, 0xEEF864D2, 0xF22090C4, 0xD0E5CD33, 0xA23911AE,
+    0xFCD398D9, 0x148FE485, 0x1B017BEF, 0xB6444532, 0x6A536159, 0x2FF5781C, 0x91FA7934, 0x0DBADEA9,
+    0xD65C8A2B, 0xA5A70E75, 0xB1C62456, 0xBC796576, 0x1921C8F7, 0xE7989AF1, 0x7795D246, 0xD43E3B44
+};
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline RotL(__m256i x, int n) { return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n)); }
+
+/** Load 16 bytes of lane 0 and lane 1 into the low and high half of a register. */
+__m256i inline Load2(const unsigned char* p0, const unsigned char* p1)
+{
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p0)), _mm_loadu_si128((const __m128i*)p1), 1);
+}
+
+/** One CubeHash round on two interleaved states (see x11_sse41 for the single lane version). */
+void inline Round(__m256i* x)
+{
+    x[4] = Add(x[0], x[4]);
+    x[5] = Add(x[1], x[5]);
+    x[6] = Add(x[2], x[6]);
+    x[7] = Add(x[3], x[7]);
+    __m256i y0 = RotL(x[2], 7);
+    __m256i y1 = RotL(x[3], 7);
+    __m256i y2 = RotL(x[0], 7);
+    __m256i y3 = RotL(x[1], 7);
+    x[0] = Xor(y0, x[4]);
+    x[1] = Xor(y1, x[5]);
+    x[2] = Xor(y2, x[6]);
+    x[3] = Xor(y3, x[7]);
+    x[4] = _mm256_shuffle_epi32(x[4], 0x4e);
+    x[5] = _mm256_shuffle_epi32(x[5], 0x4e);
+    x[6] = _mm256_shuffle_epi32(x[6], 0x4e);
+    x[7] = _mm256_shuffle_epi32(x[7], 0x4e);
+    x[4] = Add(x[0], x[4]);
+    x[5] = Add(x[1], x[5]);
+    x[6] = Add(x[2], x[6]);
+    x[7] = Add(x[3], x[7]);
+    y0 = RotL(x[1], 11);
+    y1 = RotL(x[0], 11);
+    y2 = RotL(x[3], 11);
+    y3 = RotL(x[2], 11);
+    x[0] = Xor(y0, x[4]);
+    x[1] = Xor(y1, x[5]);
+    x[2] = Xor(y2, x[6]);
+    x[3] = Xor(y3, x[7]);
+    x[4] = _mm256_shuffle_epi32(x[4], 0xb1);
+    x[5] = _mm256_shuffle_epi32(x[5], 0xb1);
+    x[6] = _mm256_shuffle_epi32(x[6], 0xb1);
+    x[7] = _mm256_shuffle_epi32(x[7], 0xb1);
+}
+
+void inline SixteenRounds(__m256i* x)
+{
+    for (int i = 0; i < 16; ++i) {
+        Round(x);
+    }
+}
+
+void CubeHash512_2way(unsigned char* state0, unsigned char* state1)
+{
+    __m256i x[8];
+    for (int i = 0; i < 8; ++i) {
+        x[i] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)&IV512[i * 4]));
+    }
+    for (int i = 0; i < 2; ++i) {
+        x[0] = Xor(x[0], Load2(state0 + i * 32, state1 + i * 32));
+        x[1] = Xor(x[1], Load2(state0 + i * 32 + 16, state1 + i * 32 + 16));
+        SixteenRounds(x);
+    }
+    x[0] = Xor(x[0], _mm256_set_epi32(0, 0, 0, 0x80, 0, 0, 0, 0x80));
+    SixteenRounds(x);
+    x[7] = Xor(x[7], _mm256_set_epi32(1, 0, 0, 0, 1, 0, 0, 0));
+    for (int i = 0; i < 10; ++i) {
+        SixteenRounds(x);
+    }
+    for (int i = 0; i < 4; ++i) {
+        _mm_storeu_si128((__m128i*)(state0 + i * 16), _mm256_castsi256_si128(x[i]));
+        _mm_storeu_si128((__m128i*)(state1 + i * 16), _mm256_extracti128_si256(x[i], 1));
+    }
+}
+
+}
+
+/** CubeHash-512 of a single 64-byte block per lane, in place, two lanes at a time. */
+void CubeHash512(unsigned char* state, size_t lanes)
+{
+    while (lanes >= 2) {
+        CubeHash512_2way(state, state + 64);
+        state += 128;
+        lanes -= 2;
+    }
+    if (lanes) {
+        // Run the odd lane alongside a throwaway copy of itself.
+        unsigned char scratch[64];
+        memcpy(scratch, state, 64);
+        CubeHash512_2way(state, scratch);
+    }
+}
+
+}
+
+#endif
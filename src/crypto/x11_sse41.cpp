@@ -0,0 +1,129 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_SSE41
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include <crypto/x11.h>
+#include <crypto/common.h>
+
+namespace x11_sse41 {
+namespace {
+
+/** CubeHash16/32-512 initial state (as produced by sph_cubehash512_init). */
+const uint32_t IV512[32] = {
+    0x2AEA2A61, 0x50F494D4, 0x2D538B8B, 0x4167D83E, 0x3FEE2313, 0xC701CF8C, 0xCC39968E, 0x50AC5695,
+    0x4D42C787, 0xA647A8B3, 0x97CF0BEF, 0x825B4537, 0xEEF864D2, 0xF22090C4, 0xD0E5CD33, 0xA23911AE,
+    0xFCD398D9, 0x148FE485, 0x1B017BEF, 0xB6444532, 0x6A536159, 0x2FF5781C, 0x91FA7934, 0x0DBADEA9,
+    0xD65C8A2B, 0xA5A70E75, 0xB1C62456, 0xBC796576, 0x1921C8F7, 0xE7989AF1, 0x7795D246, 0xD43E3B44
+};
+
+__m128i inline Add(__m128i x, __m128i y) { return _mm_add_epi32(x, y); }
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+__m128i inline RotL(__m128i x, int n) { return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+
+/** One CubeHash round; x[0..3] hold words 0..15, x[4..7] hold words 16..31. */
+void inline Round(__m128i* x)
+{
+    x[4] = Add(x[0], x[4]);
+    x[5] = Add(x[1], x[5]);
+    x[6] = Add(x[2], x[6]);
+    x[7] = Add(x[3], x[7]);
+    // Rotate by 7 and swap x_00klm with x_01klm.
+    __m128i y0 = RotL(x[2], 7);
+    __m128i y1 = RotL(x[3], 7);
+    __m128i y2 = RotL(x[0], 7);
+    __m128i y3 = RotL(x[1], 7);
+    x[0] = Xor(y0, x[4]);
+    x[1] = Xor(y1, x[5]);
+    x[2] = Xor(y2, x[6]);
+    x[3] = Xor(y3, x[7]);
+    // Swap x_1jk0m with x_1jk1m.
+    x[4] = _mm_shuffle_epi32(x[4], 0x4e);
+    x[5] = _mm_shuffle_epi32(x[5], 0x4e);
+    x[6] = _mm_shuffle_epi32(x[6], 0x4e);
+    x[7] = _mm_shuffle_epi32(x[7], 0x4e);
+    x[4] = Add(x[0], x[4]);
+    x[5] = Add(x[1], x[5]);
+    x[6] = Add(x[2], x[6]);
+    x[7] = Add(x[3], x[7]);
+    // Rotate by 11 and swap x_0j0lm with x_0j1lm.
+    y0 = RotL(x[1], 11);
+    y1 = RotL(x[0], 11);
+    y2 = RotL(x[3], 11);
+    y3 = RotL(x[2], 11);
+    x[0] = Xor(y0, x[4]);
+    x[1] = Xor(y1, x[5]);
+    x[2] = Xor(y2, x[6]);
+    x[3] = Xor(y3, x[7]);
+    // Swap x_1jkl0 with x_1jkl1.
+    x[4] = _mm_shuffle_epi32(x[4], 0xb1);
+    x[5] = _mm_shuffle_epi32(x[5], 0xb1);
+    x[6] = _mm_shuffle_epi32(x[6], 0xb1);
+    x[7] = _mm_shuffle_epi32(x[7], 0xb1);
+}
+
+/** Sixteen rounds on two independent states. The rounds of both states alternate, so the out-of-order core
+ *  overlaps their dependency chains instead of waiting for each step of a single state. */
+void inline SixteenRounds2(__m128i* x0, __m128i* x1)
+{
+    for (int i = 0; i < 16; ++i) {
+        Round(x0);
+        Round(x1);
+    }
+}
+
+void CubeHash512_2way(unsigned char* state0, unsigned char* state1)
+{
+    __m128i x0[8], x1[8];
+    for (int i = 0; i < 8; ++i) {
+        x0[i] = x1[i] = _mm_loadu_si128((const __m128i*)&IV512[i * 4]);
+    }
+    // Two 32-byte message blocks.
+    for (int i = 0; i < 2; ++i) {
+        x0[0] = Xor(x0[0], _mm_loadu_si128((const __m128i*)(state0 + i * 32)));
+        x0[1] = Xor(x0[1], _mm_loadu_si128((const __m128i*)(state0 + i * 32 + 16)));
+        x1[0] = Xor(x1[0], _mm_loadu_si128((const __m128i*)(state1 + i * 32)));
+        x1[1] = Xor(x1[1], _mm_loadu_si128((const __m128i*)(state1 + i * 32 + 16)));
+        SixteenRounds2(x0, x1);
+    }
+    // Padding block, then finalization.
+    x0[0] = Xor(x0[0], _mm_set_epi32(0, 0, 0, 0x80));
+    x1[0] = Xor(x1[0], _mm_set_epi32(0, 0, 0, 0x80));
+    SixteenRounds2(x0, x1);
+    x0[7] = Xor(x0[7], _mm_set_epi32(1, 0, 0, 0));
+    x1[7] = Xor(x1[7], _mm_set_epi32(1, 0, 0, 0));
+    for (int i = 0; i < 10; ++i) {
+        SixteenRounds2(x0, x1);
+    }
+    for (int i = 0; i < 4; ++i) {
+        _mm_storeu_si128((__m128i*)(state0 + i * 16), x0[i]);
+        _mm_storeu_si128((__m128i*)(state1 + i * 16), x1[i]);
+    }
+}
+
+}
+
+/** CubeHash-512 of a single 64-byte block per lane, in place, two interleaved lanes at a time. */
+void CubeHash512(unsigned char* state, size_t lanes)
+{
+    while (lanes >= 2) {
+        CubeHash512_2way(state, state + 64);
+        state += 128;
+        lanes -= 2;
+    }
+    if (lanes) {
+        // Run the odd lane alongside a throwaway copy of itself.
+        unsigned char scratch[64];
+        memcpy(scratch, state, 64);
+        CubeHash512_2way(state, scratch);
+    }
+}
+
+}
+
+#endif
@@ -6,6 +6,8 @@
 
 #include <memory>
 #include <random.h>
+#include <sync.h>
+#include <utilstrencodings.h>
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -13,6 +15,9 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <set>
+
+#include <boost/algorithm/string.hpp>
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -72,14 +77,124 @@ public:
     }
 };
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+static const char* const DB_TUNING_NAMES[] = {"all", "index", "chainstate", "evodb", "llmq"};
+
+static bool ApplyDBTuningSetting(const std::string& setting, CDBTuningProfile& profile, std::string& strError)
+{
+    std::vector<std::string> kv;
+    boost::split(kv, setting, boost::is_any_of("="));
+    int64_t value;
+    if (kv.size() != 2 || !ParseInt64(kv[1], &value)) {
+        strError = strprintf("Invalid -dbtuning setting '%s'", setting);
+        return false;
+    }
+    auto checkRange = [&](int64_t min, int64_t max) {
+        if (value < min || value > max) {
+            strError = strprintf("Invalid -dbtuning setting '%s', value must be between %d and %d", setting, min, max);
+            return false;
+        }
+        return true;
+    };
+
+    // maxopenfiles and blocksize are limited to the ranges LevelDB would clip them to (see SanitizeOptions), so that
+    // the configured values are the ones in effect. LevelDB keeps 10 of the open files for its own use.
+    if (kv[0] == "maxopenfiles") {
+        if (!checkRange(64 + 10, 50000)) return false;
+        profile.nMaxOpenFiles = (int)value;
+    } else if (kv[0] == "blocksize") {
+        if (!checkRange(1024, 4 << 20)) return false;
+        profile.nBlockSize = (size_t)value;
+    } else if (kv[0] == "bloombits") {
+        if (!checkRange(0, 32)) return false;
+        profile.nBloomBits = (int)value;
+    } else if (kv[0] == "compression") {
+        if (!checkRange(0, 1)) return false;
+        profile.fCompression = value != 0;
+    } else if (kv[0] == "blockcache") {
+        if (!checkRange(10, 90)) return false;
+        profile.nBlockCachePercent = (int)value;
+    } else {
+        strError = strprintf("Unknown -dbtuning setting '%s'", kv[0]);
+        return false;
+    }
+    return true;
+}
+
+static bool GetDBTuningProfile(const std::string& name, CDBTuningProfile& profile, std::string& strError)
+{
+    // settings for "all" are applied first, so that database specific ones override them
+    for (const std::string target : {std::string("all"), name}) {
+        for (const auto& arg : gArgs.GetArgs("-dbtuning")) {
+            size_t pos = arg.find(':');
+            if (pos == std::string::npos) {
+                strError = strprintf("Invalid -dbtuning value '%s'", arg);
+                return false;
+            }
+            std::string argName = arg.substr(0, pos);
+            if (std::find(std::begin(DB_TUNING_NAMES), std::end(DB_TUNING_NAMES), argName) == std::end(DB_TUNING_NAMES)) {
+                strError = strprintf("Unknown database '%s' in -dbtuning", argName);
+                return false;
+            }
+            if (argName != target) {
+                continue;
+            }
+            std::vector<std::string> settings;
+            boost::split(settings, arg.substr(pos + 1), boost::is_any_of(","));
+            for (const auto& setting : settings) {
+                if (!ApplyDBTuningSetting(setting, profile, strError)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool CheckDBTuningArgs(std::string& strError)
+{
+    for (const auto& name : DB_TUNING_NAMES) {
+        CDBTuningProfile profile;
+        if (!GetDBTuningProfile(name, profile, strError)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int GetDBTuningExtraFileDescriptors()
+{
+    int extra = 0;
+    for (const auto& name : DB_TUNING_NAMES) {
+        CDBTuningProfile profile;
+        std::string strError;
+        if (std::string(name) != "all" && GetDBTuningProfile(name, profile, strError)) {
+            extra += std::max(profile.nMaxOpenFiles - CDBTuningProfile().nMaxOpenFiles, 0);
+        }
+    }
+    return extra;
+}
+
+static CCriticalSection cs_dbwrappers;
+static std::set<const CDBWrapper*> dbwrappers;
+
+void ForEachDBWrapper(const std::function<void(const CDBWrapper&)>& func)
+{
+    LOCK(cs_dbwrappers);
+    for (auto dbw : dbwrappers) {
+        func(*dbw);
+    }
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const CDBTuningProfile& tuning)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    size_t nBlockCacheSize = nCacheSize * tuning.nBlockCachePercent / 100;
+    options.block_cache = leveldb::NewLRUCache(nBlockCacheSize);
+    options.write_buffer_size = (nCacheSize - nBlockCacheSize) / 2; // up to two write buffers may be held in memory simultaneously
+    options.filter_policy = tuning.nBloomBits > 0 ? leveldb::NewBloomFilterPolicy(tuning.nBloomBits) : nullptr;
+    options.compression = tuning.fCompression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_open_files = tuning.nMaxOpenFiles;
+    options.block_size = tuning.nBlockSize;
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -96,7 +211,15 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    if (!fMemory) {
+        name = path.filename().string();
+        std::string strError;
+        if (!GetDBTuningProfile(name, tuning, strError)) {
+            LogPrintf("%s, using defaults\n", strError);
+            tuning = CDBTuningProfile();
+        }
+    }
+    options = GetOptions(nCacheSize, tuning);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -138,10 +261,21 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     }
 
     LogPrintf("Using obfuscation key for %s: %s\n", path.string(), HexStr(obfuscate_key));
+
+    if (!fMemory) {
+        LogPrintf("Using LevelDB tuning for %s: maxopenfiles=%d, blocksize=%d, bloombits=%d, compression=%d, blockcache=%d%%\n",
+                  name, tuning.nMaxOpenFiles, tuning.nBlockSize, tuning.nBloomBits, tuning.fCompression, tuning.nBlockCachePercent);
+        LOCK(cs_dbwrappers);
+        dbwrappers.emplace(this);
+    }
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        LOCK(cs_dbwrappers);
+        dbwrappers.erase(this);
+    }
     delete pdb;
     pdb = nullptr;
     delete options.filter_policy;
@@ -181,6 +315,11 @@ std::vector<unsigned char> CDBWrapper::CreateObfuscateKey() const
 
 }
 
+bool CDBWrapper::GetProperty(const std::string& property, std::string& value) const
+{
+    return pdb->GetProperty(property, &value);
+}
+
 bool CDBWrapper::IsEmpty()
 {
     std::unique_ptr<CDBIterator> it(NewIterator());
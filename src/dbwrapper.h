@@ -7,12 +7,17 @@
 
 #include <clientversion.h>
 #include <fs.h>
+#include <hash.h>
+#include <random.h>
 #include <serialize.h>
 #include <streams.h>
 #include <util.h>
 #include <utilstrencodings.h>
 #include <version.h>
 
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include <typeindex>
 
 #include <leveldb/db.h>
@@ -29,6 +34,26 @@ public:
 
 class CDBWrapper;
 
+/** LevelDB tuning of a single database, see -dbtuning */
+struct CDBTuningProfile
+{
+    int nMaxOpenFiles{64};
+    size_t nBlockSize{4096};
+    //! bits per key of the bloom filter, 0 disables it
+    int nBloomBits{10};
+    //! snappy, only effective if LevelDB was built with it
+    bool fCompression{false};
+    //! share of the cache used as block cache, the rest is split between two write buffers
+    int nBlockCachePercent{50};
+};
+
+/** Validate all -dbtuning arguments */
+bool CheckDBTuningArgs(std::string& strError);
+/** Number of file descriptors the databases may use on top of the default profile */
+int GetDBTuningExtraFileDescriptors();
+/** Call func for each open on-disk database */
+void ForEachDBWrapper(const std::function<void(const CDBWrapper&)>& func);
+
 /** These should be considered an implementation detail of the specific database.
  */
 namespace dbwrapper_private {
@@ -230,9 +255,14 @@ private:
 
     std::vector<unsigned char> CreateObfuscateKey() const;
 
+    //! name of the database as used by -dbtuning, empty for in-memory databases
+    std::string name;
+    CDBTuningProfile tuning;
+
 public:
     /**
-     * @param[in] path        Location in the filesystem where leveldb data will be stored.
+     * @param[in] path        Location in the filesystem where leveldb data will be stored. Its file name selects
+     *                        the -dbtuning settings.
      * @param[in] nCacheSize  Configures various leveldb cache settings.
      * @param[in] fMemory     If true, use leveldb's memory environment.
      * @param[in] fWipe       If true, remove all existing data.
@@ -358,6 +388,12 @@ public:
      */
     bool IsEmpty();
 
+    const std::string& GetName() const { return name; }
+    const CDBTuningProfile& GetTuning() const { return tuning; }
+
+    /** Query a LevelDB property like "leveldb.stats" */
+    bool GetProperty(const std::string& property, std::string& value) const;
+
     template<typename K>
     size_t EstimateSize(const K& key_begin, const K& key_end) const
     {
@@ -724,4 +760,430 @@ public:
     }
 };
 
+template<typename CDBFlatTransaction>
+class CDBFlatTransactionIterator
+{
+private:
+    CDBFlatTransaction& transaction;
+
+    typedef typename std::remove_pointer<decltype(transaction.parent.NewIterator())>::type ParentIterator;
+
+    // Same merging logic as in CDBTransactionIterator, but the transaction side walks a snapshot of the sorted view
+    std::shared_ptr<const std::vector<uint32_t>> sortedWrites;
+    size_t transactionPos{0};
+    std::unique_ptr<ParentIterator> parentIt;
+    CDataStream parentKey;
+    bool curIsParent{false};
+
+public:
+    explicit CDBFlatTransactionIterator(CDBFlatTransaction& _transaction) :
+            transaction(_transaction),
+            parentKey(SER_DISK, CLIENT_VERSION)
+    {
+        sortedWrites = transaction.GetSortedWrites();
+        transactionPos = sortedWrites->size();
+        parentIt = std::unique_ptr<ParentIterator>(transaction.parent.NewIterator());
+    }
+
+    void SeekToFirst() {
+        transactionPos = 0;
+        parentIt->SeekToFirst();
+        SkipDeletedAndOverwritten();
+        DecideCur();
+    }
+
+    template<typename K>
+    void Seek(const K& key) {
+        Seek(CDBFlatTransaction::KeyToDataStream(key));
+    }
+
+    void Seek(const CDataStream& ssKey) {
+        transactionPos = std::lower_bound(sortedWrites->begin(), sortedWrites->end(), ssKey, [&](uint32_t idx, const CDataStream& k) {
+            return transaction.CompareKey(idx, k.data(), k.size()) < 0;
+        }) - sortedWrites->begin();
+        parentIt->Seek(ssKey);
+        SkipDeletedAndOverwritten();
+        DecideCur();
+    }
+
+    bool Valid() {
+        return transactionPos < sortedWrites->size() || parentIt->Valid();
+    }
+
+    void Next() {
+        if (transactionPos >= sortedWrites->size() && !parentIt->Valid()) {
+            return;
+        }
+        if (curIsParent) {
+            assert(parentIt->Valid());
+            parentIt->Next();
+            SkipDeletedAndOverwritten();
+        } else {
+            assert(transactionPos < sortedWrites->size());
+            ++transactionPos;
+        }
+        DecideCur();
+    }
+
+    template<typename K>
+    bool GetKey(K& key) {
+        if (!Valid()) {
+            return false;
+        }
+        try {
+            CDataStream ssKey = GetKey();
+            ssKey >> key;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
+    CDataStream GetKey() {
+        if (!Valid()) {
+            return CDataStream(SER_DISK, CLIENT_VERSION);
+        }
+        if (curIsParent) {
+            return parentKey;
+        } else {
+            return transaction.GetKey((*sortedWrites)[transactionPos]);
+        }
+    }
+
+    unsigned int GetKeySize() {
+        if (!Valid()) {
+            return 0;
+        }
+        if (curIsParent) {
+            return parentIt->GetKeySize();
+        } else {
+            return transaction.entries[(*sortedWrites)[transactionPos]].keySize;
+        }
+    }
+
+    template<typename V>
+    bool GetValue(V& value) {
+        if (!Valid()) {
+            return false;
+        }
+        if (curIsParent) {
+            return transaction.Read(parentKey, value);
+        } else {
+            return transaction.GetValue((*sortedWrites)[transactionPos], value);
+        }
+    };
+
+private:
+    void SkipDeletedAndOverwritten() {
+        while (parentIt->Valid()) {
+            parentKey = parentIt->GetKey();
+            if (transaction.Find(parentKey) == CDBFlatTransaction::NO_ENTRY) {
+                break;
+            }
+            parentIt->Next();
+        }
+    }
+
+    void DecideCur() {
+        bool transactionValid = transactionPos < sortedWrites->size();
+        if (transactionValid && !parentIt->Valid()) {
+            curIsParent = false;
+        } else if (!transactionValid && parentIt->Valid()) {
+            curIsParent = true;
+        } else if (transactionValid && parentIt->Valid()) {
+            curIsParent = transaction.CompareKey((*sortedWrites)[transactionPos], parentKey.data(), parentKey.size()) >= 0;
+        }
+    }
+};
+
+/**
+ * Drop-in alternative to CDBTransaction with the same interface and semantics. Key bytes are stored in a single arena
+ * and point lookups go through an open-addressing hash table instead of a std::map with CDataStream keys. Values are
+ * kept as typed objects until Commit(), like in CDBTransaction. A sorted view of the written keys is only built when an
+ * iterator is requested.
+ * Iterators must not be used after the transaction was modified, committed or cleared.
+ */
+template<typename Parent, typename CommitTarget>
+class CDBFlatTransaction {
+    friend class CDBFlatTransactionIterator<CDBFlatTransaction>;
+
+protected:
+    static const uint32_t NO_ENTRY = std::numeric_limits<uint32_t>::max();
+    // don't keep huge tables around after a large transaction was cleared
+    static const size_t MAX_RETAINED_TABLE_SIZE = 1 << 16;
+
+    Parent &parent;
+    CommitTarget &commitTarget;
+    ssize_t memoryUsage{0}; // signed, just in case we made an error in the calculations so that we don't get an overflow
+
+    struct ValueHolder {
+        size_t memoryUsage;
+        ValueHolder(size_t _memoryUsage) : memoryUsage(_memoryUsage) {}
+        virtual ~ValueHolder() = default;
+        virtual void Write(const CDataStream& ssKey, CommitTarget &parent) = 0;
+    };
+    typedef std::unique_ptr<ValueHolder> ValueHolderPtr;
+
+    template <typename V>
+    struct ValueHolderImpl : ValueHolder {
+        ValueHolderImpl(const V &_value, size_t _memoryUsage) : ValueHolder(_memoryUsage), value(_value) {}
+
+        virtual void Write(const CDataStream& ssKey, CommitTarget &commitTarget) {
+            // see CDBTransaction::ValueHolderImpl
+            commitTarget.Write(ssKey, std::move(value));
+        }
+        V value;
+    };
+
+    struct Entry {
+        uint32_t keyPos;
+        uint32_t keySize;
+        uint64_t hash;
+        // nullptr for deleted keys
+        ValueHolderPtr value;
+    };
+
+    const uint64_t k0, k1;
+
+    std::vector<char> arena;
+    std::vector<Entry> entries;
+    // entry index + 1, 0 marks an empty slot. Size is always a power of 2
+    std::vector<uint32_t> table;
+    std::shared_ptr<const std::vector<uint32_t>> sortedWrites;
+
+    template<typename K>
+    static CDataStream KeyToDataStream(const K& key) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey << key;
+        return ssKey;
+    }
+
+    uint64_t HashKey(const char* data, size_t size) const {
+        return CSipHasher(k0, k1).Write((const unsigned char*)data, size).Finalize();
+    }
+
+    int CompareKey(uint32_t idx, const char* data, size_t size) const {
+        const Entry& e = entries[idx];
+        int r = memcmp(arena.data() + e.keyPos, data, std::min((size_t)e.keySize, size));
+        if (r != 0) {
+            return r;
+        }
+        return e.keySize < size ? -1 : (e.keySize > size ? 1 : 0);
+    }
+
+    CDataStream GetKey(uint32_t idx) const {
+        const Entry& e = entries[idx];
+        return CDataStream(arena.data() + e.keyPos, arena.data() + e.keyPos + e.keySize, SER_DISK, CLIENT_VERSION);
+    }
+
+    uint32_t Find(const char* data, size_t size, uint64_t hash) const {
+        if (table.empty()) {
+            return NO_ENTRY;
+        }
+        size_t mask = table.size() - 1;
+        for (size_t i = hash & mask; table[i] != 0; i = (i + 1) & mask) {
+            uint32_t idx = table[i] - 1;
+            if (entries[idx].hash == hash && entries[idx].keySize == size && CompareKey(idx, data, size) == 0) {
+                return idx;
+            }
+        }
+        return NO_ENTRY;
+    }
+
+    uint32_t Find(const CDataStream& ssKey) const {
+        return Find(ssKey.data(), ssKey.size(), HashKey(ssKey.data(), ssKey.size()));
+    }
+
+    void InsertIntoTable(uint32_t idx) {
+        size_t mask = table.size() - 1;
+        size_t i = entries[idx].hash & mask;
+        while (table[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        table[i] = idx + 1;
+    }
+
+    // returns the existing or newly created entry for the key. New entries are created as deleted
+    uint32_t FindOrAdd(const CDataStream& ssKey, bool& fNew) {
+        uint64_t hash = HashKey(ssKey.data(), ssKey.size());
+        uint32_t idx = Find(ssKey.data(), ssKey.size(), hash);
+        fNew = idx == NO_ENTRY;
+        if (!fNew) {
+            return idx;
+        }
+
+        // keep the load factor below 1/2
+        if ((entries.size() + 1) * 2 > table.size()) {
+            table.assign(std::max<size_t>(table.size() * 2, 16), 0);
+            for (uint32_t i = 0; i < entries.size(); i++) {
+                InsertIntoTable(i);
+            }
+        }
+
+        idx = (uint32_t)entries.size();
+        entries.emplace_back(Entry{(uint32_t)arena.size(), (uint32_t)ssKey.size(), hash, nullptr});
+        arena.insert(arena.end(), ssKey.data(), ssKey.data() + ssKey.size());
+        InsertIntoTable(idx);
+        return idx;
+    }
+
+    template <typename V>
+    bool GetValue(uint32_t idx, V& value) const {
+        if (!entries[idx].value) {
+            return false;
+        }
+        auto *impl = dynamic_cast<ValueHolderImpl<V> *>(entries[idx].value.get());
+        if (!impl) {
+            throw std::runtime_error("Read called with V != previously written type");
+        }
+        value = impl->value;
+        return true;
+    }
+
+    std::shared_ptr<const std::vector<uint32_t>> GetSortedWrites() {
+        if (!sortedWrites) {
+            auto v = std::make_shared<std::vector<uint32_t>>();
+            for (uint32_t i = 0; i < entries.size(); i++) {
+                if (entries[i].value) {
+                    v->emplace_back(i);
+                }
+            }
+            std::sort(v->begin(), v->end(), [&](uint32_t a, uint32_t b) {
+                return CompareKey(a, arena.data() + entries[b].keyPos, entries[b].keySize) < 0;
+            });
+            sortedWrites = std::move(v);
+        }
+        return sortedWrites;
+    }
+
+public:
+    CDBFlatTransaction(Parent &_parent, CommitTarget &_commitTarget) :
+        parent(_parent),
+        commitTarget(_commitTarget),
+        k0(GetRand(std::numeric_limits<uint64_t>::max())),
+        k1(GetRand(std::numeric_limits<uint64_t>::max()))
+    {
+    }
+
+    template <typename K, typename V>
+    void Write(const K& key, const V& v) {
+        Write(KeyToDataStream(key), v);
+    }
+
+    template <typename V>
+    void Write(const CDataStream& ssKey, const V& v) {
+        auto valueMemoryUsage = ::GetSerializeSize(v, SER_DISK, CLIENT_VERSION);
+
+        bool fNew;
+        auto& e = entries[FindOrAdd(ssKey, fNew)];
+        if (e.value) {
+            memoryUsage -= ssKey.size() + e.value->memoryUsage;
+        } else {
+            if (!fNew) {
+                memoryUsage -= ssKey.size();
+            }
+            sortedWrites.reset();
+        }
+        e.value = std::make_unique<ValueHolderImpl<V>>(v, valueMemoryUsage);
+
+        memoryUsage += ssKey.size() + valueMemoryUsage;
+    }
+
+    template <typename K, typename V>
+    bool Read(const K& key, V& value) {
+        return Read(KeyToDataStream(key), value);
+    }
+
+    template <typename V>
+    bool Read(const CDataStream& ssKey, V& value) {
+        uint32_t idx = Find(ssKey);
+        if (idx != NO_ENTRY) {
+            return GetValue(idx, value);
+        }
+        return parent.Read(ssKey, value);
+    }
+
+    template <typename K>
+    bool Exists(const K& key) {
+        return Exists(KeyToDataStream(key));
+    }
+
+    bool Exists(const CDataStream& ssKey) {
+        uint32_t idx = Find(ssKey);
+        if (idx != NO_ENTRY) {
+            return entries[idx].value != nullptr;
+        }
+        return parent.Exists(ssKey);
+    }
+
+    template <typename K>
+    void Erase(const K& key) {
+        return Erase(KeyToDataStream(key));
+    }
+
+    void Erase(const CDataStream& ssKey) {
+        bool fNew;
+        auto& e = entries[FindOrAdd(ssKey, fNew)];
+        if (e.value) {
+            memoryUsage -= ssKey.size() + e.value->memoryUsage;
+            e.value.reset();
+            sortedWrites.reset();
+        } else if (!fNew) {
+            return;
+        }
+        memoryUsage += ssKey.size();
+    }
+
+    void Clear() {
+        arena.clear();
+        entries.clear();
+        if (table.size() > MAX_RETAINED_TABLE_SIZE) {
+            std::vector<uint32_t>().swap(table);
+        } else {
+            std::fill(table.begin(), table.end(), 0);
+        }
+        sortedWrites.reset();
+        memoryUsage = 0;
+    }
+
+    void Commit() {
+        for (uint32_t i = 0; i < entries.size(); i++) {
+            if (!entries[i].value) {
+                commitTarget.Erase(GetKey(i));
+            }
+        }
+        for (uint32_t i = 0; i < entries.size(); i++) {
+            if (entries[i].value) {
+                entries[i].value->Write(GetKey(i), commitTarget);
+            }
+        }
+        Clear();
+    }
+
+    bool IsClean() {
+        return entries.empty();
+    }
+
+    size_t GetMemoryUsage() const {
+        if (memoryUsage < 0) {
+            // something went wrong when we accounted/calculated used memory...
+            static volatile bool didPrint = false;
+            if (!didPrint) {
+                LogPrintf("CDBFlatTransaction::%s -- negative memoryUsage (%d)", __func__, memoryUsage);
+                didPrint = true;
+            }
+            return 0;
+        }
+        return (size_t)memoryUsage;
+    }
+
+    CDBFlatTransactionIterator<CDBFlatTransaction>* NewIterator() {
+        return new CDBFlatTransactionIterator<CDBFlatTransaction>(*this);
+    }
+    std::unique_ptr<CDBFlatTransactionIterator<CDBFlatTransaction>> NewIteratorUniquePtr() {
+        return std::make_unique<CDBFlatTransactionIterator<CDBFlatTransaction>>(*this);
+    }
+};
+
 #endif // BITCOIN_DBWRAPPER_H
@@ -253,19 +253,21 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(int
 std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(size_t maxSize, const uint256& modifier) const
 {
     auto scores = CalculateScores(modifier);
+    size_t nCount = std::min(maxSize, scores.size());
 
-    // sort is descending order
-    std::sort(scores.rbegin(), scores.rend(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
+    // only the top maxSize entries are needed, so don't sort the whole list. This is descending order and results in
+    // the same order as a full sort
+    std::partial_sort(scores.begin(), scores.begin() + nCount, scores.end(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, const std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
         if (a.first == b.first) {
             // this should actually never happen, but we should stay compatible with how the non deterministic MNs did the sorting
-            return a.second->collateralOutpoint < b.second->collateralOutpoint;
+            return b.second->collateralOutpoint < a.second->collateralOutpoint;
         }
-        return a.first < b.first;
+        return b.first < a.first;
     });
 
     // take top maxSize entries and return it
     std::vector<CDeterministicMNCPtr> result;
-    result.resize(std::min(maxSize, scores.size()));
+    result.resize(nCount);
     for (size_t i = 0; i < result.size(); i++) {
         result[i] = std::move(scores[i].second);
     }
@@ -526,8 +528,52 @@ void CDeterministicMNList::RemoveMN(const uint256& proTxHash)
 }
 
 CDeterministicMNManager::CDeterministicMNManager(CEvoDB& _evoDb) :
-    evoDb(_evoDb)
+    CDeterministicMNManager(_evoDb, std::max<int64_t>(0, gArgs.GetArg("-dmnlistcache", DEFAULT_DMN_LIST_CACHE)) << 20)
+{
+}
+
+CDeterministicMNManager::CDeterministicMNManager(CEvoDB& _evoDb, size_t nListsLRUMaxUsageIn) :
+    evoDb(_evoDb),
+    nSnapshotPeriod(std::max<int>(1, gArgs.GetArg("-dmnsnapshotperiod", DEFAULT_DMN_SNAPSHOT_PERIOD))),
+    nListDiffsCacheSize(std::max(nSnapshotPeriod, DEFAULT_DMN_SNAPSHOT_PERIOD) * DISK_SNAPSHOTS),
+    nListsLRUMaxUsage(nListsLRUMaxUsageIn)
+{
+    prewarmInterrupt.reset();
+}
+
+CDeterministicMNManager::~CDeterministicMNManager()
+{
+    InterruptPrewarmThread();
+    StopPrewarmThread();
+}
+
+void CDeterministicMNManager::StartPrewarmThread()
+{
+    // can't start new thread if we have one running already
+    if (prewarmThread.joinable()) {
+        assert(false);
+    }
+
+    prewarmThread = std::thread(&TraceThread<std::function<void()> >, "mnlistprewarm", std::function<void()>(std::bind(&CDeterministicMNManager::PrewarmThreadMain, this)));
+}
+
+void CDeterministicMNManager::InterruptPrewarmThread()
+{
+    prewarmInterrupt();
+}
+
+void CDeterministicMNManager::StopPrewarmThread()
 {
+    if (!prewarmThread.joinable()) {
+        return;
+    }
+
+    // make sure to call InterruptPrewarmThread() first
+    if (!prewarmInterrupt) {
+        assert(false);
+    }
+
+    prewarmThread.join();
 }
 
 bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& _state, bool fJustCheck)
@@ -567,7 +613,7 @@ bool CDeterministicMNManager::ProcessBlock(const CBlock& block, const CBlockInde
         diff = oldList.BuildDiff(newList);
 
         evoDb.Write(std::make_pair(DB_LIST_DIFF, newList.GetBlockHash()), diff);
-        if ((nHeight % DISK_SNAPSHOT_PERIOD) == 0 || oldList.GetHeight() == -1) {
+        if ((nHeight % nSnapshotPeriod) == 0 || oldList.GetHeight() == -1) {
             evoDb.Write(std::make_pair(DB_LIST_SNAPSHOT, newList.GetBlockHash()), newList);
             mnListsCache.emplace(newList.GetBlockHash(), newList);
             LogPrintf("CDeterministicMNManager::%s -- Wrote snapshot. nHeight=%d, mapCurMNs.allMNsCount=%d\n",
@@ -622,6 +668,7 @@ bool CDeterministicMNManager::UndoBlock(const CBlock& block, const CBlockIndex*
 
         mnListsCache.erase(blockHash);
         mnListDiffsCache.erase(blockHash);
+        EraseListFromLRU(blockHash);
     }
 
     if (diff.HasChanges()) {
@@ -930,6 +977,9 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
             snapshot = itLists->second;
             break;
         }
+        if (GetListFromLRU(pindex->GetBlockHash(), snapshot)) {
+            break;
+        }
 
         if (evoDb.Read(std::make_pair(DB_LIST_SNAPSHOT, pindex->GetBlockHash()), snapshot)) {
             mnListsCache.emplace(pindex->GetBlockHash(), snapshot);
@@ -968,24 +1018,131 @@ CDeterministicMNList CDeterministicMNManager::GetListForBlock(const CBlockIndex*
         }
     }
 
+    bool fKeep = false;
     if (tipIndex) {
         // always keep a snapshot for the tip
         if (snapshot.GetBlockHash() == tipIndex->GetBlockHash()) {
             mnListsCache.emplace(snapshot.GetBlockHash(), snapshot);
+            fKeep = true;
         } else {
             // keep snapshots for yet alive quorums
             for (auto& p_llmq : Params().GetConsensus().llmqs) {
                 if ((snapshot.GetHeight() % p_llmq.second.dkgInterval == 0) && (snapshot.GetHeight() + p_llmq.second.dkgInterval * (p_llmq.second.keepOldConnections + 1) >= tipIndex->nHeight)) {
                     mnListsCache.emplace(snapshot.GetBlockHash(), snapshot);
+                    fKeep = true;
                     break;
                 }
             }
         }
     }
+    if (!listDiffIndexes.empty()) {
+        nListsRebuilt++;
+        if (!fKeep) {
+            // remember lists that took diffs to build
+            AddListToLRU(snapshot);
+        }
+    }
 
     return snapshot;
 }
 
+bool CDeterministicMNManager::GetListFromLRU(const uint256& blockHash, CDeterministicMNList& mnListRet)
+{
+    AssertLockHeld(cs);
+
+    auto it = mnListsLRUMap.find(blockHash);
+    if (it == mnListsLRUMap.end()) {
+        return false;
+    }
+    // move to the front (most recently used)
+    mnListsLRU.splice(mnListsLRU.begin(), mnListsLRU, it->second);
+    mnListRet = *it->second;
+    nListsLRUHits++;
+    return true;
+}
+
+void CDeterministicMNManager::AddListToLRU(const CDeterministicMNList& mnList)
+{
+    AssertLockHeld(cs);
+
+    if (mnListsLRUMap.count(mnList.GetBlockHash())) {
+        return;
+    }
+    size_t nUsage = mnList.EstimateMemoryUsage();
+    if (nUsage > nListsLRUMaxUsage) {
+        return;
+    }
+    while (nListsLRUUsage + nUsage > nListsLRUMaxUsage) {
+        EraseListFromLRU(mnListsLRU.back().GetBlockHash());
+        nListsLRUEvicted++;
+    }
+    mnListsLRU.emplace_front(mnList);
+    mnListsLRUMap.emplace(mnList.GetBlockHash(), mnListsLRU.begin());
+    nListsLRUUsage += nUsage;
+}
+
+void CDeterministicMNManager::EraseListFromLRU(const uint256& blockHash)
+{
+    AssertLockHeld(cs);
+
+    auto it = mnListsLRUMap.find(blockHash);
+    if (it == mnListsLRUMap.end()) {
+        return;
+    }
+    nListsLRUUsage -= it->second->EstimateMemoryUsage();
+    mnListsLRU.erase(it->second);
+    mnListsLRUMap.erase(it);
+}
+
+CDeterministicMNListsLRUStats CDeterministicMNManager::GetListsLRUStats()
+{
+    LOCK(cs);
+    return {mnListsLRU.size(), nListsLRUUsage, nListsLRUHits, nListsRebuilt, nListsLRUEvicted};
+}
+
+void CDeterministicMNManager::PrewarmThreadMain()
+{
+    const CBlockIndex* pindexPrewarmed = nullptr;
+    while (!prewarmInterrupt) {
+        const CBlockIndex* pindexTip;
+        {
+            LOCK(cs);
+            pindexTip = tipIndex;
+        }
+        // during IBD the lists are built block by block anyway
+        if (pindexTip != nullptr && pindexTip != pindexPrewarmed && !IsInitialBlockDownload()) {
+            PrewarmLists(pindexTip);
+            pindexPrewarmed = pindexTip;
+        }
+        if (!prewarmInterrupt.sleep_for(std::chrono::seconds(1))) {
+            return;
+        }
+    }
+}
+
+void CDeterministicMNManager::PrewarmLists(const CBlockIndex* pindexTip)
+{
+    // The LLMQ code asks for the lists of the blocks alive quorums were built on,
+    // from the most recent DKG back to the oldest quorum it keeps connections to.
+    // Building them here keeps their first use off the DKG and signing paths and
+    // GetListForBlock keeps them cached until CleanupCache decides they are outdated.
+    std::set<int> setHeights;
+    for (const auto& p_llmq : Params().GetConsensus().llmqs) {
+        const auto& params = p_llmq.second;
+        int nQuorumHeight = pindexTip->nHeight - (pindexTip->nHeight % params.dkgInterval);
+        for (int i = 0; i <= params.keepOldConnections && nQuorumHeight >= 0; i++, nQuorumHeight -= params.dkgInterval) {
+            setHeights.emplace(nQuorumHeight);
+        }
+    }
+    // newest first, those are the most likely to be asked for
+    for (auto it = setHeights.rbegin(); it != setHeights.rend() && !prewarmInterrupt; ++it) {
+        if (!IsDIP3Enforced(*it)) {
+            break;
+        }
+        GetListForBlock(pindexTip->GetAncestor(*it));
+    }
+}
+
 CDeterministicMNList CDeterministicMNManager::GetListAtChainTip()
 {
     LOCK(cs);
@@ -1035,7 +1192,7 @@ void CDeterministicMNManager::CleanupCache(int nHeight)
     std::vector<uint256> toDeleteLists;
     std::vector<uint256> toDeleteDiffs;
     for (const auto& p : mnListsCache) {
-        if (p.second.GetHeight() + LIST_DIFFS_CACHE_SIZE < nHeight) {
+        if (p.second.GetHeight() + nListDiffsCacheSize < nHeight) {
             toDeleteLists.emplace_back(p.first);
             continue;
         }
@@ -1066,7 +1223,7 @@ void CDeterministicMNManager::CleanupCache(int nHeight)
         mnListsCache.erase(h);
     }
     for (const auto& p : mnListDiffsCache) {
-        if (p.second.nHeight + LIST_DIFFS_CACHE_SIZE < nHeight) {
+        if (p.second.nHeight + nListDiffsCacheSize < nHeight) {
             toDeleteDiffs.emplace_back(p.first);
         }
     }
@@ -1145,7 +1302,7 @@ bool CDeterministicMNManager::UpgradeDBIfNeeded()
     if (chainActive.Height() > 1 && !evoDb.GetRawDB().Exists(std::string("b_b"))) {
         return false;
     }
-    evoDb.GetRawDB().Erase(std::string("b_b"));
+    evoDb.EraseRaw(std::string("b_b"));
 
     if (chainActive.Height() < Params().GetConsensus().DIP0003Height) {
         // not reached DIP3 height yet, so no upgrade needed
@@ -1169,16 +1326,16 @@ bool CDeterministicMNManager::UpgradeDBIfNeeded()
         CDeterministicMNList newMNList;
         UpgradeDiff(batch, pindex, curMNList, newMNList);
 
-        if ((nHeight % DISK_SNAPSHOT_PERIOD) == 0) {
+        if ((nHeight % nSnapshotPeriod) == 0) {
             batch.Write(std::make_pair(DB_LIST_SNAPSHOT, pindex->GetBlockHash()), newMNList);
-            evoDb.GetRawDB().WriteBatch(batch);
+            evoDb.WriteRawBatch(batch);
             batch.Clear();
         }
 
         curMNList = newMNList;
     }
 
-    evoDb.GetRawDB().WriteBatch(batch);
+    evoDb.WriteRawBatch(batch);
 
     LogPrintf("CDeterministicMNManager::%s -- done upgrading\n", __func__);
 
@@ -13,10 +13,13 @@
 #include <evo/simplifiedmns.h>
 #include <saltedhasher.h>
 #include <sync.h>
+#include <threadinterrupt.h>
 
 #include <immer/map.hpp>
 #include <immer/map_transient.hpp>
 
+#include <list>
+#include <thread>
 #include <unordered_map>
 
 class CBlock;
@@ -351,6 +354,18 @@ public:
         return mnMap.size();
     }
 
+    /**
+     * Rough upper bound of the memory held by this list. Lists of nearby blocks share
+     * most of their nodes and masternode objects, which is not accounted for.
+     */
+    size_t EstimateMemoryUsage() const
+    {
+        static const size_t nPerMN = sizeof(CDeterministicMN) + sizeof(CDeterministicMNState) +
+                                     sizeof(MnMap::value_type) + sizeof(MnInternalIdMap::value_type) +
+                                     3 * sizeof(MnUniquePropertyMap::value_type);
+        return sizeof(*this) + mnMap.size() * nPerMN + mnUniquePropertyMap.size() * sizeof(MnUniquePropertyMap::value_type);
+    }
+
     size_t GetValidMNsCount() const
     {
         size_t count = 0;
@@ -634,11 +649,24 @@ public:
     }
 };
 
+/** Default for -dmnsnapshotperiod, once per day */
+static const int DEFAULT_DMN_SNAPSHOT_PERIOD = 576;
+/** Default for -dmnlistcache, in MiB */
+static const int64_t DEFAULT_DMN_LIST_CACHE = 64;
+
+/** Usage of the LRU of lists rebuilt from diffs */
+struct CDeterministicMNListsLRUStats
+{
+    size_t nLists;
+    size_t nUsage;
+    uint64_t nHits;    // lookups which found a list in the LRU
+    uint64_t nRebuilt; // lists which had to be rebuilt from diffs
+    uint64_t nEvicted;
+};
+
 class CDeterministicMNManager
 {
-    static const int DISK_SNAPSHOT_PERIOD = 576; // once per day
     static const int DISK_SNAPSHOTS = 3; // keep cache for 3 disk snapshots to have 2 full days covered
-    static const int LIST_DIFFS_CACHE_SIZE = DISK_SNAPSHOT_PERIOD * DISK_SNAPSHOTS;
 
 public:
     CCriticalSection cs;
@@ -646,12 +674,38 @@ public:
 private:
     CEvoDB& evoDb;
 
+    // number of blocks between two full lists written to disk (-dmnsnapshotperiod)
+    const int nSnapshotPeriod;
+    const int nListDiffsCacheSize;
+
+    // lists of the tip and of blocks alive quorums were built on, see CleanupCache
     std::unordered_map<uint256, CDeterministicMNList, StaticSaltedHasher> mnListsCache;
     std::unordered_map<uint256, CDeterministicMNListDiff, StaticSaltedHasher> mnListDiffsCache;
     const CBlockIndex* tipIndex{nullptr};
 
+    // other lists rebuilt from diffs (e.g. for historic RPC queries), least recently used first
+    // and bounded by their estimated memory usage (-dmnlistcache)
+    std::list<CDeterministicMNList> mnListsLRU;
+    std::unordered_map<uint256, std::list<CDeterministicMNList>::iterator, StaticSaltedHasher> mnListsLRUMap;
+    size_t nListsLRUUsage{0};
+    const size_t nListsLRUMaxUsage;
+    uint64_t nListsLRUHits{0};
+    uint64_t nListsRebuilt{0};
+    uint64_t nListsLRUEvicted{0};
+
+    // builds the lists the LLMQ code is going to ask for ahead of time
+    std::thread prewarmThread;
+    CThreadInterrupt prewarmInterrupt;
+
 public:
     explicit CDeterministicMNManager(CEvoDB& _evoDb);
+    /** With the LRU bounded to nListsLRUMaxUsageIn bytes instead of -dmnlistcache */
+    CDeterministicMNManager(CEvoDB& _evoDb, size_t nListsLRUMaxUsageIn);
+    ~CDeterministicMNManager();
+
+    void StartPrewarmThread();
+    void InterruptPrewarmThread();
+    void StopPrewarmThread();
 
     bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck);
     bool UndoBlock(const CBlock& block, const CBlockIndex* pindex);
@@ -665,6 +719,7 @@ public:
 
     CDeterministicMNList GetListForBlock(const CBlockIndex* pindex);
     CDeterministicMNList GetListAtChainTip();
+    CDeterministicMNListsLRUStats GetListsLRUStats();
 
     // Test if given TX is a ProRegTx which also contains the collateral at index n
     bool IsProTxWithCollateral(const CTransactionRef& tx, uint32_t n);
@@ -678,6 +733,13 @@ public:
 
 private:
     void CleanupCache(int nHeight);
+
+    bool GetListFromLRU(const uint256& blockHash, CDeterministicMNList& mnListRet);
+    void AddListToLRU(const CDeterministicMNList& mnList);
+    void EraseListFromLRU(const uint256& blockHash);
+
+    void PrewarmThreadMain();
+    void PrewarmLists(const CBlockIndex* pindexTip);
 };
 
 extern std::unique_ptr<CDeterministicMNManager> deterministicMNManager;
@@ -34,7 +34,8 @@ void CEvoDBScopedCommitter::Rollback()
 CEvoDB::CEvoDB(size_t nCacheSize, bool fMemory, bool fWipe) :
     db(fMemory ? "" : (GetDataDir() / "evodb"), nCacheSize, fMemory, fWipe),
     rootBatch(db),
-    rootDBTransaction(db, rootBatch),
+    objectCache(db, rootBatch, EVODB_OBJECT_CACHE_SIZE),
+    rootDBTransaction(objectCache, objectCache),
     curDBTransaction(rootDBTransaction, rootDBTransaction)
 {
 }
@@ -53,10 +54,15 @@ void CEvoDB::RollbackCurTransaction()
 
 bool CEvoDB::CommitRootTransaction()
 {
+    LOCK(cs);
     assert(curDBTransaction.IsClean());
     rootDBTransaction.Commit();
     bool ret = db.WriteBatch(rootBatch);
     rootBatch.Clear();
+    if (!ret) {
+        // committed objects were already added to the cache
+        objectCache.Clear();
+    }
     return ret;
 }
 
@@ -6,13 +6,21 @@
 #define ZENX_EVODB_H
 
 #include <dbwrapper.h>
+#include <memusage.h>
 #include <sync.h>
 #include <uint256.h>
 
+#include <list>
+#include <type_traits>
+#include <unordered_map>
+
 // "b_b" was used in the initial version of deterministic MN storage
 // "b_b2" was used after compact diffs were introduced
 static const std::string EVODB_BEST_BLOCK = "b_b2";
 
+// estimated memory usage of deserialized objects kept by CEvoDBObjectCache
+static const size_t EVODB_OBJECT_CACHE_SIZE = 32 * 1024 * 1024;
+
 class CEvoDB;
 
 class CEvoDBScopedCommitter
@@ -29,6 +37,189 @@ public:
     void Rollback();
 };
 
+/**
+ * Read-through cache of deserialized objects in front of the on-disk evo DB. It is used as the parent and commit target
+ * of the root transaction, so that objects read from disk or written by committed transactions are kept in deserialized
+ * form. Objects are only serialized once, when they are committed to the batch.
+ */
+class CEvoDBObjectCache
+{
+public:
+    struct Stats {
+        size_t entries;
+        size_t memoryUsage;
+        uint64_t hits;
+        uint64_t misses;
+    };
+
+private:
+    struct CachedObject {
+        std::string key;
+        size_t memoryUsage;
+        CachedObject(const std::string& _key, size_t _memoryUsage) : key(_key), memoryUsage(_memoryUsage) {}
+        virtual ~CachedObject() = default;
+    };
+    typedef std::unique_ptr<CachedObject> CachedObjectPtr;
+
+    template <typename V>
+    struct CachedObjectImpl : CachedObject {
+        template <typename V2>
+        CachedObjectImpl(const std::string& _key, size_t _memoryUsage, V2&& _value) : CachedObject(_key, _memoryUsage), value(std::forward<V2>(_value)) {}
+        V value;
+    };
+
+    CDBWrapper& db;
+    CDBBatch& batch;
+
+    // least recently used first
+    std::list<CachedObjectPtr> objects;
+    std::unordered_map<std::string, std::list<CachedObjectPtr>::iterator> objectsMap;
+    size_t memoryUsage{0};
+    const size_t maxMemoryUsage;
+
+    uint64_t hits{0};
+    uint64_t misses{0};
+
+public:
+    CEvoDBObjectCache(CDBWrapper& _db, CDBBatch& _batch, size_t _maxMemoryUsage) : db(_db), batch(_batch), maxMemoryUsage(_maxMemoryUsage) {}
+
+    template <typename V>
+    bool Read(const CDataStream& ssKey, V& value)
+    {
+        std::string key(ssKey.data(), ssKey.size());
+        auto it = objectsMap.find(key);
+        if (it != objectsMap.end()) {
+            // the same key might have been read with a different type before, in which case we fall back to the DB
+            auto* impl = dynamic_cast<CachedObjectImpl<V>*>(it->second->get());
+            if (impl) {
+                hits++;
+                objects.splice(objects.end(), objects, it->second);
+                value = impl->value;
+                return true;
+            }
+        }
+        misses++;
+
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        if (!db.ReadDataStream(ssKey, ssValue)) {
+            return false;
+        }
+        size_t valueSize = ssValue.size();
+        try {
+            ssValue >> value;
+        } catch (const std::exception&) {
+            return false;
+        }
+        Add(key, valueSize, value);
+        return true;
+    }
+
+    bool Exists(const CDataStream& ssKey)
+    {
+        if (objectsMap.count(std::string(ssKey.data(), ssKey.size()))) {
+            hits++;
+            return true;
+        }
+        misses++;
+        return db.Exists(ssKey);
+    }
+
+    CDBIterator* NewIterator()
+    {
+        return db.NewIterator();
+    }
+
+    template <typename V>
+    void Write(const CDataStream& ssKey, V&& value)
+    {
+        size_t oldBatchSize = batch.SizeEstimate();
+        batch.Write(ssKey, value);
+        Add(std::string(ssKey.data(), ssKey.size()), batch.SizeEstimate() - oldBatchSize, std::forward<V>(value));
+    }
+
+    void Erase(const CDataStream& ssKey)
+    {
+        batch.Erase(ssKey);
+        Remove(std::string(ssKey.data(), ssKey.size()));
+    }
+
+    // drops a single object, e.g. after it was modified on disk without going through the cache
+    void Invalidate(const CDataStream& ssKey)
+    {
+        Remove(std::string(ssKey.data(), ssKey.size()));
+    }
+
+    void Clear()
+    {
+        objects.clear();
+        objectsMap.clear();
+        memoryUsage = 0;
+    }
+
+    Stats GetStats() const
+    {
+        return {objects.size(), memoryUsage, hits, misses};
+    }
+
+private:
+    // Heap memory owned by a value. Types which know their memory usage report it through EstimateMemoryUsage(), which
+    // includes sizeof(V). For other types with indirections the serialized size serves as an estimate
+    template <typename V>
+    static auto EstimateDynamicUsage(const V& value, size_t valueSize, int) -> decltype(value.EstimateMemoryUsage())
+    {
+        size_t usage = value.EstimateMemoryUsage();
+        return usage > sizeof(V) ? usage - sizeof(V) : 0;
+    }
+
+    template <typename V>
+    static size_t EstimateDynamicUsage(const V& value, size_t valueSize, long)
+    {
+        return std::is_trivially_copyable<V>::value ? 0 : valueSize;
+    }
+
+    template <typename V>
+    static size_t EstimateMemoryUsage(const std::string& key, const V& value, size_t valueSize)
+    {
+        typedef memusage::unordered_node<std::pair<const std::string, std::list<CachedObjectPtr>::iterator>> MapNode;
+
+        // the object itself, its list node, its map node and bucket and both copies of the key
+        return memusage::MallocUsage(sizeof(CachedObjectImpl<V>)) +
+               memusage::MallocUsage(sizeof(CachedObjectPtr) + 2 * sizeof(void*)) +
+               memusage::MallocUsage(sizeof(MapNode)) + sizeof(void*) +
+               2 * memusage::MallocUsage(key.size() + 1) +
+               EstimateDynamicUsage(value, valueSize, 0);
+    }
+
+    template <typename V>
+    void Add(const std::string& key, size_t valueSize, V&& value)
+    {
+        typedef typename std::decay<V>::type ValueType;
+
+        Remove(key);
+        size_t objectMemoryUsage = EstimateMemoryUsage<ValueType>(key, value, valueSize);
+        objects.emplace_back(std::make_unique<CachedObjectImpl<ValueType>>(key, objectMemoryUsage, std::forward<V>(value)));
+        objectsMap.emplace(key, std::prev(objects.end()));
+        memoryUsage += objectMemoryUsage;
+
+        while (memoryUsage > maxMemoryUsage && !objects.empty()) {
+            memoryUsage -= objects.front()->memoryUsage;
+            objectsMap.erase(objects.front()->key);
+            objects.pop_front();
+        }
+    }
+
+    void Remove(const std::string& key)
+    {
+        auto it = objectsMap.find(key);
+        if (it == objectsMap.end()) {
+            return;
+        }
+        memoryUsage -= (*it->second)->memoryUsage;
+        objects.erase(it->second);
+        objectsMap.erase(it);
+    }
+};
+
 class CEvoDB
 {
 public:
@@ -36,10 +227,11 @@ public:
 private:
     CDBWrapper db;
 
-    typedef CDBTransaction<CDBWrapper, CDBBatch> RootTransaction;
-    typedef CDBTransaction<RootTransaction, RootTransaction> CurTransaction;
+    typedef CDBFlatTransaction<CEvoDBObjectCache, CEvoDBObjectCache> RootTransaction;
+    typedef CDBFlatTransaction<RootTransaction, RootTransaction> CurTransaction;
 
     CDBBatch rootBatch;
+    CEvoDBObjectCache objectCache;
     RootTransaction rootDBTransaction;
     CurTransaction curDBTransaction;
 
@@ -86,22 +278,69 @@ public:
         curDBTransaction.Erase(key);
     }
 
-    CDBWrapper& GetRawDB()
+    // Direct access which bypasses transactions and the object cache. Only for reads, modifications must go through
+    // WriteRaw/EraseRaw/WriteRawBatch
+    const CDBWrapper& GetRawDB() const
     {
         return db;
     }
 
+    // Direct modifications. The affected objects are dropped from the cache while cs is still held, so that nobody
+    // can cache the old value between the write and the invalidation
+    template <typename K, typename V>
+    bool WriteRaw(const K& key, const V& value)
+    {
+        LOCK(cs);
+        bool ret = db.Write(key, value);
+        InvalidateObject(key);
+        return ret;
+    }
+
+    template <typename K>
+    bool EraseRaw(const K& key)
+    {
+        LOCK(cs);
+        bool ret = db.Erase(key);
+        InvalidateObject(key);
+        return ret;
+    }
+
+    // the keys of a batch are not known anymore, so the whole cache is dropped
+    bool WriteRawBatch(CDBBatch& batch)
+    {
+        LOCK(cs);
+        bool ret = db.WriteBatch(batch);
+        objectCache.Clear();
+        return ret;
+    }
+
     size_t GetMemoryUsage()
     {
         return rootDBTransaction.GetMemoryUsage();
     }
 
+    CEvoDBObjectCache::Stats GetObjectCacheStats()
+    {
+        LOCK(cs);
+        return objectCache.GetStats();
+    }
+
     bool CommitRootTransaction();
 
     bool VerifyBestBlock(const uint256& hash);
     void WriteBestBlock(const uint256& hash);
 
 private:
+    template <typename K>
+    void InvalidateObject(const K& key)
+    {
+        AssertLockHeld(cs);
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey << key;
+        objectCache.Invalidate(ssKey);
+    }
+
     // only CEvoDBScopedCommitter is allowed to invoke these
     friend class CEvoDBScopedCommitter;
     void CommitCurTransaction();
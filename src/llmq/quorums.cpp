@@ -108,10 +108,10 @@ void CQuorum::WriteContributions(CEvoDB& evoDb)
     uint256 dbKey = MakeQuorumKey(*this);
 
     if (quorumVvec != nullptr) {
-        evoDb.GetRawDB().Write(std::make_pair(DB_QUORUM_QUORUM_VVEC, dbKey), *quorumVvec);
+        evoDb.WriteRaw(std::make_pair(DB_QUORUM_QUORUM_VVEC, dbKey), *quorumVvec);
     }
     if (skShare.IsValid()) {
-        evoDb.GetRawDB().Write(std::make_pair(DB_QUORUM_SK_SHARE, dbKey), skShare);
+        evoDb.WriteRaw(std::make_pair(DB_QUORUM_SK_SHARE, dbKey), skShare);
     }
 }
 
@@ -91,14 +91,16 @@ private:
 
 public:
     CQuorumManager(CEvoDB& _evoDb, CBLSWorker& _blsWorker, CDKGSessionManager& _dkgManager);
+    virtual ~CQuorumManager() {}
 
     void UpdatedBlockTip(const CBlockIndex *pindexNew, bool fInitialDownload);
 
     bool HasQuorum(Consensus::LLMQType llmqType, const uint256& quorumHash);
 
     // all these methods will lock cs_main for a short period of time
-    CQuorumCPtr GetQuorum(Consensus::LLMQType llmqType, const uint256& quorumHash);
-    std::vector<CQuorumCPtr> ScanQuorums(Consensus::LLMQType llmqType, size_t maxCount);
+    // they are virtual so that unit tests can provide quorums which were not mined
+    virtual CQuorumCPtr GetQuorum(Consensus::LLMQType llmqType, const uint256& quorumHash);
+    virtual std::vector<CQuorumCPtr> ScanQuorums(Consensus::LLMQType llmqType, size_t maxCount);
 
     // this one is cs_main-free
     std::vector<CQuorumCPtr> ScanQuorums(Consensus::LLMQType llmqType, const CBlockIndex* pindexStart, size_t maxCount);
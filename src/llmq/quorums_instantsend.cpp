@@ -49,6 +49,141 @@ uint256 CInstantSendLock::GetRequestId() const
 
 ////////////////
 
+CInstantSendLockPtr CInstantSendLockIndex::GetByHash(const uint256& hash) const
+{
+    auto p = byHash.find(hash);
+    return p ? *p : nullptr;
+}
+
+CInstantSendLockPtr CInstantSendLockIndex::GetByTxid(const uint256& txid) const
+{
+    auto p = byTxid.find(txid);
+    return p ? GetByHash(*p) : nullptr;
+}
+
+CInstantSendLockPtr CInstantSendLockIndex::GetByInput(const COutPoint& outpoint) const
+{
+    auto p = byOutpoint.find(outpoint);
+    return p ? GetByHash(*p) : nullptr;
+}
+
+////////////////
+
+CInstantSendDb::CInstantSendDb(CDBWrapper& _db, size_t _maxIndexedISLocks) :
+    db(_db),
+    maxIndexedISLocks(_maxIndexedISLocks),
+    index(std::make_shared<CInstantSendLockIndex>())
+{
+}
+
+void CInstantSendDb::LoadIndex()
+{
+    auto newIndex = std::make_shared<CInstantSendLockIndex>();
+    bool fCorrupted = false;
+    size_t nUnindexed = 0;
+
+    auto it = std::unique_ptr<CDBIterator>(db.NewIterator());
+    auto firstKey = std::make_tuple(std::string(DB_ISLOCK_BY_HASH), uint256());
+    it->Seek(firstKey);
+
+    while (it->Valid()) {
+        decltype(firstKey) curKey;
+        if (!it->GetKey(curKey) || std::get<0>(curKey) != DB_ISLOCK_BY_HASH) {
+            break;
+        }
+        if (newIndex->byHash.size() >= maxIndexedISLocks) {
+            // only count the remaining ones, so that we know when they fit into the index again
+            nUnindexed++;
+            it->Next();
+            continue;
+        }
+        auto islock = std::make_shared<CInstantSendLock>();
+        if (!it->GetValue(*islock)) {
+            fCorrupted = true;
+            break;
+        }
+        auto& hash = std::get<1>(curKey);
+        newIndex->byHash = newIndex->byHash.set(hash, islock);
+        newIndex->byTxid = newIndex->byTxid.set(islock->txid, hash);
+        for (auto& in : islock->inputs) {
+            newIndex->byOutpoint = newIndex->byOutpoint.set(in, hash);
+        }
+        it->Next();
+    }
+
+    newIndex->fComplete = !fCorrupted && nUnindexed == 0;
+    fIndexCorrupted = fCorrupted;
+    nUnindexedISLocks = nUnindexed;
+
+    LogPrintf("CInstantSendDb::%s -- indexed %d islocks, unindexed=%d, complete=%d\n", __func__, newIndex->byHash.size(), nUnindexed, newIndex->fComplete);
+    std::atomic_store(&index, CInstantSendLockIndexCPtr(newIndex));
+}
+
+void CInstantSendDb::AddToIndex(const uint256& hash, const CInstantSendLockPtr& islock)
+{
+    auto curIndex = GetIndex();
+    if (curIndex->byHash.size() >= maxIndexedISLocks) {
+        // from now on, this one is only in the DB
+        nUnindexedISLocks++;
+        if (curIndex->fComplete) {
+            auto newIndex = std::make_shared<CInstantSendLockIndex>(*curIndex);
+            newIndex->fComplete = false;
+            std::atomic_store(&index, CInstantSendLockIndexCPtr(newIndex));
+        }
+        return;
+    }
+    auto newIndex = std::make_shared<CInstantSendLockIndex>(*curIndex);
+    newIndex->byHash = newIndex->byHash.set(hash, islock);
+    newIndex->byTxid = newIndex->byTxid.set(islock->txid, hash);
+    for (auto& in : islock->inputs) {
+        newIndex->byOutpoint = newIndex->byOutpoint.set(in, hash);
+    }
+    std::atomic_store(&index, CInstantSendLockIndexCPtr(newIndex));
+}
+
+void CInstantSendDb::RemoveFromIndex(const std::vector<std::pair<uint256, CInstantSendLockPtr>>& removed)
+{
+    auto newIndex = std::make_shared<CInstantSendLockIndex>(*GetIndex());
+    std::unordered_set<uint256, StaticSaltedHasher> seen;
+    for (auto& p : removed) {
+        if (!seen.emplace(p.first).second) {
+            continue;
+        }
+        if (!newIndex->byHash.count(p.first)) {
+            // it was only in the DB
+            if (nUnindexedISLocks != 0) {
+                nUnindexedISLocks--;
+            }
+            continue;
+        }
+        newIndex->byHash = newIndex->byHash.erase(p.first);
+        newIndex->byTxid = newIndex->byTxid.erase(p.second->txid);
+        for (auto& in : p.second->inputs) {
+            newIndex->byOutpoint = newIndex->byOutpoint.erase(in);
+        }
+    }
+    if (!fIndexCorrupted && nUnindexedISLocks == 0) {
+        newIndex->fComplete = true;
+    }
+    std::atomic_store(&index, CInstantSendLockIndexCPtr(newIndex));
+
+    if (!newIndex->fComplete && !fIndexCorrupted && newIndex->byHash.size() + nUnindexedISLocks <= maxIndexedISLocks) {
+        // everything fits into the index again, so let it serve all lookups without going to the DB
+        LoadIndex();
+    }
+}
+
+void CInstantSendDb::WriteBatch(CDBBatch& batch)
+{
+    // only touch the index after the DB was successfully updated, so that it never contains less than the DB
+    std::vector<std::pair<uint256, CInstantSendLockPtr>> removed;
+    removed.swap(pendingIndexRemovals);
+    db.WriteBatch(batch);
+    if (!removed.empty()) {
+        RemoveFromIndex(removed);
+    }
+}
+
 void CInstantSendDb::WriteNewInstantSendLock(const uint256& hash, const CInstantSendLock& islock)
 {
     CDBBatch batch(db);
@@ -65,6 +200,7 @@ void CInstantSendDb::WriteNewInstantSendLock(const uint256& hash, const CInstant
     for (auto& in : islock.inputs) {
         outpointCache.insert(in, hash);
     }
+    AddToIndex(hash, p);
 }
 
 void CInstantSendDb::RemoveInstantSendLock(CDBBatch& batch, const uint256& hash, CInstantSendLockPtr islock)
@@ -87,6 +223,7 @@ void CInstantSendDb::RemoveInstantSendLock(CDBBatch& batch, const uint256& hash,
     for (auto& in : islock->inputs) {
         outpointCache.erase(in);
     }
+    pendingIndexRemovals.emplace_back(hash, islock);
 }
 
 static std::tuple<std::string, uint32_t, uint256> BuildInversedISLockKey(const std::string& k, int nHeight, const uint256& islockHash)
@@ -145,7 +282,7 @@ std::unordered_map<uint256, CInstantSendLockPtr> CInstantSendDb::RemoveConfirmed
         it->Next();
     }
 
-    db.WriteBatch(batch);
+    WriteBatch(batch);
 
     return ret;
 }
@@ -332,17 +469,19 @@ std::vector<uint256> CInstantSendDb::RemoveChainedInstantSendLocks(const uint256
     WriteInstantSendLockArchived(batch, islockHash, nHeight);
     result.emplace_back(islockHash);
 
-    db.WriteBatch(batch);
+    WriteBatch(batch);
 
     return result;
 }
 
 ////////////////
 
-CInstantSendManager::CInstantSendManager(CDBWrapper& _llmqDb) :
-    db(_llmqDb)
+CInstantSendManager::CInstantSendManager(CDBWrapper& _llmqDb, CBLSWorker& _blsWorker) :
+    db(_llmqDb),
+    blsWorker(_blsWorker)
 {
     workInterrupt.reset();
+    db.LoadIndex();
 }
 
 CInstantSendManager::~CInstantSendManager()
@@ -703,11 +842,20 @@ void CInstantSendManager::ProcessMessageInstantSendLock(CNode* pfrom, const llmq
     if (pendingInstantSendLocks.count(hash)) {
         return;
     }
+    if (pendingInstantSendLocks.size() >= MAX_PENDING_INSTANTSEND_LOCKS) {
+        // we stop requesting islocks when the queue is full, so this only happens for islocks that were already in
+        // flight. Another peer will announce it again or the TX gets ChainLocked
+        droppedInstantSendLocks++;
+        LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- txid=%s, islock=%s: pending queue full, dropping islock, peer=%d\n", __func__,
+                islock.txid.ToString(), hash.ToString(), pfrom->GetId());
+        return;
+    }
 
     LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- txid=%s, islock=%s: received islock, peer=%d\n", __func__,
             islock.txid.ToString(), hash.ToString(), pfrom->GetId());
 
     pendingInstantSendLocks.emplace(hash, std::make_pair(pfrom->GetId(), std::move(islock)));
+    pendingInstantSendLocksCount = pendingInstantSendLocks.size();
 }
 
 bool CInstantSendManager::PreVerifyInstantSendLock(NodeId nodeId, const llmq::CInstantSendLock& islock, bool& retBan)
@@ -748,6 +896,7 @@ bool CInstantSendManager::ProcessPendingInstantSendLocks()
                 pendingInstantSendLocks.erase(it);
             }
         }
+        pendingInstantSendLocksCount = pendingInstantSendLocks.size();
     }
 
     if (pend.empty()) {
@@ -785,7 +934,13 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
 {
     auto llmqType = Params().GetConsensus().llmqTypeInstantSend;
 
-    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, true, 8);
+    // islocks are verified in small batches, so that a single invalid islock only causes re-verification of its
+    // own batch. The batches are verified in parallel
+    typedef CBLSBatchVerifier<NodeId, uint256> BatchVerifier;
+    std::vector<BatchVerifier> batchVerifiers;
+    batchVerifiers.reserve(pend.size() / ISLOCK_VERIFY_BATCH_SIZE + 1);
+    std::set<NodeId> badSources;
+    std::set<uint256> badMessages;
     std::unordered_map<uint256, std::pair<CQuorumCPtr, CRecoveredSig>> recSigs;
 
     size_t verifyCount = 0;
@@ -795,12 +950,12 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
         auto nodeId = p.second.first;
         auto& islock = p.second.second;
 
-        if (batchVerifier.badSources.count(nodeId)) {
+        if (badSources.count(nodeId)) {
             continue;
         }
 
         if (!islock.sig.Get().IsValid()) {
-            batchVerifier.badSources.emplace(nodeId);
+            badSources.emplace(nodeId);
             continue;
         }
 
@@ -818,7 +973,10 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
             return {};
         }
         uint256 signHash = CLLMQUtils::BuildSignHash(llmqType, quorum->qc.quorumHash, id, islock.txid);
-        batchVerifier.PushMessage(nodeId, hash, signHash, islock.sig.Get(), quorum->qc.quorumPublicKey);
+        if (verifyCount % ISLOCK_VERIFY_BATCH_SIZE == 0) {
+            batchVerifiers.emplace_back(false, true);
+        }
+        batchVerifiers.back().PushMessage(nodeId, hash, signHash, islock.sig.Get(), quorum->qc.quorumPublicKey);
         verifyCount++;
 
         // We can reconstruct the CRecoveredSig objects from the islock and pass it to the signing manager, which
@@ -838,17 +996,39 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
     }
 
     cxxtimer::Timer verifyTimer(true);
-    batchVerifier.Verify();
+    // the first batch is verified by this thread while the other ones are verified by the BLS worker pool
+    std::vector<std::future<void>> futures;
+    for (size_t i = 1; i < batchVerifiers.size(); i++) {
+        futures.emplace_back(blsWorker.AsyncRun(std::bind(&BatchVerifier::Verify, &batchVerifiers[i])));
+    }
+    if (!batchVerifiers.empty()) {
+        batchVerifiers[0].Verify();
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
     verifyTimer.stop();
 
-    LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- verified locks. count=%d, alreadyVerified=%d, vt=%d, nodes=%d\n", __func__,
-            verifyCount, alreadyVerified, verifyTimer.count(), batchVerifier.GetUniqueSourceCount());
+    size_t sourceCount = 0;
+    for (auto& batchVerifier : batchVerifiers) {
+        badSources.insert(batchVerifier.badSources.begin(), batchVerifier.badSources.end());
+        badMessages.insert(batchVerifier.badMessages.begin(), batchVerifier.badMessages.end());
+        sourceCount += batchVerifier.GetUniqueSourceCount();
+    }
+
+    if (verifyCount != 0) {
+        verifiedInstantSendLocks += verifyCount;
+        verifyTimeMicros += verifyTimer.count<std::chrono::microseconds>();
+    }
+
+    LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- verified locks. count=%d, alreadyVerified=%d, vt=%d, batches=%d, nodes=%d, pending=%d\n", __func__,
+            verifyCount, alreadyVerified, verifyTimer.count(), batchVerifiers.size(), sourceCount, pendingInstantSendLocksCount);
 
     std::unordered_set<uint256> badISLocks;
 
-    if (ban && !batchVerifier.badSources.empty()) {
+    if (ban && !badSources.empty()) {
         LOCK(cs_main);
-        for (auto& nodeId : batchVerifier.badSources) {
+        for (auto& nodeId : badSources) {
             // Let's not be too harsh, as the peer might simply be unlucky and might have sent us an old lock which
             // does not validate anymore due to changed quorums
             Misbehaving(nodeId, 20);
@@ -859,7 +1039,7 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
         auto nodeId = p.second.first;
         auto& islock = p.second.second;
 
-        if (batchVerifier.badMessages.count(hash)) {
+        if (badMessages.count(hash)) {
             LogPrint(BCLog::INSTANTSEND, "CInstantSendManager::%s -- txid=%s, islock=%s: invalid sig in islock, peer=%d\n", __func__,
                      islock.txid.ToString(), hash.ToString(), nodeId);
             badISLocks.emplace(hash);
@@ -1431,6 +1611,10 @@ bool CInstantSendManager::AlreadyHave(const CInv& inv)
         return true;
     }
 
+    if (db.GetIndex()->byHash.count(inv.hash)) {
+        return true;
+    }
+
     LOCK(cs);
     return db.GetInstantSendLockByHash(inv.hash) != nullptr || pendingInstantSendLocks.count(inv.hash) != 0 || db.HasArchivedInstantSendLock(inv.hash);
 }
@@ -1441,8 +1625,12 @@ bool CInstantSendManager::GetInstantSendLockByHash(const uint256& hash, llmq::CI
         return false;
     }
 
-    LOCK(cs);
-    auto islock = db.GetInstantSendLockByHash(hash);
+    auto index = db.GetIndex();
+    auto islock = index->GetByHash(hash);
+    if (!islock && !index->fComplete) {
+        LOCK(cs);
+        islock = db.GetInstantSendLockByHash(hash);
+    }
     if (!islock) {
         return false;
     }
@@ -1456,6 +1644,16 @@ bool CInstantSendManager::GetInstantSendLockHashByTxid(const uint256& txid, uint
         return false;
     }
 
+    auto index = db.GetIndex();
+    auto p = index->byTxid.find(txid);
+    if (p) {
+        ret = *p;
+        return true;
+    }
+    if (index->fComplete) {
+        return false;
+    }
+
     LOCK(cs);
     ret = db.GetInstantSendLockHashByTxid(txid);
     return !ret.IsNull();
@@ -1467,6 +1665,14 @@ bool CInstantSendManager::IsLocked(const uint256& txHash)
         return false;
     }
 
+    auto index = db.GetIndex();
+    if (index->byTxid.count(txHash)) {
+        return true;
+    }
+    if (index->fComplete) {
+        return false;
+    }
+
     LOCK(cs);
     return db.GetInstantSendLockByTxid(txHash) != nullptr;
 }
@@ -1482,9 +1688,13 @@ CInstantSendLockPtr CInstantSendManager::GetConflictingLock(const CTransaction&
         return nullptr;
     }
 
-    LOCK(cs);
+    auto index = db.GetIndex();
     for (const auto& in : tx.vin) {
-        auto otherIsLock = db.GetInstantSendLockByInput(in.prevout);
+        auto otherIsLock = index->GetByInput(in.prevout);
+        if (!otherIsLock && !index->fComplete) {
+            LOCK(cs);
+            otherIsLock = db.GetInstantSendLockByInput(in.prevout);
+        }
         if (!otherIsLock) {
             continue;
         }
@@ -1501,6 +1711,12 @@ size_t CInstantSendManager::GetInstantSendLockCount()
     return db.GetInstantSendLockCount();
 }
 
+int64_t CInstantSendManager::GetAverageVerifyTime() const
+{
+    uint64_t count = verifiedInstantSendLocks;
+    return count != 0 ? verifyTimeMicros / (int64_t)count : 0;
+}
+
 void CInstantSendManager::WorkThreadMain()
 {
     while (!workInterrupt) {
@@ -11,9 +11,21 @@
 #include <unordered_lru_cache.h>
 #include <primitives/transaction.h>
 
+#include <immer/map.hpp>
+
+#include <atomic>
 #include <unordered_map>
 #include <unordered_set>
 
+template<>
+struct SaltedHasherImpl<COutPoint>
+{
+    static std::size_t CalcHash(const COutPoint& v, uint64_t k0, uint64_t k1)
+    {
+        return SipHashUint256Extra(k0, k1, v.hash, v.n);
+    }
+};
+
 namespace llmq
 {
 
@@ -40,20 +52,63 @@ public:
 
 typedef std::shared_ptr<CInstantSendLock> CInstantSendLockPtr;
 
+/**
+ * Immutable in-memory index of the islocks stored in CInstantSendDb. A new snapshot is published on every
+ * modification and readers access the current snapshot without taking any locks. The immer maps share their
+ * structure between snapshots, so publishing a modified snapshot is cheap.
+ */
+class CInstantSendLockIndex
+{
+public:
+    immer::map<uint256, CInstantSendLockPtr, StaticSaltedHasher> byHash;
+    immer::map<uint256, uint256, StaticSaltedHasher> byTxid;
+    immer::map<COutPoint, uint256, StaticSaltedHasher> byOutpoint;
+
+    // If false, not all islocks from the DB are indexed and misses must be looked up in the DB
+    bool fComplete{false};
+
+public:
+    CInstantSendLockPtr GetByHash(const uint256& hash) const;
+    CInstantSendLockPtr GetByTxid(const uint256& txid) const;
+    CInstantSendLockPtr GetByInput(const COutPoint& outpoint) const;
+};
+typedef std::shared_ptr<const CInstantSendLockIndex> CInstantSendLockIndexCPtr;
+
 class CInstantSendDb
 {
+public:
+    // limits the memory used by the index. While exceeded, the index only serves as a cache in front of the DB
+    static const size_t MAX_INDEXED_ISLOCKS = 50000;
+
 private:
     CDBWrapper& db;
+    const size_t maxIndexedISLocks;
 
     unordered_lru_cache<uint256, CInstantSendLockPtr, StaticSaltedHasher, 10000> islockCache;
     unordered_lru_cache<uint256, uint256, StaticSaltedHasher, 10000> txidCache;
     unordered_lru_cache<COutPoint, uint256, SaltedOutpointHasher, 10000> outpointCache;
 
+    // modified while CInstantSendManager::cs is held, always accessed through std::atomic_load/std::atomic_store
+    CInstantSendLockIndexCPtr index;
+    // the following are only accessed while CInstantSendManager::cs is held
+    // number of islocks in the DB which did not fit into the index
+    size_t nUnindexedISLocks{0};
+    // an islock could not be read while loading the index, so it can't become complete again
+    bool fIndexCorrupted{false};
+    // islocks removed from a batch which was not written yet
+    std::vector<std::pair<uint256, CInstantSendLockPtr>> pendingIndexRemovals;
+
 public:
-    explicit CInstantSendDb(CDBWrapper& _db) : db(_db) {}
+    explicit CInstantSendDb(CDBWrapper& _db, size_t _maxIndexedISLocks = MAX_INDEXED_ISLOCKS);
+
+    void LoadIndex();
+    // Can be called without holding any locks
+    CInstantSendLockIndexCPtr GetIndex() const { return std::atomic_load(&index); }
 
     void WriteNewInstantSendLock(const uint256& hash, const CInstantSendLock& islock);
     void RemoveInstantSendLock(CDBBatch& batch, const uint256& hash, CInstantSendLockPtr islock);
+    // Writes a batch filled by RemoveInstantSendLock and then removes the islocks from the index
+    void WriteBatch(CDBBatch& batch);
 
     void WriteInstantSendLockMined(const uint256& hash, int nHeight);
     void RemoveInstantSendLockMined(const uint256& hash, int nHeight);
@@ -70,13 +125,26 @@ public:
 
     std::vector<uint256> GetInstantSendLocksByParent(const uint256& parent);
     std::vector<uint256> RemoveChainedInstantSendLocks(const uint256& islockHash, const uint256& txid, int nHeight);
+
+private:
+    void AddToIndex(const uint256& hash, const CInstantSendLockPtr& islock);
+    void RemoveFromIndex(const std::vector<std::pair<uint256, CInstantSendLockPtr>>& removed);
 };
 
 class CInstantSendManager : public CRecoveredSigsListener
 {
+public:
+    // Max number of received but not yet verified islocks. When reached, no more islocks are requested from peers
+    // until the queue drained and islocks received in the meantime are dropped
+    static const size_t MAX_PENDING_INSTANTSEND_LOCKS = 10000;
+
 private:
+    // number of islocks per batch when verifying pending islocks, batches are verified in parallel
+    static const size_t ISLOCK_VERIFY_BATCH_SIZE = 8;
+
     CCriticalSection cs;
     CInstantSendDb db;
+    CBLSWorker& blsWorker;
 
     std::thread workThread;
     CThreadInterrupt workInterrupt;
@@ -111,8 +179,14 @@ private:
 
     std::unordered_set<uint256, StaticSaltedHasher> pendingRetryTxs;
 
+    // metrics for the pending islocks queue
+    std::atomic<size_t> pendingInstantSendLocksCount{0};
+    std::atomic<uint64_t> droppedInstantSendLocks{0};
+    std::atomic<uint64_t> verifiedInstantSendLocks{0};
+    std::atomic<int64_t> verifyTimeMicros{0};
+
 public:
-    explicit CInstantSendManager(CDBWrapper& _llmqDb);
+    CInstantSendManager(CDBWrapper& _llmqDb, CBLSWorker& _blsWorker);
     ~CInstantSendManager();
 
     void Start();
@@ -168,6 +242,13 @@ public:
 
     size_t GetInstantSendLockCount();
 
+    // can be called without holding any locks
+    bool IsPendingQueueFull() const { return pendingInstantSendLocksCount >= MAX_PENDING_INSTANTSEND_LOCKS; }
+    size_t GetPendingInstantSendLockCount() const { return pendingInstantSendLocksCount; }
+    uint64_t GetDroppedInstantSendLockCount() const { return droppedInstantSendLocks; }
+    // average verification time per islock in microseconds
+    int64_t GetAverageVerifyTime() const;
+
     void WorkThreadMain();
 };
 
@@ -182,7 +182,8 @@ void CSigSharesNodeState::RemoveSession(const uint256& signHash)
 
 //////////////////////
 
-CSigSharesManager::CSigSharesManager()
+CSigSharesManager::CSigSharesManager(CBLSWorker& _blsWorker) :
+    blsWorker(_blsWorker)
 {
     workInterrupt.reset();
 }
@@ -577,7 +578,7 @@ bool CSigSharesManager::PreVerifyBatchedSigShares(NodeId nodeId, const CSigShare
 }
 
 void CSigSharesManager::CollectPendingSigSharesToVerify(
-        size_t maxUniqueSessions,
+        size_t maxUniqueSessionsPerShard,
         std::unordered_map<NodeId, std::vector<CSigShare>>& retSigShares,
         std::unordered_map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr, StaticSaltedHasher>& retQuorums)
 {
@@ -593,18 +594,28 @@ void CSigSharesManager::CollectPendingSigSharesToVerify(
         // invalid, making batch verification fail and revert to per-share verification, which in turn would slow down
         // the whole verification process
 
-        std::unordered_set<std::pair<NodeId, uint256>, StaticSaltedHasher> uniqueSignHashes;
+        // The limit applies to each verification shard, so that a single busy shard does not starve the other ones
+        std::vector<std::unordered_set<std::pair<NodeId, uint256>, StaticSaltedHasher>> uniqueSignHashes(SIG_SHARE_VERIFY_SHARDS);
+        size_t fullShards = 0;
         CLLMQUtils::IterateNodesRandom(nodeStates, [&]() {
-            return uniqueSignHashes.size() < maxUniqueSessions;
+            return fullShards < SIG_SHARE_VERIFY_SHARDS;
         }, [&](NodeId nodeId, CSigSharesNodeState& ns) {
             if (ns.pendingIncomingSigShares.Empty()) {
                 return false;
             }
             auto& sigShare = *ns.pendingIncomingSigShares.GetFirst();
+            auto& shardSignHashes = uniqueSignHashes[GetSigShareVerifyShard(sigShare)];
+            auto signHashKey = std::make_pair(nodeId, sigShare.GetSignHash());
+            if (shardSignHashes.size() >= maxUniqueSessionsPerShard && !shardSignHashes.count(signHashKey)) {
+                // the shard is full, keep the share (and the following ones from this node) for the next round
+                return false;
+            }
 
             bool alreadyHave = this->sigShares.Has(sigShare.GetKey());
             if (!alreadyHave) {
-                uniqueSignHashes.emplace(nodeId, sigShare.GetSignHash());
+                if (shardSignHashes.emplace(signHashKey).second && shardSignHashes.size() == maxUniqueSessionsPerShard) {
+                    fullShards++;
+                }
                 retSigShares[nodeId].emplace_back(sigShare);
             }
             ns.pendingIncomingSigShares.Erase(sigShare.GetKey());
@@ -638,19 +649,33 @@ void CSigSharesManager::CollectPendingSigSharesToVerify(
     }
 }
 
+size_t CSigSharesManager::GetSigShareVerifyShard(const CSigShare& sigShare)
+{
+    return sigShare.GetSignHash().GetCheapHash() % SIG_SHARE_VERIFY_SHARDS;
+}
+
 bool CSigSharesManager::ProcessPendingSigShares(CConnman& connman)
 {
     std::unordered_map<NodeId, std::vector<CSigShare>> sigSharesByNodes;
     std::unordered_map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr, StaticSaltedHasher> quorums;
 
-    CollectPendingSigSharesToVerify(32, sigSharesByNodes, quorums);
+    CollectPendingSigSharesToVerify(MAX_VERIFY_SESSIONS_PER_SHARD, sigSharesByNodes, quorums);
     if (sigSharesByNodes.empty()) {
         return false;
     }
 
+    // Sig shares are sharded by sign hash, so that all shares of the same signing session end up in the same batch and
+    // are aggregated into a single pairing. The shards are verified in parallel on the BLS worker threads and an
+    // invalid share only causes re-verification of the shard it ended up in.
     // It's ok to perform insecure batched verification here as we verify against the quorum public key shares,
     // which are not craftable by individual entities, making the rogue public key attack impossible
-    CBLSBatchVerifier<NodeId, SigShareKey> batchVerifier(false, true);
+    typedef CBLSBatchVerifier<NodeId, SigShareKey> BatchVerifier;
+    std::vector<BatchVerifier> shards(SIG_SHARE_VERIFY_SHARDS, BatchVerifier(false, true));
+    std::vector<std::unordered_map<NodeId, size_t>> shardCountsByNode(SIG_SHARE_VERIFY_SHARDS);
+    std::vector<int64_t> shardTimes(SIG_SHARE_VERIFY_SHARDS, 0);
+
+    // public key shares are looked up only once per quorum member and round
+    std::map<std::pair<const CQuorum*, uint16_t>, CBLSPublicKey> pubKeyShares;
 
     cxxtimer::Timer prepareTimer(true);
     size_t verifyCount = 0;
@@ -671,8 +696,12 @@ bool CSigSharesManager::ProcessPendingSigShares(CConnman& connman)
                 break;
             }
 
-            auto quorum = quorums.at(std::make_pair((Consensus::LLMQType)sigShare.llmqType, sigShare.quorumHash));
-            auto pubKeyShare = quorum->GetPubKeyShare(sigShare.quorumMember);
+            auto& quorum = quorums.at(std::make_pair((Consensus::LLMQType)sigShare.llmqType, sigShare.quorumHash));
+            auto pubKeyIt = pubKeyShares.emplace(std::make_pair(quorum.get(), sigShare.quorumMember), CBLSPublicKey()).first;
+            if (!pubKeyIt->second.IsValid()) {
+                pubKeyIt->second = quorum->GetPubKeyShare(sigShare.quorumMember);
+            }
+            auto& pubKeyShare = pubKeyIt->second;
 
             if (!pubKeyShare.IsValid()) {
                 // this should really not happen (we already ensured we have the quorum vvec,
@@ -681,23 +710,87 @@ bool CSigSharesManager::ProcessPendingSigShares(CConnman& connman)
                 assert(false);
             }
 
-            batchVerifier.PushMessage(nodeId, sigShare.GetKey(), sigShare.GetSignHash(), sigShare.sigShare.Get(), pubKeyShare);
+            size_t shard = GetSigShareVerifyShard(sigShare);
+            shards[shard].PushMessage(nodeId, sigShare.GetKey(), sigShare.GetSignHash(), sigShare.sigShare.Get(), pubKeyShare);
+            shardCountsByNode[shard][nodeId]++;
             verifyCount++;
         }
     }
     prepareTimer.stop();
 
     cxxtimer::Timer verifyTimer(true);
-    batchVerifier.Verify();
+    auto verifyShard = [&](size_t i) {
+        cxxtimer::Timer t(true);
+        shards[i].Verify();
+        t.stop();
+        shardTimes[i] = t.count<std::chrono::microseconds>();
+    };
+    // the first non-empty shard is verified by this thread while the other ones are verified by the worker pool
+    std::vector<std::future<void>> futures;
+    int localShard = -1;
+    for (size_t i = 0; i < shards.size(); i++) {
+        if (shardCountsByNode[i].empty()) {
+            continue;
+        }
+        if (localShard == -1) {
+            localShard = (int)i;
+        } else {
+            futures.emplace_back(blsWorker.AsyncRun(std::bind(verifyShard, i)));
+        }
+    }
+    if (localShard != -1) {
+        verifyShard(localShard);
+    }
+    for (auto& f : futures) {
+        f.get();
+    }
     verifyTimer.stop();
 
-    LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- verified sig shares. count=%d, pt=%d, vt=%d, nodes=%d\n", __func__, verifyCount, prepareTimer.count(), verifyTimer.count(), sigSharesByNodes.size());
+    std::set<NodeId> badSources;
+    for (auto& shard : shards) {
+        badSources.insert(shard.badSources.begin(), shard.badSources.end());
+    }
+
+    {
+        LOCK(cs);
+        for (size_t i = 0; i < shards.size(); i++) {
+            size_t shardCount = 0;
+            for (auto& p : shardCountsByNode[i]) {
+                shardCount += p.second;
+            }
+            for (auto& p : shardCountsByNode[i]) {
+                auto it = nodeStates.find(p.first);
+                if (it == nodeStates.end()) {
+                    continue;
+                }
+                // verification time of a shard is attributed to its nodes by the number of shares they contributed
+                it->second.verifiedSigShares += p.second;
+                it->second.verifyTimeMicros += shardTimes[i] * (int64_t)p.second / (int64_t)shardCount;
+            }
+        }
+        for (auto& p : sigSharesByNodes) {
+            auto it = nodeStates.find(p.first);
+            if (it == nodeStates.end()) {
+                continue;
+            }
+            auto& nodeState = it->second;
+            if (badSources.count(p.first)) {
+                for (auto& sigShare : p.second) {
+                    if (shards[GetSigShareVerifyShard(sigShare)].badMessages.count(sigShare.GetKey())) {
+                        nodeState.invalidSigShares++;
+                    }
+                }
+            }
+        }
+    }
+
+    LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- verified sig shares. count=%d, pt=%d, vt=%d, nodes=%d, shards=%d\n", __func__, verifyCount, prepareTimer.count(), verifyTimer.count(), sigSharesByNodes.size(), futures.size() + (localShard != -1 ? 1 : 0));
 
     for (auto& p : sigSharesByNodes) {
         auto nodeId = p.first;
         auto& v = p.second;
 
-        if (batchVerifier.badSources.count(nodeId)) {
+        if (badSources.count(nodeId)) {
             LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- invalid sig shares from other node, banning peer=%d\n",
                      __func__, nodeId);
             // this will also cause re-requesting of the shares that were sent by this node
@@ -1428,6 +1521,12 @@ void CSigSharesManager::Cleanup()
     LOCK(cs);
     for (auto nodeId : nodeStatesToDelete) {
         auto& nodeState = nodeStates[nodeId];
+        if (nodeState.verifiedSigShares != 0) {
+            // only reported once per peer, the counters are updated in every verification round
+            LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- verify stats for peer=%d: verified=%d, invalid=%d, time=%dus, throughput=%d/s\n", __func__,
+                     nodeId, nodeState.verifiedSigShares, nodeState.invalidSigShares, nodeState.verifyTimeMicros,
+                     nodeState.verifyTimeMicros ? nodeState.verifiedSigShares * 1000000 / nodeState.verifyTimeMicros : 0);
+        }
         // remove global requested state to force a re-request from another node
         nodeState.requestedSigShares.ForEach([&](const SigShareKey& k, bool) {
             sigSharesRequested.Erase(k);
@@ -1641,4 +1740,17 @@ void CSigSharesManager::HandleNewRecoveredSig(const llmq::CRecoveredSig& recover
     RemoveSigSharesForSession(CLLMQUtils::BuildSignHash(recoveredSig));
 }
 
+bool CSigSharesManager::GetNodeVerifyStats(NodeId nodeId, int64_t& retVerified, int64_t& retInvalid, int64_t& retVerifyTimeMicros)
+{
+    LOCK(cs);
+    auto it = nodeStates.find(nodeId);
+    if (it == nodeStates.end()) {
+        return false;
+    }
+    retVerified = it->second.verifiedSigShares;
+    retInvalid = it->second.invalidSigShares;
+    retVerifyTimeMicros = it->second.verifyTimeMicros;
+    return true;
+}
+
 } // namespace llmq
@@ -333,6 +333,11 @@ public:
 
     bool banned{false};
 
+    // used to report per node verification throughput
+    int64_t verifiedSigShares{0};
+    int64_t invalidSigShares{0};
+    int64_t verifyTimeMicros{0};
+
     Session& GetOrCreateSessionFromShare(const CSigShare& sigShare);
     Session& GetOrCreateSessionFromAnn(const CSigSesAnn& ann);
     Session* GetSessionBySignHash(const uint256& signHash);
@@ -368,9 +373,16 @@ class CSigSharesManager : public CRecoveredSigsListener
     const int64_t MAX_SEND_FOR_RECOVERY_TIMEOUT = 10000;
     const size_t MAX_MSGS_SIG_SHARES = 32;
 
+    // pending sig shares are verified in parallel in this many shards, each covering up to
+    // MAX_VERIFY_SESSIONS_PER_SHARD signing sessions per round
+    static const size_t SIG_SHARE_VERIFY_SHARDS = 4;
+    static const size_t MAX_VERIFY_SESSIONS_PER_SHARD = 32;
+
 private:
     CCriticalSection cs;
 
+    CBLSWorker& blsWorker;
+
     std::thread workThread;
     CThreadInterrupt workInterrupt;
 
@@ -393,7 +405,7 @@ private:
     std::atomic<uint32_t> recoveredSigsCounter{0};
 
 public:
-    CSigSharesManager();
+    explicit CSigSharesManager(CBLSWorker& _blsWorker);
     ~CSigSharesManager();
 
     void StartWorkerThread();
@@ -411,6 +423,9 @@ public:
 
     void HandleNewRecoveredSig(const CRecoveredSig& recoveredSig);
 
+    // Returns the sig share verification stats of a peer, false if there is no state for it
+    bool GetNodeVerifyStats(NodeId nodeId, int64_t& retVerified, int64_t& retInvalid, int64_t& retVerifyTimeMicros);
+
     static CDeterministicMNCPtr SelectMemberForRecovery(const CQuorumCPtr& quorum, const uint256& id, int attempt);
 
 private:
@@ -424,7 +439,7 @@ private:
     bool VerifySigSharesInv(NodeId from, Consensus::LLMQType llmqType, const CSigSharesInv& inv);
     bool PreVerifyBatchedSigShares(NodeId nodeId, const CSigSharesNodeState::SessionInfo& session, const CBatchedSigShares& batchedSigShares, bool& retBan);
 
-    void CollectPendingSigSharesToVerify(size_t maxUniqueSessions,
+    void CollectPendingSigSharesToVerify(size_t maxUniqueSessionsPerShard,
             std::unordered_map<NodeId, std::vector<CSigShare>>& retSigShares,
             std::unordered_map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr, StaticSaltedHasher>& retQuorums);
     bool ProcessPendingSigShares(CConnman& connman);
@@ -433,6 +448,7 @@ private:
             const std::vector<CSigShare>& sigShares,
             const std::unordered_map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr, StaticSaltedHasher>& quorums,
             CConnman& connman);
+    static size_t GetSigShareVerifyShard(const CSigShare& sigShare);
 
     void ProcessSigShare(NodeId nodeId, const CSigShare& sigShare, CConnman& connman, const CQuorumCPtr& quorum);
     void TryRecoverSig(const CQuorumCPtr& quorum, const uint256& id, const uint256& msgHash, CConnman& connman);
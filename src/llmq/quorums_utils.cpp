@@ -8,6 +8,8 @@
 #include <chainparams.h>
 #include <random.h>
 #include <spork.h>
+#include <sync.h>
+#include <unordered_lru_cache.h>
 #include <validation.h>
 
 #include <masternode/masternode-meta.h>
@@ -15,12 +17,30 @@
 namespace llmq
 {
 
+// Quorum members only depend on the quorum type and the quorum block, so they can be shared by all callers
+// (DKG, signing, connections, commitment verification) instead of being recalculated from the MN list every time
+static CCriticalSection cs_quorumMembers;
+static unordered_lru_cache<std::pair<Consensus::LLMQType, uint256>, std::vector<CDeterministicMNCPtr>, StaticSaltedHasher, 128> quorumMembersCache;
+
 std::vector<CDeterministicMNCPtr> CLLMQUtils::GetAllQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum)
 {
+    auto cacheKey = std::make_pair(llmqType, pindexQuorum->GetBlockHash());
+    std::vector<CDeterministicMNCPtr> members;
+    {
+        LOCK(cs_quorumMembers);
+        if (quorumMembersCache.get(cacheKey, members)) {
+            return members;
+        }
+    }
+
     auto& params = Params().GetConsensus().llmqs.at(llmqType);
     auto allMns = deterministicMNManager->GetListForBlock(pindexQuorum);
-    auto modifier = ::SerializeHash(std::make_pair(llmqType, pindexQuorum->GetBlockHash()));
-    return allMns.CalculateQuorum(params.size, modifier);
+    auto modifier = ::SerializeHash(cacheKey);
+    members = allMns.CalculateQuorum(params.size, modifier);
+
+    LOCK(cs_quorumMembers);
+    quorumMembersCache.insert(cacheKey, members);
+    return members;
 }
 
 uint256 CLLMQUtils::BuildCommitmentHash(Consensus::LLMQType llmqType, const uint256& blockHash, const std::vector<bool>& validMembers, const CBLSPublicKey& pubKey, const uint256& vvecHash)
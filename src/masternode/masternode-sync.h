@@ -7,6 +7,8 @@
 #include <chain.h>
 #include <net.h>
 
+#include <atomic>
+
 class CMasternodeSync;
 
 static const int MASTERNODE_SYNC_BLOCKCHAIN      = 1;
@@ -28,15 +30,15 @@ extern CMasternodeSync masternodeSync;
 class CMasternodeSync
 {
 private:
-    // Keep track of current asset
-    int nCurrentAsset;
+    // Keep track of current asset. Read by the message handler shards (e.g. for governance votes).
+    std::atomic<int> nCurrentAsset;
     // Count peers we've requested the asset from
     int nTriedPeerCount;
 
     // Time when current masternode asset sync started
     int64_t nTimeAssetSyncStarted;
-    // ... last bumped
-    int64_t nTimeLastBumped;
+    // ... last bumped, also from the message handler shards
+    std::atomic<int64_t> nTimeLastBumped;
 
     /// Set to true if best header is reached in CMasternodeSync::UpdatedBlockTip
     bool fReachedBestHeader{false};
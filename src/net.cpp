@@ -99,6 +99,14 @@ static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 50;
 static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 500;
 #endif
 
+#ifdef USE_EPOLL
+/** How often a socket reactor checks peers with pending data whose receiving was paused */
+static const int PAUSED_RECV_POLL_MILLISECONDS = 10;
+#endif
+
+/** Maximum number of buffers (two per message) handed to a single sendmsg() call, well below IOV_MAX */
+static const size_t MAX_SEND_CHUNKS = 64;
+
 const static std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 constexpr const CConnman::CFullyConnectedOnly CConnman::FullyConnectedOnly;
@@ -116,6 +124,7 @@ CCriticalSection cs_mapLocalHost;
 std::map<CNetAddr, LocalServiceInfo> mapLocalHost GUARDED_BY(cs_mapLocalHost);
 static bool vfLimited[NET_MAX] GUARDED_BY(cs_mapLocalHost) = {};
 std::string strSubVersion;
+CRecvBufferPool g_recv_buffer_pool;
 
 void CConnman::AddOneShot(const std::string& strDest)
 {
@@ -829,7 +838,7 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
         // get current incomplete message, or create a new one
         if (vRecvMsg.empty() ||
             vRecvMsg.back().complete())
-            vRecvMsg.push_back(CNetMessage(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION));
+            vRecvMsg.emplace_back(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
 
         CNetMessage& msg = vRecvMsg.back();
 
@@ -861,6 +870,9 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete
                 i = mapRecvBytesPerMsgCmd.find(NET_MESSAGE_COMMAND_OTHER);
             assert(i != mapRecvBytesPerMsgCmd.end());
             i->second += msg.hdr.nMessageSize + CMessageHeader::HEADER_SIZE;
+            if (msg.hdr.nMessageSize > 0) {
+                g_recv_buffer_pool.RecordMessage(i->first, msg.fAllocated);
+            }
 
             msg.nTime = nTimeMicros;
             complete = true;
@@ -897,22 +909,86 @@ int CNode::GetSendVersion() const
 }
 
 
+CSerializeData CRecvBufferPool::Get(size_t nSize)
+{
+    CSerializeData buf;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto itBest = vBuffers.end();
+    for (auto it = vBuffers.begin(); it != vBuffers.end(); ++it) {
+        if (it->capacity() >= nSize && (itBest == vBuffers.end() || it->capacity() < itBest->capacity())) {
+            itBest = it;
+        }
+    }
+    if (itBest != vBuffers.end()) {
+        nTotalSize -= itBest->capacity();
+        buf.swap(*itBest);
+        if (itBest != vBuffers.end() - 1) {
+            itBest->swap(vBuffers.back());
+        }
+        vBuffers.pop_back();
+    }
+    return buf;
+}
+
+void CRecvBufferPool::Put(CSerializeData&& buf)
+{
+    if (buf.capacity() == 0 || buf.capacity() > MAX_BUFFER_SIZE) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (vBuffers.size() >= MAX_BUFFERS || nTotalSize + buf.capacity() > MAX_TOTAL_SIZE) {
+        // the caller frees it, outside of the lock
+        return;
+    }
+    nTotalSize += buf.capacity();
+    buf.clear();
+    vBuffers.emplace_back(std::move(buf));
+}
+
+void CRecvBufferPool::RecordMessage(const std::string& strCommand, bool fAllocated)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    CRecvBufferStats& stats = mapStats[strCommand];
+    if (fAllocated) {
+        stats.nAllocated++;
+    } else {
+        stats.nReused++;
+    }
+}
+
+void CRecvBufferPool::GetStats(std::map<std::string, CRecvBufferStats>& mapStatsOut, size_t& nBuffersOut, size_t& nTotalSizeOut)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    mapStatsOut = mapStats;
+    nBuffersOut = vBuffers.size();
+    nTotalSizeOut = nTotalSize;
+}
+
+CNetMessage::~CNetMessage()
+{
+    if (vRecv.capacity() != 0) {
+        CSerializeData buf;
+        vRecv.swap_data(buf);
+        g_recv_buffer_pool.Put(std::move(buf));
+    }
+}
+
 int CNetMessage::readHeader(const char *pch, unsigned int nBytes)
 {
     // copy data to temporary parsing buffer
-    unsigned int nRemaining = 24 - nHdrPos;
+    unsigned int nRemaining = CMessageHeader::HEADER_SIZE - nHdrPos;
     unsigned int nCopy = std::min(nRemaining, nBytes);
 
     memcpy(&hdrbuf[nHdrPos], pch, nCopy);
     nHdrPos += nCopy;
 
     // if header incomplete, exit
-    if (nHdrPos < 24)
+    if (nHdrPos < CMessageHeader::HEADER_SIZE)
         return nCopy;
 
     // deserialize to CMessageHeader
     try {
-        hdrbuf >> hdr;
+        CSpanReader(SER_NETWORK, INIT_PROTO_VERSION, hdrbuf, hdrbuf + CMessageHeader::HEADER_SIZE) >> hdr;
     }
     catch (const std::exception&) {
         return -1;
@@ -933,9 +1009,18 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
     unsigned int nRemaining = hdr.nMessageSize - nDataPos;
     unsigned int nCopy = std::min(nRemaining, nBytes);
 
+    if (nDataPos == 0 && vRecv.capacity() == 0) {
+        // Only a pooled buffer which can hold the whole message avoids reallocating it while the data arrives
+        CSerializeData buf = g_recv_buffer_pool.Get(hdr.nMessageSize);
+        vRecv.swap_data(buf);
+    }
     if (vRecv.size() < nDataPos + nCopy) {
         // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
+        unsigned int nNewSize = std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024);
+        if (vRecv.capacity() < nNewSize) {
+            fAllocated = true;
+        }
+        vRecv.resize(nNewSize);
     }
 
     hasher.Write((const unsigned char*)pch, nCopy);
@@ -955,31 +1040,71 @@ const uint256& CNetMessage::GetMessageHash() const
 
 size_t CConnman::SocketSendData(CNode *pnode) EXCLUSIVE_LOCKS_REQUIRED(pnode->cs_vSend)
 {
-    auto it = pnode->vSendMsg.begin();
     size_t nSentSize = 0;
 
-    while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
-        int nBytes = 0;
+    while (!pnode->vSendMsg.empty()) {
+        // gather the unsent parts of the queued messages, starting at nSendOffset inside the first one
+        std::pair<const unsigned char*, size_t> chunks[MAX_SEND_CHUNKS];
+        size_t nChunks = 0;
+        size_t nChunkBytes = 0;
+        size_t nOffset = pnode->nSendOffset;
+        for (auto it = pnode->vSendMsg.begin(); it != pnode->vSendMsg.end() && nChunks + 2 <= MAX_SEND_CHUNKS; ++it) {
+            const CSendMsgBuffer& msg = **it;
+            assert(msg.size() > nOffset);
+            size_t nHeaderOffset = std::min(nOffset, msg.header.size());
+            size_t nDataOffset = nOffset - nHeaderOffset;
+            if (nHeaderOffset < msg.header.size()) {
+                chunks[nChunks++] = std::make_pair(msg.header.data() + nHeaderOffset, msg.header.size() - nHeaderOffset);
+            }
+            if (nDataOffset < msg.data.size()) {
+                chunks[nChunks++] = std::make_pair(msg.data.data() + nDataOffset, msg.data.size() - nDataOffset);
+            }
+            nChunkBytes += msg.size() - nOffset;
+            nOffset = 0;
+        }
+
+        ssize_t nBytes = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifdef WIN32
+            // no scatter-gather I/O, send one chunk at a time
+            nChunkBytes = chunks[0].second;
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(chunks[0].first), chunks[0].second, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            struct iovec iov[MAX_SEND_CHUNKS];
+            for (size_t i = 0; i < nChunks; i++) {
+                iov[i].iov_base = const_cast<unsigned char*>(chunks[i].first);
+                iov[i].iov_len = chunks[i].second;
+            }
+            struct msghdr hdr = {};
+            hdr.msg_iov = iov;
+            hdr.msg_iovlen = nChunks;
+            nBytes = sendmsg(pnode->hSocket, &hdr, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            // drop all messages which went out completely
+            size_t nRemaining = nBytes;
+            while (nRemaining > 0) {
+                size_t nMsgSize = pnode->vSendMsg.front()->size();
+                size_t nMsgLeft = nMsgSize - pnode->nSendOffset;
+                if (nRemaining < nMsgLeft) {
+                    pnode->nSendOffset += nRemaining;
+                    break;
+                }
+                nRemaining -= nMsgLeft;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
-                it++;
-            } else {
-                // could not send full message; stop sending more
+                pnode->nSendSize -= nMsgSize;
+                pnode->vSendMsg.pop_front();
+            }
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if ((size_t)nBytes < nChunkBytes) {
+                // could not send everything; stop sending more
                 pnode->fCanSendData = false;
                 break;
             }
@@ -999,11 +1124,10 @@ size_t CConnman::SocketSendData(CNode *pnode) EXCLUSIVE_LOCKS_REQUIRED(pnode->cs
         }
     }
 
-    if (it == pnode->vSendMsg.end()) {
+    if (pnode->vSendMsg.empty()) {
         assert(pnode->nSendOffset == 0);
         assert(pnode->nSendSize == 0);
     }
-    pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
     pnode->nSendMsgSize = pnode->vSendMsg.size();
     return nSentSize;
 }
@@ -1861,19 +1985,40 @@ size_t CConnman::SocketRecvData(CNode *pnode)
         RecordBytesRecv(nBytes);
         if (notify) {
             size_t nSizeAdded = 0;
+            // only fully connected peers can use the message handler shards, the handshake is done by the main one
+            bool fConcurrent = !vMessageHandlerShards.empty() && pnode->fSuccessfullyConnected;
+            std::list<CNetMessage> vConcurrentMsgs;
             auto it(pnode->vRecvMsg.begin());
-            for (; it != pnode->vRecvMsg.end(); ++it) {
+            while (it != pnode->vRecvMsg.end()) {
                 if (!it->complete())
                     break;
                 nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+                if (fConcurrent && m_msgproc->IsConcurrentMessage(it->hdr.GetCommand())) {
+                    vConcurrentMsgs.splice(vConcurrentMsgs.end(), pnode->vRecvMsg, it++);
+                } else {
+                    ++it;
+                }
             }
+            size_t nConcurrentMsgs = vConcurrentMsgs.size();
+            bool fScheduleConcurrent = false;
+            bool fWake = pnode->vRecvMsg.begin() != it;
             {
                 LOCK(pnode->cs_vProcessMsg);
                 pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
+                if (nConcurrentMsgs != 0) {
+                    pnode->vProcessMsgConcurrent.splice(pnode->vProcessMsgConcurrent.end(), vConcurrentMsgs);
+                    fScheduleConcurrent = !pnode->fProcessMsgConcurrentScheduled;
+                    pnode->fProcessMsgConcurrentScheduled = true;
+                }
                 pnode->nProcessQueueSize += nSizeAdded;
                 pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
             }
-            WakeMessageHandler();
+            if (nConcurrentMsgs != 0) {
+                ScheduleConcurrentMessages(pnode, nConcurrentMsgs, fScheduleConcurrent);
+            }
+            if (fWake) {
+                WakeMessageHandler();
+            }
         }
     }
     else if (nBytes == 0)
@@ -1925,6 +2070,140 @@ void CConnman::ThreadSocketHandler()
     }
 }
 
+#ifdef USE_EPOLL
+void CConnman::ThreadSocketReactor(size_t nReactor)
+{
+    SocketReactor& reactor = *vSocketReactors[nReactor];
+    const size_t maxEvents = 64;
+    epoll_event events[maxEvents];
+
+    // Peers signalled as receivable/sendable which were not drained yet (edge-triggered mode won't signal them again).
+    // Only accessed by this thread and all contained peers are kept alive by the reactor's references.
+    std::unordered_set<CNode*> setReceivable;
+    std::unordered_set<CNode*> setSendable;
+    std::vector<CNode*> vRemovedNodes;
+    std::vector<CNode*> vErrorNodes;
+    std::vector<CNode*> vSendNodes;
+
+    while (!interruptNet) {
+        bool fOnlyPoll = false;
+        bool fPausedRecv = false;
+        {
+            LOCK(reactor.cs);
+            vRemovedNodes.swap(reactor.vRemovedNodes);
+            for (CNode* pnode : vRemovedNodes) {
+                setReceivable.erase(pnode);
+                setSendable.erase(pnode);
+            }
+            for (CNode* pnode : reactor.setNodesWithDataToSend) {
+                if (setSendable.count(pnode)) {
+                    vSendNodes.emplace_back(pnode);
+                }
+            }
+            // check if we have work to do and thus should avoid waiting for events
+            fOnlyPoll = !vSendNodes.empty();
+            for (CNode* pnode : setReceivable) {
+                if (pnode->fPauseRecv) {
+                    fPausedRecv = true;
+                } else {
+                    fOnlyPoll = true;
+                    break;
+                }
+            }
+            reactor.fWakeupNeeded = !fOnlyPoll;
+        }
+        for (CNode* pnode : vRemovedNodes) {
+            pnode->Release();
+        }
+        vRemovedNodes.clear();
+
+        // Paused peers are not signalled when the message handler caught up, so check them every now and then
+        int timeout = fOnlyPoll ? 0 : fPausedRecv ? PAUSED_RECV_POLL_MILLISECONDS : (int)SELECT_TIMEOUT_MILLISECONDS;
+        int n = epoll_wait(reactor.epollfd, events, maxEvents, timeout);
+        reactor.fWakeupNeeded = false;
+        if (interruptNet) {
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            auto& e = events[i];
+            if (e.data.ptr == nullptr) {
+                // drain the wakeup pipe
+                char buf[128];
+                while (read(reactor.wakeupPipe[0], buf, sizeof(buf)) > 0) {}
+                continue;
+            }
+            CNode* pnode = static_cast<CNode*>(e.data.ptr);
+            if ((e.events & EPOLLERR) || (e.events & EPOLLHUP)) {
+                vErrorNodes.emplace_back(pnode);
+                continue;
+            }
+            if (e.events & EPOLLIN) {
+                pnode->fHasRecvData = true;
+                setReceivable.emplace(pnode);
+            }
+            if (e.events & EPOLLOUT) {
+                pnode->fCanSendData = true;
+                if (setSendable.emplace(pnode).second && pnode->nSendMsgSize != 0) {
+                    vSendNodes.emplace_back(pnode);
+                }
+            }
+        }
+
+        for (CNode* pnode : vErrorNodes) {
+            // let recv() return errors and then handle it
+            SocketRecvData(pnode);
+        }
+        vErrorNodes.clear();
+
+        // As in SocketHandler, drain the send buffer of a peer before receiving more from it
+        for (auto it = setReceivable.begin(); it != setReceivable.end() && !interruptNet; ) {
+            CNode* pnode = *it;
+            if (!pnode->fHasRecvData) {
+                it = setReceivable.erase(it);
+                continue;
+            }
+            if (!pnode->fPauseRecv && pnode->nSendMsgSize == 0 && !pnode->fDisconnect) {
+                SocketRecvData(pnode);
+            }
+            ++it;
+        }
+
+        for (CNode* pnode : vSendNodes) {
+            if (interruptNet) {
+                break;
+            }
+            LOCK(pnode->cs_vSend);
+            size_t nBytes = SocketSendData(pnode);
+            if (nBytes) {
+                RecordBytesSent(nBytes);
+            }
+            if (pnode->vSendMsg.empty()) {
+                LOCK(reactor.cs);
+                reactor.setNodesWithDataToSend.erase(pnode);
+            }
+            if (!pnode->fCanSendData) {
+                setSendable.erase(pnode);
+            }
+        }
+        vSendNodes.clear();
+    }
+}
+
+void CConnman::WakeSocketReactor(size_t nReactor)
+{
+    SocketReactor& reactor = *vSocketReactors[nReactor];
+    if (!reactor.fWakeupNeeded || reactor.wakeupPipe[1] == -1) {
+        return;
+    }
+
+    char buf[1];
+    if (write(reactor.wakeupPipe[1], buf, 1) != 1) {
+        LogPrint(BCLog::NET, "write to wakeupPipe of socket reactor %d failed\n", nReactor);
+    }
+}
+#endif
+
 void CConnman::WakeMessageHandler()
 {
     {
@@ -2744,6 +3023,70 @@ void CConnman::ThreadMessageHandler()
     }
 }
 
+void CConnman::ScheduleConcurrentMessages(CNode* pnode, size_t nMsgs, bool fSchedule)
+{
+    MessageHandlerShard& shard = *vMessageHandlerShards[pnode->GetId() % vMessageHandlerShards.size()];
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.nQueuedMsgs += nMsgs;
+        shard.nMaxQueuedMsgs = std::max(shard.nMaxQueuedMsgs, shard.nQueuedMsgs);
+        if (!fSchedule) {
+            return;
+        }
+        pnode->AddRef();
+        shard.vReadyNodes.push_back(pnode);
+    }
+    shard.cond.notify_one();
+}
+
+void CConnman::ThreadMessageHandlerShard(size_t nShard)
+{
+    MessageHandlerShard& shard = *vMessageHandlerShards[nShard];
+
+    while (!flagInterruptMsgProc)
+    {
+        CNode* pnode;
+        {
+            std::unique_lock<std::mutex> lock(shard.mutex);
+            shard.cond.wait(lock, [&] { return !shard.vReadyNodes.empty() || flagInterruptMsgProc; });
+            if (flagInterruptMsgProc)
+                return;
+            pnode = shard.vReadyNodes.front();
+            shard.vReadyNodes.pop_front();
+        }
+
+        int64_t nTimeStart = GetTimeMicros();
+        bool fProcessed = !pnode->fDisconnect && m_msgproc->ProcessConcurrentMessage(pnode, flagInterruptMsgProc);
+        int64_t nTime = GetTimeMicros() - nTimeStart;
+
+        size_t nDropped = 0;
+        bool fMoreWork;
+        {
+            LOCK(pnode->cs_vProcessMsg);
+            if (pnode->fDisconnect) {
+                nDropped = pnode->vProcessMsgConcurrent.size();
+                pnode->vProcessMsgConcurrent.clear();
+            }
+            fMoreWork = !pnode->vProcessMsgConcurrent.empty();
+            pnode->fProcessMsgConcurrentScheduled = fMoreWork;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.nQueuedMsgs -= nDropped + (fProcessed ? 1 : 0);
+            shard.nProcessedMsgs += fProcessed ? 1 : 0;
+            shard.nProcessTimeMicros += nTime;
+            if (fMoreWork) {
+                // go to the back of the queue so that a single peer can't starve the others
+                shard.vReadyNodes.push_back(pnode);
+            }
+        }
+        if (!fMoreWork) {
+            pnode->Release();
+        }
+    }
+}
+
 
 
 
@@ -3052,6 +3395,12 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         fMsgProcWake = false;
     }
 
+    // The socket handler hands messages to these, so they must exist before it starts
+    vMessageHandlerShards.clear();
+    for (int i = 0; i < nMessageHandlerThreads; i++) {
+        vMessageHandlerShards.emplace_back(new MessageHandlerShard());
+    }
+
 #ifdef USE_WAKEUP_PIPE
     if (pipe(wakeupPipe) != 0) {
         wakeupPipe[0] = wakeupPipe[1] = -1;
@@ -3081,6 +3430,46 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     }
 #endif
 
+#ifdef USE_EPOLL
+    // Peers are assigned to the reactors when they get registered, so these must exist before the first connection
+    vSocketReactors.clear();
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        for (int i = 0; i < nSocketThreads; i++) {
+            std::unique_ptr<SocketReactor> reactor(new SocketReactor());
+            reactor->epollfd = epoll_create1(0);
+            if (reactor->epollfd == -1) {
+                LogPrintf("epoll_create1 failed\n");
+                return false;
+            }
+            if (pipe(reactor->wakeupPipe) != 0) {
+                reactor->wakeupPipe[0] = reactor->wakeupPipe[1] = -1;
+                LogPrint(BCLog::NET, "pipe() for wakeupPipe of socket reactor %d failed\n", i);
+            } else {
+                for (int fd : reactor->wakeupPipe) {
+                    int fFlags = fcntl(fd, F_GETFL, 0);
+                    if (fcntl(fd, F_SETFL, fFlags | O_NONBLOCK) == -1) {
+                        LogPrint(BCLog::NET, "fcntl for O_NONBLOCK on wakeupPipe of socket reactor %d failed\n", i);
+                    }
+                }
+                epoll_event event;
+                event.events = EPOLLIN;
+                event.data.ptr = nullptr;
+                if (epoll_ctl(reactor->epollfd, EPOLL_CTL_ADD, reactor->wakeupPipe[0], &event) != 0) {
+                    LogPrint(BCLog::NET, "%s -- epoll_ctl(%d, %d, %d, ...) failed. error: %s\n", __func__,
+                             reactor->epollfd, EPOLL_CTL_ADD, reactor->wakeupPipe[0], NetworkErrorString(WSAGetLastError()));
+                    return false;
+                }
+            }
+            vSocketReactors.emplace_back(std::move(reactor));
+        }
+        for (size_t i = 0; i < vSocketReactors.size(); i++) {
+            vSocketReactors[i]->thread = std::thread(&TraceThread<std::function<void()> >, strprintf("net.%d", i), std::function<void()>(std::bind(&CConnman::ThreadSocketReactor, this, i)));
+        }
+    } else if (nSocketThreads > 0) {
+        LogPrintf("Socket threads are only supported with -socketevents=epoll, handling all sockets in the network thread\n");
+    }
+#endif
+
     // Send and receive from sockets, accept connections
     threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
 
@@ -3108,6 +3497,9 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     // Process messages
     threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    for (size_t i = 0; i < vMessageHandlerShards.size(); i++) {
+        vMessageHandlerShards[i]->thread = std::thread(&TraceThread<std::function<void()> >, strprintf("msghand.%d", i), std::function<void()>(std::bind(&CConnman::ThreadMessageHandlerShard, this, i)));
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery(std::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL * 1000);
@@ -3145,9 +3537,19 @@ void CConnman::Interrupt()
         flagInterruptMsgProc = true;
     }
     condMsgProc.notify_all();
+    for (auto& shard : vMessageHandlerShards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->cond.notify_all();
+    }
 
     interruptNet();
     InterruptSocks5(true);
+#ifdef USE_EPOLL
+    for (size_t i = 0; i < vSocketReactors.size(); i++) {
+        vSocketReactors[i]->fWakeupNeeded = true;
+        WakeSocketReactor(i);
+    }
+#endif
 
     if (semOutbound) {
         for (int i=0; i<(nMaxOutbound + nMaxFeeler); i++) {
@@ -3166,6 +3568,10 @@ void CConnman::Stop()
 {
     if (threadMessageHandler.joinable())
         threadMessageHandler.join();
+    for (auto& shard : vMessageHandlerShards) {
+        if (shard->thread.joinable())
+            shard->thread.join();
+    }
     if (threadOpenMasternodeConnections.joinable())
         threadOpenMasternodeConnections.join();
     if (threadOpenConnections.joinable())
@@ -3176,6 +3582,12 @@ void CConnman::Stop()
         threadDNSAddressSeed.join();
     if (threadSocketHandler.joinable())
         threadSocketHandler.join();
+#ifdef USE_EPOLL
+    for (auto& reactor : vSocketReactors) {
+        if (reactor->thread.joinable())
+            reactor->thread.join();
+    }
+#endif
 
     if (fAddressesInitialized)
     {
@@ -3202,6 +3614,29 @@ void CConnman::Stop()
         }
 
     // clean up some globals (to help leak detection)
+    for (auto& shard : vMessageHandlerShards) {
+        for (CNode* pnode : shard->vReadyNodes) {
+            pnode->Release();
+        }
+    }
+    vMessageHandlerShards.clear();
+#ifdef USE_EPOLL
+    for (auto& reactor : vSocketReactors) {
+        {
+            LOCK(reactor->cs);
+            for (CNode* pnode : reactor->setNodes) {
+                pnode->Release();
+            }
+            for (CNode* pnode : reactor->vRemovedNodes) {
+                pnode->Release();
+            }
+        }
+        close(reactor->epollfd);
+        if (reactor->wakeupPipe[0] != -1) close(reactor->wakeupPipe[0]);
+        if (reactor->wakeupPipe[1] != -1) close(reactor->wakeupPipe[1]);
+    }
+    vSocketReactors.clear();
+#endif
     for (CNode *pnode : vNodes) {
         DeleteNode(pnode);
     }
@@ -3441,6 +3876,16 @@ void CConnman::GetNodeStats(std::vector<CNodeStats>& vstats)
     }
 }
 
+void CConnman::GetMessageHandlerShardStats(std::vector<CMessageHandlerShardStats>& vstats)
+{
+    vstats.clear();
+    vstats.reserve(vMessageHandlerShards.size());
+    for (auto& shard : vMessageHandlerShards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        vstats.push_back({shard->vReadyNodes.size(), shard->nQueuedMsgs, shard->nMaxQueuedMsgs, shard->nProcessedMsgs, shard->nProcessTimeMicros});
+    }
+}
+
 bool CConnman::DisconnectNode(const std::string& strNode)
 {
     LOCK(cs_vNodes);
@@ -3730,19 +4175,30 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
     return pnode && pnode->fSuccessfullyConnected && !pnode->fDisconnect;
 }
 
-void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+CSendMsgBufferRef MakeSendMsgBuffer(CSerializedNetMsg&& msg)
 {
-    size_t nMessageSize = msg.data.size();
-    size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
-    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
-
-    std::vector<unsigned char> serializedHeader;
-    serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
-    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
+    auto buf = std::make_shared<CSendMsgBuffer>();
+    uint256 hash = Hash(msg.data.data(), msg.data.data() + msg.data.size());
+    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), msg.data.size());
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
-    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
+    buf->header.reserve(CMessageHeader::HEADER_SIZE);
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, buf->header, 0, hdr};
+    buf->command = std::move(msg.command);
+    buf->data = std::move(msg.data);
+    return buf;
+}
+
+void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
+{
+    PushMessage(pnode, MakeSendMsgBuffer(std::move(msg)));
+}
+
+void CConnman::PushMessage(CNode* pnode, const CSendMsgBufferRef& msg)
+{
+    size_t nMessageSize = msg->data.size();
+    size_t nTotalSize = msg->size();
+    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg->command.c_str()), nMessageSize, pnode->GetId());
 
     size_t nBytesSent = 0;
     {
@@ -3750,16 +4206,31 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         bool hasPendingData = !pnode->vSendMsg.empty();
 
         //log total amount of bytes per command
-        pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
+        pnode->mapSendBytesPerMsgCmd[msg->command] += nTotalSize;
         pnode->nSendSize += nTotalSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->vSendMsg.push_back(msg);
         pnode->nSendMsgSize = pnode->vSendMsg.size();
 
+#ifdef USE_EPOLL
+        int nReactor = pnode->nSocketReactor;
+        if (nReactor != -1) {
+            {
+                SocketReactor& reactor = *vSocketReactors[nReactor];
+                LOCK(reactor.cs);
+                if (reactor.setNodes.count(pnode)) {
+                    reactor.setNodesWithDataToSend.emplace(pnode);
+                }
+            }
+            if (!hasPendingData) {
+                WakeSocketReactor(nReactor);
+            }
+            return;
+        }
+#endif
+
         {
             LOCK(cs_mapNodesWithDataToSend);
             // we're not holding cs_vNodes here, so there is a chance of this node being disconnected shortly before
@@ -3874,18 +4345,37 @@ void CConnman::RegisterEvents(CNode *pnode)
         return;
     }
 
-    LOCK(pnode->cs_hSocket);
+    // cs_vSend makes sure that PushMessage either sees the reactor or queued its message before we look at vSendMsg
+    LOCK2(pnode->cs_vSend, pnode->cs_hSocket);
     assert(pnode->hSocket != INVALID_SOCKET);
 
     epoll_event e;
     // We're using edge-triggered mode, so it's important that we drain sockets even if no signals come in
     e.events = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLERR | EPOLLHUP;
     e.data.fd = pnode->hSocket;
+    int fd = epollfd;
 
-    int r = epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &e);
+    if (!vSocketReactors.empty()) {
+        int nReactor = pnode->GetId() % vSocketReactors.size();
+        SocketReactor& reactor = *vSocketReactors[nReactor];
+        {
+            LOCK(reactor.cs);
+            reactor.setNodes.emplace(pnode);
+            if (!pnode->vSendMsg.empty()) {
+                reactor.setNodesWithDataToSend.emplace(pnode);
+            }
+        }
+        pnode->AddRef();
+        pnode->nSocketReactor = nReactor;
+        // reactors get the node instead of the socket, it stays valid until the reactor released its reference
+        e.data.ptr = pnode;
+        fd = reactor.epollfd;
+    }
+
+    int r = epoll_ctl(fd, EPOLL_CTL_ADD, pnode->hSocket, &e);
     if (r != 0) {
         LogPrint(BCLog::NET, "%s -- epoll_ctl(%d, %d, %d, ...) failed. error: %s\n", __func__,
-                epollfd, EPOLL_CTL_ADD, pnode->hSocket, NetworkErrorString(WSAGetLastError()));
+                fd, EPOLL_CTL_ADD, pnode->hSocket, NetworkErrorString(WSAGetLastError()));
     }
 #endif
 }
@@ -3902,10 +4392,24 @@ void CConnman::UnregisterEvents(CNode *pnode)
         return;
     }
 
-    int r = epoll_ctl(epollfd, EPOLL_CTL_DEL, pnode->hSocket, nullptr);
+    int nReactor = pnode->nSocketReactor;
+    int fd = nReactor != -1 ? vSocketReactors[nReactor]->epollfd : epollfd;
+    int r = epoll_ctl(fd, EPOLL_CTL_DEL, pnode->hSocket, nullptr);
     if (r != 0) {
         LogPrint(BCLog::NET, "%s -- epoll_ctl(%d, %d, %d, ...) failed. error: %s\n", __func__,
-                epollfd, EPOLL_CTL_DEL, pnode->hSocket, NetworkErrorString(WSAGetLastError()));
+                fd, EPOLL_CTL_DEL, pnode->hSocket, NetworkErrorString(WSAGetLastError()));
+    }
+
+    if (nReactor != -1) {
+        SocketReactor& reactor = *vSocketReactors[nReactor];
+        {
+            LOCK(reactor.cs);
+            if (reactor.setNodes.erase(pnode)) {
+                reactor.setNodesWithDataToSend.erase(pnode);
+                reactor.vRemovedNodes.emplace_back(pnode);
+            }
+        }
+        WakeSocketReactor(nReactor);
     }
 #endif
 }
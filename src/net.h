@@ -31,6 +31,7 @@
 #include <thread>
 #include <memory>
 #include <condition_variable>
+#include <mutex>
 #include <unordered_set>
 #include <queue>
 
@@ -94,6 +95,12 @@ static const bool DEFAULT_BLOCKSONLY = false;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Default number of threads processing LLMQ, InstantSend and governance messages next to the main message handler */
+static const int DEFAULT_MSGHAND_THREADS = 2;
+static const int MAX_MSGHAND_THREADS = 16;
+/** Default number of threads handling the sockets of peers with -socketevents=epoll, 0 means the network thread does it */
+static const int DEFAULT_SOCKET_THREADS = 0;
+static const int MAX_SOCKET_THREADS = 16;
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
@@ -116,6 +123,47 @@ struct AddedNodeInfo
     bool fInbound;
 };
 
+struct CMessageHandlerShardStats
+{
+    size_t nReadyNodes;
+    uint64_t nQueuedMsgs;
+    uint64_t nMaxQueuedMsgs;
+    uint64_t nProcessedMsgs;
+    int64_t nProcessTimeMicros;
+};
+
+/** Receive buffer usage of the messages with one command */
+struct CRecvBufferStats
+{
+    uint64_t nReused{0};    // messages received into a pooled buffer which was large enough
+    uint64_t nAllocated{0}; // messages for which memory had to be allocated
+};
+
+/**
+ * Buffers of processed messages are given back to this pool and reused to receive the following messages, so that
+ * the steady stream of messages from all peers doesn't cause an allocation (and zeroing on free) per message.
+ */
+class CRecvBufferPool
+{
+public:
+    static const size_t MAX_BUFFERS = 256;
+    static const size_t MAX_BUFFER_SIZE = 4 * 1024 * 1024;
+    static const size_t MAX_TOTAL_SIZE = 32 * 1024 * 1024;
+
+    /** Returns the smallest pooled buffer which can hold nSize bytes, or an empty one without capacity */
+    CSerializeData Get(size_t nSize);
+    void Put(CSerializeData&& buf);
+    void RecordMessage(const std::string& strCommand, bool fAllocated);
+    void GetStats(std::map<std::string, CRecvBufferStats>& mapStatsOut, size_t& nBuffersOut, size_t& nTotalSizeOut);
+
+private:
+    std::mutex mutex;
+    std::vector<CSerializeData> vBuffers;
+    size_t nTotalSize{0};
+    std::map<std::string, CRecvBufferStats> mapStats;
+};
+extern CRecvBufferPool g_recv_buffer_pool;
+
 class CNodeStats;
 class CClientUIInterface;
 
@@ -132,6 +180,24 @@ struct CSerializedNetMsg
     std::string command;
 };
 
+/**
+ * A message serialized together with its header, ready to be put on the wire. The buffer is immutable, so the same
+ * one can be queued for any number of peers without copying it (e.g. a block, ISLOCK or CLSIG relayed to all quorum
+ * connections).
+ */
+struct CSendMsgBuffer
+{
+    std::string command;
+    std::vector<unsigned char> header;
+    std::vector<unsigned char> data;
+
+    size_t size() const { return header.size() + data.size(); }
+};
+typedef std::shared_ptr<const CSendMsgBuffer> CSendMsgBufferRef;
+
+/** Computes the header (and its checksum) of msg once, so that the result can be pushed to many peers */
+CSendMsgBufferRef MakeSendMsgBuffer(CSerializedNetMsg&& msg);
+
 class NetEventsInterface;
 class CConnman
 {
@@ -172,6 +238,8 @@ public:
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
         SocketEventsMode socketEventsMode = SOCKETEVENTS_SELECT;
+        int nMessageHandlerThreads = 0;
+        int nSocketThreads = 0;
     };
 
     void Init(const Options& connOptions) {
@@ -196,6 +264,8 @@ public:
             vAddedNodes = connOptions.m_added_nodes;
         }
         socketEventsMode = connOptions.socketEventsMode;
+        nMessageHandlerThreads = connOptions.nMessageHandlerThreads;
+        nSocketThreads = connOptions.nSocketThreads;
     }
 
     CConnman(uint64_t seed0, uint64_t seed1);
@@ -249,6 +319,7 @@ public:
     bool IsMasternodeOrDisconnectRequested(const CService& addr);
 
     void PushMessage(CNode* pnode, CSerializedNetMsg&& msg);
+    void PushMessage(CNode* pnode, const CSendMsgBufferRef& msg);
 
     template<typename Condition, typename Callable>
     bool ForEachNodeContinueIf(const Condition& cond, Callable&& func)
@@ -421,6 +492,7 @@ public:
     size_t GetNodeCount(NumConnections num);
     size_t GetMaxOutboundNodeCount();
     void GetNodeStats(std::vector<CNodeStats>& vstats);
+    void GetMessageHandlerShardStats(std::vector<CMessageHandlerShardStats>& vstats);
     bool DisconnectNode(const std::string& node);
     bool DisconnectNode(NodeId id);
 
@@ -483,6 +555,9 @@ private:
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
     void ThreadMessageHandler();
+    void ThreadMessageHandlerShard(size_t nShard);
+    /** Hand messages queued in pnode->vProcessMsgConcurrent to the shard of pnode */
+    void ScheduleConcurrentMessages(CNode* pnode, size_t nMsgs, bool fSchedule);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
@@ -498,6 +573,10 @@ private:
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set, bool fOnlyPoll);
     void SocketHandler();
     void ThreadSocketHandler();
+#ifdef USE_EPOLL
+    void ThreadSocketReactor(size_t nReactor);
+    void WakeSocketReactor(size_t nReactor);
+#endif
     void ThreadDNSAddressSeed();
     void ThreadOpenMasternodeConnections();
 
@@ -629,6 +708,47 @@ private:
     std::thread threadOpenMasternodeConnections;
     std::thread threadMessageHandler;
 
+    /**
+     * Threads processing the messages for which NetEventsInterface::IsConcurrentMessage returns true, next to
+     * threadMessageHandler. Peers are assigned to shards by id, so messages of one peer are processed in order.
+     */
+    struct MessageHandlerShard
+    {
+        std::mutex mutex;
+        std::condition_variable cond;
+        /** Peers with queued messages, each holding a reference. Processed round robin, one message at a time */
+        std::deque<CNode*> vReadyNodes;
+        uint64_t nQueuedMsgs{0};
+        uint64_t nMaxQueuedMsgs{0};
+        uint64_t nProcessedMsgs{0};
+        int64_t nProcessTimeMicros{0};
+        std::thread thread;
+    };
+    int nMessageHandlerThreads;
+    std::vector<std::unique_ptr<MessageHandlerShard>> vMessageHandlerShards;
+
+#ifdef USE_EPOLL
+    /**
+     * Threads sending and receiving for a disjoint set of peers (assigned by id) with their own edge-triggered epoll
+     * instance. threadSocketHandler then only accepts connections and disconnects peers.
+     */
+    struct SocketReactor
+    {
+        int epollfd{-1};
+        int wakeupPipe[2]{-1, -1};
+        std::atomic<bool> fWakeupNeeded{false};
+        CCriticalSection cs;
+        /** Registered peers. The reactor holds a reference to each until its thread processed the removal */
+        std::unordered_set<CNode*> setNodes GUARDED_BY(cs);
+        std::vector<CNode*> vRemovedNodes GUARDED_BY(cs);
+        /** Registered peers with messages in vSendMsg */
+        std::unordered_set<CNode*> setNodesWithDataToSend GUARDED_BY(cs);
+        std::thread thread;
+    };
+    std::vector<std::unique_ptr<SocketReactor>> vSocketReactors;
+#endif
+    int nSocketThreads;
+
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of nMaxOutbound
      *  This takes the place of a feeler connection */
@@ -667,6 +787,10 @@ class NetEventsInterface
 public:
     virtual bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) = 0;
     virtual bool SendMessages(CNode* pnode, std::atomic<bool>& interrupt) = 0;
+    /** Whether messages of this type can be processed by ProcessConcurrentMessage */
+    virtual bool IsConcurrentMessage(const std::string& strCommand) const = 0;
+    /** Process one message from pnode->vProcessMsgConcurrent, returns false if there was none */
+    virtual bool ProcessConcurrentMessage(CNode* pnode, std::atomic<bool>& interrupt) = 0;
     virtual void InitializeNode(CNode* pnode) = 0;
     virtual void FinalizeNode(NodeId id, bool& update_connection_time) = 0;
 };
@@ -759,22 +883,26 @@ private:
 public:
     bool in_data;                   // parsing header (false) or data (true)
 
-    CDataStream hdrbuf;             // partially received header
+    unsigned char hdrbuf[CMessageHeader::HEADER_SIZE]; // partially received header
     CMessageHeader hdr;             // complete header
     unsigned int nHdrPos;
 
-    CDataStream vRecv;              // received message data
+    CDataStream vRecv;              // received message data, taken from and given back to g_recv_buffer_pool
     unsigned int nDataPos;
+    bool fAllocated;                // whether receiving the data needed to allocate memory
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
-    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
-        hdrbuf.resize(24);
+    CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
         in_data = false;
         nHdrPos = 0;
         nDataPos = 0;
+        fAllocated = false;
         nTime = 0;
     }
+    CNetMessage(CNetMessage&&) = default;
+    CNetMessage& operator=(CNetMessage&&) = default;
+    ~CNetMessage();
 
     bool complete() const
     {
@@ -787,7 +915,6 @@ public:
 
     void SetVersion(int nVersionIn)
     {
-        hdrbuf.SetVersion(nVersionIn);
         vRecv.SetVersion(nVersionIn);
     }
 
@@ -805,16 +932,21 @@ public:
     std::atomic<ServiceFlags> nServices;
     SOCKET hSocket GUARDED_BY(cs_hSocket);
     size_t nSendSize; // total size of all vSendMsg entries
-    size_t nSendOffset; // offset inside the first vSendMsg already sent
+    size_t nSendOffset; // offset inside the first vSendMsg (header and data) already sent
     uint64_t nSendBytes GUARDED_BY(cs_vSend);
-    std::list<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    std::deque<CSendMsgBufferRef> vSendMsg GUARDED_BY(cs_vSend);
     std::atomic<size_t> nSendMsgSize;
+    /** Index of the socket reactor handling this peer, -1 if it's handled by the network thread */
+    std::atomic<int> nSocketReactor{-1};
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
 
     CCriticalSection cs_vProcessMsg;
     std::list<CNetMessage> vProcessMsg GUARDED_BY(cs_vProcessMsg);
+    /** Messages processed by a message handler shard instead of the main message handler */
+    std::list<CNetMessage> vProcessMsgConcurrent GUARDED_BY(cs_vProcessMsg);
+    bool fProcessMsgConcurrentScheduled GUARDED_BY(cs_vProcessMsg){false};
     size_t nProcessQueueSize;
 
     CCriticalSection cs_sendProcessing;
@@ -896,9 +1028,9 @@ public:
 
     // inventory based relay
     CRollingBloomFilter filterInventoryKnown GUARDED_BY(cs_inventory);
-    // Set of transaction ids we still have to announce.
-    // They are sorted by the mempool before relay, so the order is not important.
-    std::set<uint256> setInventoryTxToSend;
+    // Transaction ids we still have to announce.
+    // They are sorted by the mempool before relay (see CTxRelayOrder), which also drops duplicates.
+    std::vector<uint256> vInventoryTxToSend;
     // List of block ids we still have announce.
     // There is no final sorting before sending, as they are always sent immediately
     // and in the order requested.
@@ -1057,7 +1189,7 @@ public:
         if (inv.type == MSG_TX || inv.type == MSG_DSTX) {
             if (!filterInventoryKnown.contains(inv.hash)) {
                 LogPrint(BCLog::NET, "PushInventory --  inv: %s peer=%d\n", inv.ToString(), id);
-                setInventoryTxToSend.insert(inv.hash);
+                vInventoryTxToSend.push_back(inv.hash);
             } else {
                 LogPrint(BCLog::NET, "PushInventory --  filtered inv: %s peer=%d\n", inv.ToString(), id);
             }
@@ -27,6 +27,7 @@
 #include <txdb.h>
 #include <txmempool.h>
 #include <ui_interface.h>
+#include <unordered_lru_cache.h>
 #include <util.h>
 #include <utilmoneystr.h>
 #include <utilstrencodings.h>
@@ -193,6 +194,8 @@ namespace {
     MapRelay mapRelay;
     /** Expiration-time ordered list of (expire time, relay map entry) pairs, protected by cs_main). */
     std::deque<std::pair<int64_t, MapRelay::iterator>> vRelayExpiration;
+    /** Mempool order of the transactions to announce, protected by cs_main. */
+    CTxRelayOrder txRelayOrder;
 } // namespace
 
 namespace {
@@ -1020,6 +1023,36 @@ unsigned int LimitOrphanTxSize(unsigned int nMaxOrphansSize)
 
 void static ProcessOrphanTx(CConnman* connman, std::set<uint256>& orphan_work_set) EXCLUSIVE_LOCKS_REQUIRED(cs_main, g_cs_orphans);
 
+/**
+ * Deserialize the TX messages which directly follow the one being processed in the receive queue of pfrom and
+ * append them to txs, up to a total of MAX_TX_PREVERIFY_BATCH transactions. The queue itself is left untouched.
+ */
+static void PeekQueuedTransactions(CNode* pfrom, std::vector<CTransactionRef>& txs)
+{
+    std::vector<CDataStream> vRecvs;
+    {
+        LOCK(pfrom->cs_vProcessMsg);
+        for (const CNetMessage& msg : pfrom->vProcessMsg) {
+            if (txs.size() + vRecvs.size() >= MAX_TX_PREVERIFY_BATCH || msg.hdr.GetCommand() != NetMsgType::TX) {
+                break;
+            }
+            vRecvs.emplace_back(msg.vRecv);
+        }
+    }
+
+    for (CDataStream& vRecv : vRecvs) {
+        vRecv.SetVersion(pfrom->GetRecvVersion());
+        try {
+            CTransactionRef ptx;
+            vRecv >> ptx;
+            txs.emplace_back(std::move(ptx));
+        } catch (const std::exception&) {
+            // ProcessMessages will deal with it once it gets there
+            break;
+        }
+    }
+}
+
 // Requires cs_main.
 void Misbehaving(NodeId pnode, int howmuch, const std::string& message)
 {
@@ -1141,10 +1174,28 @@ static CCriticalSection cs_most_recent_block;
 static std::shared_ptr<const CBlock> most_recent_block;
 static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block;
 static uint256 most_recent_block_hash;
+// Serialized BLOCK and CMPCTBLOCK messages of most_recent_block, shared by all peers we send them to. Neither message
+// depends on the peer's protocol version. The BLOCK message is only created when the first peer asks for it.
+static CSendMsgBufferRef most_recent_block_msg;
+static CSendMsgBufferRef most_recent_compact_block_msg;
+
+/** Returns the serialized BLOCK message for pblock, which is shared between peers if pblock is the most recent block */
+static CSendMsgBufferRef GetBlockMsg(const std::shared_ptr<const CBlock>& pblock, const CNetMsgMaker& msgMaker)
+{
+    LOCK(cs_most_recent_block);
+    if (pblock != most_recent_block) {
+        return MakeSendMsgBuffer(msgMaker.Make(NetMsgType::BLOCK, *pblock));
+    }
+    if (!most_recent_block_msg) {
+        most_recent_block_msg = MakeSendMsgBuffer(msgMaker.Make(NetMsgType::BLOCK, *pblock));
+    }
+    return most_recent_block_msg;
+}
 
 void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) {
     std::shared_ptr<const CBlockHeaderAndShortTxIDs> pcmpctblock = std::make_shared<const CBlockHeaderAndShortTxIDs> (*pblock);
     const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    CSendMsgBufferRef cmpctblockMsg = MakeSendMsgBuffer(msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
 
     LOCK(cs_main);
 
@@ -1160,10 +1211,11 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
         most_recent_block_hash = hashBlock;
         most_recent_block = pblock;
         most_recent_compact_block = pcmpctblock;
+        most_recent_block_msg = nullptr;
+        most_recent_compact_block_msg = cmpctblockMsg;
     }
 
-    connman->ForEachNode([this, &pcmpctblock, pindex, &msgMaker, &hashBlock](CNode* pnode) {
-        // TODO: Avoid the repeated-serialization here
+    connman->ForEachNode([this, &cmpctblockMsg, pindex, &hashBlock](CNode* pnode) {
         if (pnode->fDisconnect)
             return;
         ProcessBlockAvailability(pnode->GetId());
@@ -1175,7 +1227,7 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
 
             LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->GetId());
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            connman->PushMessage(pnode, cmpctblockMsg);
             state.pindexBestHeaderSent = pindex;
         }
     });
@@ -1382,11 +1434,13 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
     bool send = false;
     std::shared_ptr<const CBlock> a_recent_block;
     std::shared_ptr<const CBlockHeaderAndShortTxIDs> a_recent_compact_block;
+    CSendMsgBufferRef a_recent_compact_block_msg;
     const Consensus::Params& consensusParams = chainparams.GetConsensus();
     {
         LOCK(cs_most_recent_block);
         a_recent_block = most_recent_block;
         a_recent_compact_block = most_recent_compact_block;
+        a_recent_compact_block_msg = most_recent_compact_block_msg;
     }
 
     bool need_activate_chain = false;
@@ -1456,7 +1510,7 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
         }
         if (pblock) {
             if (inv.type == MSG_BLOCK)
-                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
+                connman->PushMessage(pfrom, GetBlockMsg(pblock, msgMaker));
             else if (inv.type == MSG_FILTERED_BLOCK) {
                 bool sendMerkleBlock = false;
                 CMerkleBlock merkleBlock;
@@ -1490,13 +1544,13 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
                     mi->second->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH) {
                     if (a_recent_compact_block &&
                         a_recent_compact_block->header.GetHash() == mi->second->GetBlockHash()) {
-                        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
+                        connman->PushMessage(pfrom, a_recent_compact_block_msg);
                     } else {
                         CBlockHeaderAndShortTxIDs cmpctblock(*pblock);
                         connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, cmpctblock));
                     }
                 } else {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
+                    connman->PushMessage(pfrom, GetBlockMsg(pblock, msgMaker));
                 }
             }
         }
@@ -1514,6 +1568,24 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
     }
 }
 
+// Serialized QSIGREC, CLSIG and ISLOCK messages. These are requested by many peers (e.g. all quorum connections of a
+// masternode) right after each other and don't depend on the peer's protocol version, so each is only serialized once.
+static CCriticalSection cs_llmq_getdata_msgs;
+static unordered_lru_cache<std::pair<int, uint256>, CSendMsgBufferRef, StaticSaltedHasher, 1024> llmq_getdata_msgs GUARDED_BY(cs_llmq_getdata_msgs);
+
+template <typename T>
+static CSendMsgBufferRef GetLLMQGetDataMsg(const CInv& inv, const char* command, const T& o, const CNetMsgMaker& msgMaker)
+{
+    auto key = std::make_pair(inv.type, inv.hash);
+    LOCK(cs_llmq_getdata_msgs);
+    CSendMsgBufferRef msg;
+    if (!llmq_getdata_msgs.get(key, msg)) {
+        msg = MakeSendMsgBuffer(msgMaker.Make(command, o));
+        llmq_getdata_msgs.insert(key, msg);
+    }
+    return msg;
+}
+
 void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnman* connman, const std::atomic<bool>& interruptMsgProc)
 {
     AssertLockNotHeld(cs_main);
@@ -1651,7 +1723,7 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
             if (!push && (inv.type == MSG_QUORUM_RECOVERED_SIG)) {
                 llmq::CRecoveredSig o;
                 if (llmq::quorumSigningManager->GetRecoveredSigForGetData(inv.hash, o)) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::QSIGREC, o));
+                    connman->PushMessage(pfrom, GetLLMQGetDataMsg(inv, NetMsgType::QSIGREC, o, msgMaker));
                     push = true;
                 }
             }
@@ -1659,7 +1731,7 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
             if (!push && (inv.type == MSG_CLSIG)) {
                 llmq::CChainLockSig o;
                 if (llmq::chainLocksHandler->GetChainLockByHash(inv.hash, o)) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CLSIG, o));
+                    connman->PushMessage(pfrom, GetLLMQGetDataMsg(inv, NetMsgType::CLSIG, o, msgMaker));
                     push = true;
                 }
             }
@@ -1667,7 +1739,7 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
             if (!push && (inv.type == MSG_ISLOCK)) {
                 llmq::CInstantSendLock o;
                 if (llmq::quorumInstantSendManager->GetInstantSendLockByHash(inv.hash, o)) {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::ISLOCK, o));
+                    connman->PushMessage(pfrom, GetLLMQGetDataMsg(inv, NetMsgType::ISLOCK, o, msgMaker));
                     push = true;
                 }
             }
@@ -2739,6 +2811,17 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             EraseObjectRequest(pfrom->GetId(), inv);
         }
 
+        // Verify the scripts of this and the transactions queued behind it in parallel and without holding cs_main.
+        // AcceptToMemoryPool then finds the signatures in the cache, leaving only the cheap checks and the insertion
+        // serialized. A transaction which is already pre-verified was part of the batch of an earlier TX message of
+        // this peer, so the queue behind it was peeked already and peeking it again would make draining a queue of N
+        // transactions O(N^2).
+        if (nScriptCheckThreads && !IsTransactionPreVerified(tx.GetHash())) {
+            std::vector<CTransactionRef> batch{ptx};
+            PeekQueuedTransactions(pfrom, batch);
+            PreVerifyTransactions(mempool, batch);
+        }
+
         // Process custom logic, no matter if tx will be accepted to mempool later or not
         if (nInvType == MSG_DSTX) {
             uint256 hashTx = tx.GetHash();
@@ -3542,6 +3625,79 @@ static bool SendRejectsAndCheckIfBanned(CNode* pnode, CConnman* connman)
     return false;
 }
 
+/**
+ * Call a message handler. Exceptions from parsing the message are answered with a REJECT and logged, any other
+ * exception is only logged. Returns what the handler returned, or false if it threw.
+ */
+template<typename Callable>
+static bool CallMessageHandler(CNode* pfrom, const std::string& strCommand, unsigned int nMessageSize, CConnman* connman, const char* pszCaller, Callable&& handler)
+{
+    try
+    {
+        return handler();
+    }
+    catch (const std::ios_base::failure& e)
+    {
+        if (g_enable_bip61) {
+            connman->PushMessage(pfrom, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::REJECT, strCommand, REJECT_MALFORMED, std::string("error parsing message")));
+        }
+        if (strstr(e.what(), "end of data"))
+        {
+            // Allow exceptions from under-length message on vRecv
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught, normally caused by a message being shorter than its stated length\n", pszCaller, SanitizeString(strCommand), nMessageSize, e.what());
+        }
+        else if (strstr(e.what(), "size too large"))
+        {
+            // Allow exceptions from over-long size
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", pszCaller, SanitizeString(strCommand), nMessageSize, e.what());
+        }
+        else if (strstr(e.what(), "non-canonical ReadCompactSize()"))
+        {
+            // Allow exceptions from non-canonical encoding
+            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", pszCaller, SanitizeString(strCommand), nMessageSize, e.what());
+        }
+        else
+        {
+            PrintExceptionContinue(std::current_exception(), strprintf("%s()", pszCaller).c_str());
+        }
+    } catch (...) {
+        PrintExceptionContinue(std::current_exception(), strprintf("%s()", pszCaller).c_str());
+    }
+    return false;
+}
+
+/** Check the message start, header and checksum of a received message */
+static bool CheckMessage(CNode* pfrom, CNetMessage& msg, const CChainParams& chainparams)
+{
+    msg.SetVersion(pfrom->GetRecvVersion());
+    // Scan for message start
+    if (memcmp(msg.hdr.pchMessageStart, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0) {
+        LogPrint(BCLog::NET, "PROCESSMESSAGE: INVALID MESSAGESTART %s peer=%d\n", SanitizeString(msg.hdr.GetCommand()), pfrom->GetId());
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    // Read header
+    CMessageHeader& hdr = msg.hdr;
+    if (!hdr.IsValid(chainparams.MessageStart()))
+    {
+        LogPrint(BCLog::NET, "PROCESSMESSAGE: ERRORS IN HEADER %s peer=%d\n", SanitizeString(hdr.GetCommand()), pfrom->GetId());
+        return false;
+    }
+
+    // Checksum
+    const uint256& hash = msg.GetMessageHash();
+    if (memcmp(hash.begin(), hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) != 0)
+    {
+        LogPrint(BCLog::NET, "%s(%s, %u bytes): CHECKSUM ERROR expected %s was %s\n", __func__,
+           SanitizeString(hdr.GetCommand()), hdr.nMessageSize,
+           HexStr(hash.begin(), hash.begin()+CMessageHeader::CHECKSUM_SIZE),
+           HexStr(hdr.pchChecksum, hdr.pchChecksum+CMessageHeader::CHECKSUM_SIZE));
+        return false;
+    }
+    return true;
+}
+
 bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
 {
     const CChainParams& chainparams = Params();
@@ -3587,84 +3743,113 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     }
     CNetMessage& msg(msgs.front());
 
-    msg.SetVersion(pfrom->GetRecvVersion());
-    // Scan for message start
-    if (memcmp(msg.hdr.pchMessageStart, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0) {
-        LogPrint(BCLog::NET, "PROCESSMESSAGE: INVALID MESSAGESTART %s peer=%d\n", SanitizeString(msg.hdr.GetCommand()), pfrom->GetId());
-        pfrom->fDisconnect = true;
-        return false;
+    if (!CheckMessage(pfrom, msg, chainparams)) {
+        return pfrom->fDisconnect ? false : fMoreWork;
     }
-
-    // Read header
-    CMessageHeader& hdr = msg.hdr;
-    if (!hdr.IsValid(chainparams.MessageStart()))
-    {
-        LogPrint(BCLog::NET, "PROCESSMESSAGE: ERRORS IN HEADER %s peer=%d\n", SanitizeString(hdr.GetCommand()), pfrom->GetId());
-        return fMoreWork;
-    }
-    std::string strCommand = hdr.GetCommand();
+    std::string strCommand = msg.hdr.GetCommand();
 
     // Message size
-    unsigned int nMessageSize = hdr.nMessageSize;
+    unsigned int nMessageSize = msg.hdr.nMessageSize;
 
-    // Checksum
     CDataStream& vRecv = msg.vRecv;
-    const uint256& hash = msg.GetMessageHash();
-    if (memcmp(hash.begin(), hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) != 0)
-    {
-        LogPrint(BCLog::NET, "%s(%s, %u bytes): CHECKSUM ERROR expected %s was %s\n", __func__,
-           SanitizeString(strCommand), nMessageSize,
-           HexStr(hash.begin(), hash.begin()+CMessageHeader::CHECKSUM_SIZE),
-           HexStr(hdr.pchChecksum, hdr.pchChecksum+CMessageHeader::CHECKSUM_SIZE));
-        return fMoreWork;
-    }
 
     // Process message
-    bool fRet = false;
-    try
+    bool fRet = CallMessageHandler(pfrom, strCommand, nMessageSize, connman, __func__, [&] {
+        return ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc);
+    });
+    if (interruptMsgProc)
+        return false;
+    if (!pfrom->vRecvGetData.empty())
+        fMoreWork = true;
+
+    if (!fRet) {
+        LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
+    }
+
+    LOCK(cs_main);
+    SendRejectsAndCheckIfBanned(pfrom, connman);
+
+    return fMoreWork;
+}
+
+// Messages whose handlers don't rely on being called from the main message handler and take the locks they need
+// (including cs_main) themselves. They are processed by the message handler shards, concurrently to the main
+// message handler and to each other.
+static const std::set<std::string> setConcurrentMessageTypes = {
+    NetMsgType::QSIGSESANN,
+    NetMsgType::QSIGSHARESINV,
+    NetMsgType::QGETSIGSHARES,
+    NetMsgType::QBSIGSHARES,
+    NetMsgType::QSIGSHARE,
+    NetMsgType::QSIGREC,
+    NetMsgType::QSENDRECSIGS,
+    NetMsgType::ISLOCK,
+    NetMsgType::MNGOVERNANCEOBJECTVOTE,
+};
+
+/**
+ * Process a message of setConcurrentMessageTypes on a message handler shard. Unlike ProcessMessage, this hands the
+ * message only to the manager responsible for it, so nothing the main message handler relies on being exclusive to
+ * it (e.g. the PrivateSend pools) is touched.
+ */
+static bool ProcessShardedMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman* connman)
+{
+    LogPrint(BCLog::NET, "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->GetId());
+
+    if (strCommand == NetMsgType::QSENDRECSIGS) {
+        bool b;
+        vRecv >> b;
+        pfrom->fSendRecSigs = b;
+    } else if (strCommand == NetMsgType::QSIGREC) {
+        llmq::quorumSigningManager->ProcessMessage(pfrom, strCommand, vRecv, *connman);
+    } else if (strCommand == NetMsgType::ISLOCK) {
+        llmq::quorumInstantSendManager->ProcessMessage(pfrom, strCommand, vRecv, *connman);
+    } else if (strCommand == NetMsgType::MNGOVERNANCEOBJECTVOTE) {
+        governance.ProcessMessage(pfrom, strCommand, vRecv, *connman);
+    } else {
+        // QSIGSESANN, QSIGSHARESINV, QGETSIGSHARES, QBSIGSHARES and QSIGSHARE
+        llmq::quorumSigSharesManager->ProcessMessage(pfrom, strCommand, vRecv, *connman);
+    }
+    return true;
+}
+
+bool PeerLogicValidation::IsConcurrentMessage(const std::string& strCommand) const
+{
+    return setConcurrentMessageTypes.count(strCommand) != 0;
+}
+
+bool PeerLogicValidation::ProcessConcurrentMessage(CNode* pfrom, std::atomic<bool>& interruptMsgProc)
+{
+    const CChainParams& chainparams = Params();
+
+    std::list<CNetMessage> msgs;
     {
-        fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc);
-        if (interruptMsgProc)
+        LOCK(pfrom->cs_vProcessMsg);
+        if (pfrom->vProcessMsgConcurrent.empty())
             return false;
-        if (!pfrom->vRecvGetData.empty())
-            fMoreWork = true;
+        msgs.splice(msgs.begin(), pfrom->vProcessMsgConcurrent, pfrom->vProcessMsgConcurrent.begin());
+        pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+        pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman->GetReceiveFloodSize();
     }
-    catch (const std::ios_base::failure& e)
-    {
-        if (g_enable_bip61) {
-            connman->PushMessage(pfrom, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::REJECT, strCommand, REJECT_MALFORMED, std::string("error parsing message")));
-        }
-        if (strstr(e.what(), "end of data"))
-        {
-            // Allow exceptions from under-length message on vRecv
-            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught, normally caused by a message being shorter than its stated length\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-        }
-        else if (strstr(e.what(), "size too large"))
-        {
-            // Allow exceptions from over-long size
-            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-        }
-        else if (strstr(e.what(), "non-canonical ReadCompactSize()"))
-        {
-            // Allow exceptions from non-canonical encoding
-            LogPrint(BCLog::NET, "%s(%s, %u bytes): Exception '%s' caught\n", __func__, SanitizeString(strCommand), nMessageSize, e.what());
-        }
-        else
-        {
-            PrintExceptionContinue(std::current_exception(), "ProcessMessages()");
-            }
-        } catch (...) {
-        PrintExceptionContinue(std::current_exception(), "ProcessMessages()");
+    CNetMessage& msg(msgs.front());
+
+    if (!CheckMessage(pfrom, msg, chainparams)) {
+        return true;
     }
+    std::string strCommand = msg.hdr.GetCommand();
+    assert(IsConcurrentMessage(strCommand));
+
+    bool fRet = CallMessageHandler(pfrom, strCommand, msg.hdr.nMessageSize, connman, __func__, [&] {
+        return ProcessShardedMessage(pfrom, strCommand, msg.vRecv, connman);
+    });
 
     if (!fRet) {
-        LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
+        LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), msg.hdr.nMessageSize, pfrom->GetId());
     }
 
     LOCK(cs_main);
     SendRejectsAndCheckIfBanned(pfrom, connman);
-
-    return fMoreWork;
+    return true;
 }
 
 void PeerLogicValidation::ConsiderEviction(CNode *pto, int64_t time_in_seconds)
@@ -3799,22 +3984,77 @@ void PeerLogicValidation::CheckForStaleTipAndEvictPeers(const Consensus::Params
     }
 }
 
-class CompareInvMempoolOrder
+bool CTxRelayOrder::AnnounceLater(const Entry* a, const Entry* b)
 {
-    CTxMemPool *mp;
-public:
-    explicit CompareInvMempoolOrder(CTxMemPool *_mempool)
-    {
-        mp = _mempool;
+    /* As std::make_heap produces a max-heap, we want the entries with the
+     * fewest ancestors/highest fee to sort later. Same order as CTxMemPool::CompareDepthAndScore. */
+    if (a->nCountWithAncestors != b->nCountWithAncestors) {
+        return a->nCountWithAncestors > b->nCountWithAncestors;
+    }
+    double f1 = (double)b->nModFee * a->nTxSize;
+    double f2 = (double)a->nModFee * b->nTxSize;
+    if (f1 == f2) {
+        return a->tx->GetHash() < b->tx->GetHash();
     }
+    return f1 > f2;
+}
 
-    bool operator()(std::set<uint256>::iterator a, std::set<uint256>::iterator b)
-    {
-        /* As std::make_heap produces a max-heap, we want the entries with the
-         * fewest ancestors/highest fee to sort later. */
-        return mp->CompareDepthAndScore(*b, *a);
+const CTxRelayOrder::Entry* CTxRelayOrder::GetEntry(const CTxMemPool& pool, const uint256& hash)
+{
+    auto it = mapEntries.find(hash);
+    if (it != mapEntries.end()) {
+        return &it->second;
     }
-};
+    auto mi = pool.mapTx.find(hash);
+    if (mi == pool.mapTx.end()) {
+        return nullptr;
+    }
+    Entry entry{mi->GetSharedTx(), mi->GetCountWithAncestors(), mi->GetModifiedFee(), mi->GetTxSize()};
+    return &mapEntries.emplace(hash, std::move(entry)).first->second;
+}
+
+void CTxRelayOrder::Select(const CTxMemPool& pool, std::vector<uint256>& vQueue, size_t nMax, std::chrono::microseconds now,
+                           const std::function<bool(const CTransactionRef&)>& fAnnounce)
+{
+    AssertLockHeld(pool.cs);
+    if (now - nRefreshTime > TX_RELAY_ORDER_LIFETIME) {
+        mapEntries.clear();
+        nRefreshTime = now;
+    }
+
+    vHeap.clear();
+    for (const uint256& hash : vQueue) {
+        if (const Entry* entry = GetEntry(pool, hash)) {
+            vHeap.push_back(entry);
+        }
+    }
+    // A heap is used so that not all items need sorting if only a few are being sent.
+    std::make_heap(vHeap.begin(), vHeap.end(), AnnounceLater);
+    size_t nAnnounced = 0;
+    const Entry* prev = nullptr;
+    while (!vHeap.empty() && nAnnounced < nMax) {
+        std::pop_heap(vHeap.begin(), vHeap.end(), AnnounceLater);
+        const Entry* entry = vHeap.back();
+        vHeap.pop_back();
+        // copies of the same transaction come out of the heap one after the other
+        if (entry == prev) {
+            continue;
+        }
+        prev = entry;
+        // the cached entry may be outdated
+        if (!pool.exists(entry->tx->GetHash())) {
+            continue;
+        }
+        if (fAnnounce(entry->tx)) {
+            nAnnounced++;
+        }
+    }
+
+    vQueue.clear();
+    for (const Entry* entry : vHeap) {
+        vQueue.push_back(entry->tx->GetHash());
+    }
+}
 
 bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptMsgProc)
 {
@@ -4029,7 +4269,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                     {
                         LOCK(cs_most_recent_block);
                         if (most_recent_block_hash == pBestIndex->GetBlockHash()) {
-                            connman->PushMessage(pto, msgMaker.Make(NetMsgType::CMPCTBLOCK, *most_recent_compact_block));
+                            connman->PushMessage(pto, most_recent_compact_block_msg);
                             fGotBlockFromCache = true;
                         }
                     }
@@ -4090,7 +4330,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
         //
         std::vector<CInv> vInv;
         {
-            size_t reserve = std::min<size_t>(pto->setInventoryTxToSend.size(), INVENTORY_BROADCAST_MAX_PER_1MB_BLOCK * MaxBlockSize(true) / 1000000);
+            size_t reserve = std::min<size_t>(pto->vInventoryTxToSend.size(), INVENTORY_BROADCAST_MAX_PER_1MB_BLOCK * MaxBlockSize(true) / 1000000);
             reserve = std::max<size_t>(reserve, pto->vInventoryBlockToSend.size());
             reserve = std::min<size_t>(reserve, MAX_INV_SZ);
             vInv.reserve(reserve);
@@ -4125,7 +4365,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
             // Time to send but the peer has requested we not relay transactions.
             if (fSendTrickle) {
                 LOCK(pto->cs_filter);
-                if (!pto->fRelayTxes) pto->setInventoryTxToSend.clear();
+                if (!pto->fRelayTxes) pto->vInventoryTxToSend.clear();
             }
 
             // Respond to BIP35 mempool requests
@@ -4142,7 +4382,6 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                         nInvType = MSG_DSTX;
                     }
                     CInv inv(nInvType, hash);
-                    pto->setInventoryTxToSend.erase(hash);
                     if (pto->pfilter) {
                         if (!pto->pfilter->IsRelevantAndUpdate(*txinfo.tx)) continue;
                     }
@@ -4174,45 +4413,22 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
 
             // Determine transactions to relay
             if (fSendTrickle) {
-                // Produce a vector with all candidates for sending
-                std::vector<std::set<uint256>::iterator> vInvTx;
-                vInvTx.reserve(pto->setInventoryTxToSend.size());
-                for (std::set<uint256>::iterator it = pto->setInventoryTxToSend.begin(); it != pto->setInventoryTxToSend.end(); it++) {
-                    vInvTx.push_back(it);
-                }
-                // Topologically and fee-rate sort the inventory we send for privacy and priority reasons.
-                // A heap is used so that not all items need sorting if only a few are being sent.
-                CompareInvMempoolOrder compareInvMempoolOrder(&mempool);
-                std::make_heap(vInvTx.begin(), vInvTx.end(), compareInvMempoolOrder);
                 // No reason to drain out at many times the network's capacity,
                 // especially since we have many peers and some will draw much shorter delays.
-                unsigned int nRelayedTransactions = 0;
                 LOCK(pto->cs_filter);
-                while (!vInvTx.empty() && nRelayedTransactions < INVENTORY_BROADCAST_MAX_PER_1MB_BLOCK * MaxBlockSize(true) / 1000000) {
-                    // Fetch the top element from the heap
-                    std::pop_heap(vInvTx.begin(), vInvTx.end(), compareInvMempoolOrder);
-                    std::set<uint256>::iterator it = vInvTx.back();
-                    vInvTx.pop_back();
-                    uint256 hash = *it;
-                    // Remove it from the to-be-sent set
-                    pto->setInventoryTxToSend.erase(it);
+                txRelayOrder.Select(mempool, pto->vInventoryTxToSend, INVENTORY_BROADCAST_MAX_PER_1MB_BLOCK * MaxBlockSize(true) / 1000000, current_time, [&](const CTransactionRef& tx) {
+                    const uint256& hash = tx->GetHash();
                     // Check if not in the filter already
                     if (pto->filterInventoryKnown.contains(hash)) {
-                        continue;
+                        return false;
                     }
-                    // Not in the mempool anymore? don't bother sending it.
-                    auto txinfo = mempool.info(hash);
-                    if (!txinfo.tx) {
-                        continue;
-                    }
-                    if (pto->pfilter && !pto->pfilter->IsRelevantAndUpdate(*txinfo.tx)) continue;
+                    if (pto->pfilter && !pto->pfilter->IsRelevantAndUpdate(*tx)) return false;
                     // Send
                     int nInvType = MSG_TX;
                     if (CPrivateSend::GetDSTX(hash)) {
                         nInvType = MSG_DSTX;
                     }
                     vInv.push_back(CInv(nInvType, hash));
-                    nRelayedTransactions++;
                     {
                         // Expire old relay messages
                         while (!vRelayExpiration.empty() && vRelayExpiration.front().first < nNow)
@@ -4221,7 +4437,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                             vRelayExpiration.pop_front();
                         }
 
-                        auto ret = mapRelay.insert(std::make_pair(hash, std::move(txinfo.tx)));
+                        auto ret = mapRelay.insert(std::make_pair(hash, tx));
                         if (ret.second) {
                             vRelayExpiration.push_back(std::make_pair(nNow + 15 * 60 * 1000000, ret.first));
                         }
@@ -4231,7 +4447,8 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                         vInv.clear();
                     }
                     pto->filterInventoryKnown.insert(hash);
-                }
+                    return true;
+                });
             }
 
             // Send non-tx/non-block inventory items
@@ -4374,6 +4591,12 @@ bool PeerLogicValidation::SendMessages(CNode* pto, std::atomic<bool>& interruptM
                 state.m_object_download.m_object_in_flight.erase(inv);
                 continue;
             }
+            if (inv.type == MSG_ISLOCK && llmq::quorumInstantSendManager->IsPendingQueueFull()) {
+                // Verification of islocks can't keep up, stop pulling more of them from peers until the pending
+                // queue has drained and try again later
+                object_process_time.emplace(current_time + GetObjectInterval(inv.type), inv);
+                continue;
+            }
             if (!AlreadyHave(inv)) {
                 // If this object was last requested more than GetObjectInterval ago,
                 // then request.
@@ -6,10 +6,19 @@
 #ifndef BITCOIN_NET_PROCESSING_H
 #define BITCOIN_NET_PROCESSING_H
 
+#include <amount.h>
 #include <net.h>
+#include <primitives/transaction.h>
+#include <saltedhasher.h>
 #include <validationinterface.h>
 #include <consensus/params.h>
 
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+
+class CTxMemPool;
+
 /** Default for -maxorphantxsize, maximum size in megabytes the orphan map can grow before entries are removed */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS_SIZE = 10; // this allows around 100 TXs of max size (and many more of normal size)
 /** Expiration time for orphan transactions in seconds */
@@ -37,6 +46,9 @@ static constexpr int64_t EXTRA_PEER_CHECK_INTERVAL = 45;
 /** Minimum time an outbound-peer-eviction candidate must be connected for, in order to evict, in seconds */
 static constexpr int64_t MINIMUM_CONNECT_TIME = 30;
 
+/** How long the mempool order of the transactions to announce is reused before it's looked up again */
+static constexpr std::chrono::seconds TX_RELAY_ORDER_LIFETIME{1};
+
 /** Default for BIP61 (sending reject messages) */
 static constexpr bool DEFAULT_ENABLE_BIP61 = true;
 /** Enable BIP61 (sending reject messages) */
@@ -67,6 +79,10 @@ public:
     * @return                      True if there is more work to be done
     */
     bool SendMessages(CNode* pto, std::atomic<bool>& interrupt) override;
+    /** Whether messages of this type are processed by the message handler shards */
+    bool IsConcurrentMessage(const std::string& strCommand) const override;
+    /** Process one message queued for the message handler shards */
+    bool ProcessConcurrentMessage(CNode* pfrom, std::atomic<bool>& interrupt) override;
 
     void ConsiderEviction(CNode *pto, int64_t time_in_seconds);
     void CheckForStaleTipAndEvictPeers(const Consensus::Params &consensusParams);
@@ -76,6 +92,40 @@ private:
     int64_t m_stale_tip_check_time; //! Next time to check for stale tip
 };
 
+/**
+ * Mempool order (fewest ancestors first, then highest feerate) of the transactions queued for announcement.
+ * The mempool entries are looked up once and shared by all peers, instead of being compared in every peer's heap.
+ * The order is refreshed after TX_RELAY_ORDER_LIFETIME, a slightly outdated one only affects which of the queued
+ * transactions are announced first. Not thread-safe.
+ */
+class CTxRelayOrder
+{
+public:
+    struct Entry {
+        CTransactionRef tx;
+        uint64_t nCountWithAncestors;
+        CAmount nModFee;
+        size_t nTxSize;
+    };
+
+    /**
+     * Passes the transactions of vQueue in mempool order to fAnnounce until it accepted nMax of them. Duplicates and
+     * transactions which left the mempool are dropped, the ones which weren't reached are left in vQueue.
+     */
+    void Select(const CTxMemPool& pool, std::vector<uint256>& vQueue, size_t nMax, std::chrono::microseconds now,
+                const std::function<bool(const CTransactionRef&)>& fAnnounce);
+
+    /** Heap order: true if a is announced after b */
+    static bool AnnounceLater(const Entry* a, const Entry* b);
+
+private:
+    const Entry* GetEntry(const CTxMemPool& pool, const uint256& hash);
+
+    std::unordered_map<uint256, Entry, StaticSaltedHasher> mapEntries;
+    std::chrono::microseconds nRefreshTime{0};
+    std::vector<const Entry*> vHeap;
+};
+
 struct CNodeStateStats {
     int nMisbehavior;
     int nSyncHeight;
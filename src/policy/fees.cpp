@@ -6,6 +6,7 @@
 #include <policy/fees.h>
 #include <policy/policy.h>
 
+#include <chain.h>
 #include <clientversion.h>
 #include <primitives/transaction.h>
 #include <streams.h>
@@ -121,6 +122,9 @@ public:
     TxConfirmStats(const std::vector<double>& defaultBuckets, const std::map<double, unsigned int>& defaultBucketMap,
                    unsigned int maxPeriods, double decay, unsigned int scale);
 
+    /** Create a copy of other which refers to the given (equal) buckets and bucketMap */
+    TxConfirmStats(const TxConfirmStats& other, const std::vector<double>& buckets, const std::map<double, unsigned int>& bucketMap);
+
     /** Roll the circular buffer for unconfirmed txs*/
     void ClearCurrent(unsigned int nBlockHeight);
 
@@ -195,6 +199,16 @@ TxConfirmStats::TxConfirmStats(const std::vector<double>& defaultBuckets,
     resizeInMemoryCounters(buckets.size());
 }
 
+TxConfirmStats::TxConfirmStats(const TxConfirmStats& other, const std::vector<double>& _buckets,
+                               const std::map<double, unsigned int>& _bucketMap)
+    : buckets(_buckets), bucketMap(_bucketMap),
+      txCtAvg(other.txCtAvg), confAvg(other.confAvg), failAvg(other.failAvg), avg(other.avg),
+      decay(other.decay), scale(other.scale),
+      unconfTxs(other.unconfTxs), oldUnconfTxs(other.oldUnconfTxs)
+{
+    assert(buckets == other.buckets);
+}
+
 void TxConfirmStats::resizeInMemoryCounters(size_t newbuckets) {
     // newbuckets must be passed in because the buckets referred to during Read have not been updated yet.
     unconfTxs.resize(GetMaxConfirms());
@@ -512,6 +526,9 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
 bool CBlockPolicyEstimator::removeTx(uint256 hash, bool inBlock)
 {
     LOCK(cs_feeEstimator);
+    if (mapPendingTxs.erase(hash)) {
+        return true;
+    }
     std::map<uint256, TxStatsInfo>::iterator pos = mapMemPoolTxs.find(hash);
     if (pos != mapMemPoolTxs.end()) {
         feeStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
@@ -542,25 +559,57 @@ CBlockPolicyEstimator::CBlockPolicyEstimator()
     longStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
 }
 
+CBlockPolicyEstimator::CBlockPolicyEstimator(const CBlockPolicyEstimator& other)
+    : nBestSeenHeight(other.nBestSeenHeight), firstRecordedHeight(other.firstRecordedHeight),
+      historicalFirst(other.historicalFirst), historicalBest(other.historicalBest),
+      trackedTxs(0), untrackedTxs(0),
+      buckets(other.buckets), bucketMap(other.bucketMap)
+{
+    AssertLockHeld(other.cs_feeEstimator);
+    feeStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(*other.feeStats, buckets, bucketMap));
+    shortStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(*other.shortStats, buckets, bucketMap));
+    longStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(*other.longStats, buckets, bucketMap));
+    fSnapshotDirty = false;
+}
+
 CBlockPolicyEstimator::~CBlockPolicyEstimator()
 {
 }
 
+std::shared_ptr<const CBlockPolicyEstimator> CBlockPolicyEstimator::GetSnapshot() const
+{
+    if (fSnapshotDirty) {
+        LOCK(cs_feeEstimator);
+        // another reader might have taken it while we were waiting for the lock
+        if (fSnapshotDirty) {
+            int64_t nTimeStart = GetTimeMicros();
+            std::shared_ptr<const CBlockPolicyEstimator> newSnapshot(new CBlockPolicyEstimator(*this));
+            std::atomic_store(&snapshot, newSnapshot);
+            fSnapshotDirty = false;
+            LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy snapshot taken at height %u in %.2fms\n", nBestSeenHeight, (GetTimeMicros() - nTimeStart) * 0.001);
+        }
+    }
+    return std::atomic_load(&snapshot);
+}
+
+void CBlockPolicyEstimator::BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted)
+{
+    processBlock(pindex->nHeight, block->vtx);
+}
+
 void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, bool validFeeEstimate)
 {
     LOCK(cs_feeEstimator);
     unsigned int txHeight = entry.GetHeight();
     uint256 hash = entry.GetTx().GetHash();
-    if (mapMemPoolTxs.count(hash)) {
+    if (mapMemPoolTxs.count(hash) || mapPendingTxs.count(hash)) {
         LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy error mempool tx %s already being tracked\n", hash.ToString());
         return;
     }
 
-    if (txHeight != nBestSeenHeight) {
+    if (txHeight < nBestSeenHeight) {
         // Ignore side chains and re-orgs; assuming they are random they don't
         // affect the estimate.  We'll potentially double count transactions in 1-block reorgs.
-        // Ignore txs if BlockPolicyEstimator is not in sync with chainActive.Tip().
-        // It will be synced next time a block is processed.
         return;
     }
 
@@ -575,26 +624,46 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     // Feerates are stored and reported as BTC-per-kb:
     CFeeRate feeRate(entry.GetFee(), entry.GetTxSize());
 
-    mapMemPoolTxs[hash].blockHeight = txHeight;
-    unsigned int bucketIndex = feeStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
-    mapMemPoolTxs[hash].bucketIndex = bucketIndex;
-    unsigned int bucketIndex2 = shortStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
+    if (txHeight > nBestSeenHeight) {
+        // The block at txHeight is connected already, but its BlockConnected callback didn't reach us yet.
+        // Remember the tx until processBlock gets to txHeight.
+        TxStatsInfo& info = mapPendingTxs[hash];
+        info.blockHeight = txHeight;
+        info.feeRate = (double)feeRate.GetFeePerK();
+        return;
+    }
+
+    trackTx(hash, txHeight, (double)feeRate.GetFeePerK());
+}
+
+void CBlockPolicyEstimator::trackTx(const uint256& hash, unsigned int txHeight, double feeRate)
+{
+    TxStatsInfo& info = mapMemPoolTxs[hash];
+    info.blockHeight = txHeight;
+    info.feeRate = feeRate;
+    unsigned int bucketIndex = feeStats->NewTx(txHeight, feeRate);
+    info.bucketIndex = bucketIndex;
+    unsigned int bucketIndex2 = shortStats->NewTx(txHeight, feeRate);
     assert(bucketIndex == bucketIndex2);
-    unsigned int bucketIndex3 = longStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
+    unsigned int bucketIndex3 = longStats->NewTx(txHeight, feeRate);
     assert(bucketIndex == bucketIndex3);
 }
 
-bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry)
+bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const uint256& hash)
 {
-    if (!removeTx(entry->GetTx().GetHash(), true)) {
+    // The mempool entry is usually gone by now, use what we stored when the tx was accepted
+    auto it = mapMemPoolTxs.find(hash);
+    if (it == mapMemPoolTxs.end()) {
         // This transaction wasn't being tracked for fee estimation
         return false;
     }
+    const TxStatsInfo info = it->second;
+    removeTx(hash, true);
 
     // How many blocks did it take for miners to include this transaction?
     // blocksToConfirm is 1-based, so a transaction included in the earliest
     // possible block has confirmation count of 1
-    int blocksToConfirm = nBlockHeight - entry->GetHeight();
+    int blocksToConfirm = nBlockHeight - info.blockHeight;
     if (blocksToConfirm <= 0) {
         // This can't happen because we don't process transactions from a block with a height
         // lower than our greatest seen height
@@ -602,17 +671,13 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
         return false;
     }
 
-    // Feerates are stored and reported as BTC-per-kb:
-    CFeeRate feeRate(entry->GetFee(), entry->GetTxSize());
-
-    feeStats->Record(blocksToConfirm, (double)feeRate.GetFeePerK());
-    shortStats->Record(blocksToConfirm, (double)feeRate.GetFeePerK());
-    longStats->Record(blocksToConfirm, (double)feeRate.GetFeePerK());
+    feeStats->Record(blocksToConfirm, info.feeRate);
+    shortStats->Record(blocksToConfirm, info.feeRate);
+    longStats->Record(blocksToConfirm, info.feeRate);
     return true;
 }
 
-void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
-                                         std::vector<const CTxMemPoolEntry*>& entries)
+void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight, const std::vector<CTransactionRef>& txs)
 {
     LOCK(cs_feeEstimator);
     if (nBlockHeight <= nBestSeenHeight) {
@@ -621,6 +686,10 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
         // And if an attacker can re-org the chain at will, then
         // you've got much bigger problems than "attacker can influence
         // transaction fees."
+        // The txs already left the mempool, so stop tracking them.
+        for (const auto& tx : txs) {
+            removeTx(tx->GetHash(), false);
+        }
         return;
     }
 
@@ -641,11 +710,24 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
 
     unsigned int countedTxs = 0;
     // Update averages with data points from current block
-    for (const auto& entry : entries) {
-        if (processBlockTx(nBlockHeight, entry))
+    for (const auto& tx : txs) {
+        if (processBlockTx(nBlockHeight, tx->GetHash()))
             countedTxs++;
     }
 
+    // Start tracking the txs which entered the mempool after this block was connected, and forget the ones
+    // whose entry height was skipped by a re-org
+    for (auto it = mapPendingTxs.begin(); it != mapPendingTxs.end();) {
+        if (it->second.blockHeight == nBlockHeight) {
+            trackTx(it->first, it->second.blockHeight, it->second.feeRate);
+        }
+        if (it->second.blockHeight <= nBlockHeight) {
+            it = mapPendingTxs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
     if (firstRecordedHeight == 0 && countedTxs > 0) {
         firstRecordedHeight = nBestSeenHeight;
         LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy first recorded height %u\n", firstRecordedHeight);
@@ -653,11 +735,12 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
 
 
     LogPrint(BCLog::ESTIMATEFEE, "Blockpolicy estimates updated by %u of %u block txs, since last block %u of %u tracked, mempool map size %u, max target %u from %s\n",
-             countedTxs, entries.size(), trackedTxs, trackedTxs + untrackedTxs, mapMemPoolTxs.size(),
+             countedTxs, txs.size(), trackedTxs, trackedTxs + untrackedTxs, mapMemPoolTxs.size(),
              MaxUsableEstimate(), HistoricalBlockSpan() > BlockSpan() ? "historical" : "current");
 
     trackedTxs = 0;
     untrackedTxs = 0;
+    fSnapshotDirty = true;
 }
 
 CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget) const
@@ -670,6 +753,11 @@ CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget) const
 }
 
 CFeeRate CBlockPolicyEstimator::estimateRawFee(int confTarget, double successThreshold, FeeEstimateHorizon horizon, EstimationResult* result) const
+{
+    return GetSnapshot()->_estimateRawFee(confTarget, successThreshold, horizon, result);
+}
+
+CFeeRate CBlockPolicyEstimator::_estimateRawFee(int confTarget, double successThreshold, FeeEstimateHorizon horizon, EstimationResult* result) const
 {
     TxConfirmStats* stats;
     double sufficientTxs = SUFFICIENT_FEETXS;
@@ -692,7 +780,6 @@ CFeeRate CBlockPolicyEstimator::estimateRawFee(int confTarget, double successThr
     }
     }
 
-    LOCK(cs_feeEstimator);
     // Return failure if trying to analyze a target we're not tracking
     if (confTarget <= 0 || (unsigned int)confTarget > stats->GetMaxConfirms())
         return CFeeRate(0);
@@ -708,6 +795,11 @@ CFeeRate CBlockPolicyEstimator::estimateRawFee(int confTarget, double successThr
 }
 
 unsigned int CBlockPolicyEstimator::HighestTargetTracked(FeeEstimateHorizon horizon) const
+{
+    return GetSnapshot()->_HighestTargetTracked(horizon);
+}
+
+unsigned int CBlockPolicyEstimator::_HighestTargetTracked(FeeEstimateHorizon horizon) const
 {
     switch (horizon) {
     case FeeEstimateHorizon::SHORT_HALFLIFE: {
@@ -818,8 +910,11 @@ double CBlockPolicyEstimator::estimateConservativeFee(unsigned int doubleTarget,
  */
 CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative) const
 {
-    LOCK(cs_feeEstimator);
+    return GetSnapshot()->_estimateSmartFee(confTarget, feeCalc, conservative);
+}
 
+CFeeRate CBlockPolicyEstimator::_estimateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative) const
+{
     if (feeCalc) {
         feeCalc->desiredTarget = confTarget;
         feeCalc->returnedTarget = confTarget;
@@ -971,6 +1066,7 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
             nBestSeenHeight = nFileBestSeenHeight;
             historicalFirst = nFileHistoricalFirst;
             historicalBest = nFileHistoricalBest;
+            fSnapshotDirty = true;
         }
     }
     catch (const std::exception& e) {
@@ -988,6 +1084,7 @@ void CBlockPolicyEstimator::FlushUnconfirmed(CTxMemPool& pool) {
     for (auto& txid : txids) {
         removeTx(txid, false);
     }
+    fSnapshotDirty = true;
     int64_t endclear = GetTimeMicros();
     LogPrint(BCLog::ESTIMATEFEE, "Recorded %u unconfirmed txs from mempool in %ld micros\n",txids.size(), endclear - startclear);
 }
@@ -10,7 +10,9 @@
 #include <uint256.h>
 #include <random.h>
 #include <sync.h>
+#include <validationinterface.h>
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <string>
@@ -134,8 +136,14 @@ struct FeeCalculation
  *  We want to be able to estimate feerates that are needed on tx's to be included in
  * a certain number of blocks.  Every time a block is added to the best chain, this class records
  * stats on the transactions included in that block
+ *
+ * Connected blocks are fed in from the validation interface background thread instead of
+ * from the mempool while cs_main is held. Estimates are calculated from a copy of the
+ * estimation state which is published after each block, so readers never wait for
+ * cs_feeEstimator once that copy exists. Mempool transactions accepted or removed since
+ * the last block only show up in estimates after the next one.
  */
-class CBlockPolicyEstimator
+class CBlockPolicyEstimator : public CValidationInterface
 {
 private:
     /** Track confirm delays up to 12 blocks for short horizon */
@@ -192,8 +200,7 @@ public:
     ~CBlockPolicyEstimator();
 
     /** Process all the transactions that have been included in a block */
-    void processBlock(unsigned int nBlockHeight,
-                      std::vector<const CTxMemPoolEntry*>& entries);
+    void processBlock(unsigned int nBlockHeight, const std::vector<CTransactionRef>& txs);
 
     /** Process a transaction accepted to the mempool*/
     void processTransaction(const CTxMemPoolEntry& entry, bool validFeeEstimate);
@@ -229,6 +236,9 @@ public:
     /** Calculation of highest target that estimates are tracked for */
     unsigned int HighestTargetTracked(FeeEstimateHorizon horizon) const;
 
+protected:
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex* pindex, const std::vector<CTransactionRef>& txnConflicted) override;
+
 private:
     unsigned int nBestSeenHeight;
     unsigned int firstRecordedHeight;
@@ -239,11 +249,15 @@ private:
     {
         unsigned int blockHeight;
         unsigned int bucketIndex;
-        TxStatsInfo() : blockHeight(0), bucketIndex(0) {}
+        double feeRate;
+        TxStatsInfo() : blockHeight(0), bucketIndex(0), feeRate(0) {}
     };
 
     // map of txids to information about that transaction
     std::map<uint256, TxStatsInfo> mapMemPoolTxs;
+    // txs accepted after the block at their entry height was connected, but before the estimator processed it.
+    // They are tracked once processBlock reaches that height.
+    std::map<uint256, TxStatsInfo> mapPendingTxs;
 
     /** Classes to track historical data on transaction confirmations */
     std::unique_ptr<TxConfirmStats> feeStats;
@@ -258,8 +272,26 @@ private:
 
     mutable CCriticalSection cs_feeEstimator;
 
+    /** Copy of the estimation state used to answer estimates. Only accessed through std::atomic_load/store */
+    mutable std::shared_ptr<const CBlockPolicyEstimator> snapshot;
+    /** Set when the estimation state changed since the snapshot was taken */
+    mutable std::atomic<bool> fSnapshotDirty{true};
+
+    /** Copy the estimation state (but not the tracked mempool txs) of another estimator */
+    CBlockPolicyEstimator(const CBlockPolicyEstimator& other);
+    /** Return the latest snapshot, taking a new one if the estimation state changed */
+    std::shared_ptr<const CBlockPolicyEstimator> GetSnapshot() const;
+
+    /** Start tracking a transaction which entered the mempool at nBestSeenHeight */
+    void trackTx(const uint256& hash, unsigned int txHeight, double feeRate);
+
     /** Process a transaction confirmed in a block*/
-    bool processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry);
+    bool processBlockTx(unsigned int nBlockHeight, const uint256& hash);
+
+    /** Lock-free versions of estimateSmartFee and estimateRawFee, called on a snapshot */
+    CFeeRate _estimateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative) const;
+    CFeeRate _estimateRawFee(int confTarget, double successThreshold, FeeEstimateHorizon horizon, EstimationResult *result) const;
+    unsigned int _HighestTargetTracked(FeeEstimateHorizon horizon) const;
 
     /** Helper for estimateSmartFee */
     double estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const;
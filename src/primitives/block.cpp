@@ -11,13 +11,167 @@
 #include <utilstrencodings.h>
 #include <crypto/common.h>
 #include <crypto/balloon.h>
+#include <crypto/x11.h>
+
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <random>
+#include <string.h>
+
+/** Headers are hashed as their serialization, zero padded to this size. */
+static const size_t HEADER_HASH_INPUT_SIZE = 176;
+
+static std::atomic<uint64_t> nHeaderHashCount{0};
+
+namespace {
+/** Serializes a header into a fixed size buffer on the stack */
+class CHeaderHashInputWriter
+{
+    unsigned char* pch;
+    size_t nPos{0};
+
+public:
+    explicit CHeaderHashInputWriter(unsigned char* pchIn) : pch(pchIn)
+    {
+        memset(pch, 0, HEADER_HASH_INPUT_SIZE);
+    }
+
+    void write(const char* pchData, size_t nSize)
+    {
+        assert(nPos + nSize <= HEADER_HASH_INPUT_SIZE);
+        memcpy(pch + nPos, pchData, nSize);
+        nPos += nSize;
+    }
+
+    template <typename T>
+    CHeaderHashInputWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return *this;
+    }
+
+    int GetVersion() const { return PROTOCOL_VERSION; }
+    int GetType() const { return SER_NETWORK; }
+};
+
+/**
+ * Recently computed header hashes. Header fields are public and modified in place (the miner bumps nNonce, for
+ * example), so each hash is remembered together with the serialized header it was computed from and a lookup
+ * compares the complete input. Two way set associative, the set is picked by a SipHash of the input. The SipHash is
+ * keyed with a random per-process salt, so that peers can't grind headers into the same set to evict cached hashes.
+ */
+class CHeaderHashCache
+{
+    static const size_t SETS = 4096;
+    static const size_t WAYS = 2;
+    static const size_t LOCKS = 64;
+
+    struct Way {
+        bool fValid{false};
+        unsigned char input[HEADER_HASH_INPUT_SIZE];
+        uint256 hash;
+    };
+    struct Bucket {
+        Way ways[WAYS];
+        size_t nNextWay{0};
+    };
+
+    std::vector<Bucket> vSets;
+    std::mutex locks[LOCKS];
+    uint64_t k0, k1;
+
+    size_t GetSet(const unsigned char* pinput) const
+    {
+        return CSipHasher(k0, k1).Write(pinput, HEADER_HASH_INPUT_SIZE).Finalize() % SETS;
+    }
+
+public:
+    CHeaderHashCache() : vSets(SETS)
+    {
+        // GetRand() lives in the util library, which the consensus library must not depend on
+        std::random_device rd;
+        k0 = ((uint64_t)rd() << 32) | rd();
+        k1 = ((uint64_t)rd() << 32) | rd();
+    }
+
+    bool Get(const unsigned char* pinput, uint256& hashRet)
+    {
+        size_t nSet = GetSet(pinput);
+        std::lock_guard<std::mutex> lock(locks[nSet % LOCKS]);
+        for (const Way& way : vSets[nSet].ways) {
+            if (way.fValid && memcmp(way.input, pinput, HEADER_HASH_INPUT_SIZE) == 0) {
+                hashRet = way.hash;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Set(const unsigned char* pinput, const uint256& hash)
+    {
+        size_t nSet = GetSet(pinput);
+        std::lock_guard<std::mutex> lock(locks[nSet % LOCKS]);
+        Bucket& bucket = vSets[nSet];
+        Way& way = bucket.ways[bucket.nNextWay];
+        bucket.nNextWay = (bucket.nNextWay + 1) % WAYS;
+        memcpy(way.input, pinput, HEADER_HASH_INPUT_SIZE);
+        way.hash = hash;
+        way.fValid = true;
+    }
+};
+
+CHeaderHashCache& GetHeaderHashCache()
+{
+    static CHeaderHashCache cache;
+    return cache;
+}
+} // namespace
 
 uint256 CBlockHeader::GetHash() const
 {
-    std::vector<unsigned char> vch(176);
-    CVectorWriter ss(SER_NETWORK, PROTOCOL_VERSION, vch, 0);
-    ss << *this;
-    return HashX11((const char *)vch.data(), (const char *)vch.data() + vch.size());
+    unsigned char input[HEADER_HASH_INPUT_SIZE];
+    CHeaderHashInputWriter(input) << *this;
+
+    uint256 hash;
+    CHeaderHashCache& cache = GetHeaderHashCache();
+    if (cache.Get(input, hash)) {
+        return hash;
+    }
+    hash = HashX11((const char *)input, (const char *)input + HEADER_HASH_INPUT_SIZE);
+    nHeaderHashCount++;
+    cache.Set(input, hash);
+    return hash;
+}
+
+std::vector<uint256> GetBlockHeaderHashes(const std::vector<CBlockHeader>& headers)
+{
+    std::vector<uint256> hashes(headers.size());
+    GetBlockHeaderHashes(headers.data(), headers.size(), hashes.data());
+    return hashes;
+}
+
+void GetBlockHeaderHashes(const CBlockHeader* headers, size_t count, uint256* hashes)
+{
+    static_assert(sizeof(uint256) == 32, "uint256 must be tightly packed");
+    if (count == 0) {
+        return;
+    }
+    std::vector<unsigned char> vch(count * HEADER_HASH_INPUT_SIZE);
+    for (size_t i = 0; i < count; ++i) {
+        CHeaderHashInputWriter(vch.data() + i * HEADER_HASH_INPUT_SIZE) << headers[i];
+    }
+    HashX11xN(hashes->begin(), vch.data(), HEADER_HASH_INPUT_SIZE, count);
+    nHeaderHashCount += count;
+    CHeaderHashCache& cache = GetHeaderHashCache();
+    for (size_t i = 0; i < count; ++i) {
+        cache.Set(vch.data() + i * HEADER_HASH_INPUT_SIZE, hashes[i]);
+    }
+}
+
+uint64_t GetBlockHeaderHashCount()
+{
+    return nHeaderHashCount;
 }
 
 std::string CBlock::ToString() const
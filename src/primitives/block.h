@@ -124,6 +124,15 @@ public:
 };
 
 
+/** Compute the hashes of a batch of headers, several X11 lanes at a time (see HashX11xN).
+ * The results are also remembered by the header hash cache used by CBlockHeader::GetHash. */
+std::vector<uint256> GetBlockHeaderHashes(const std::vector<CBlockHeader>& headers);
+void GetBlockHeaderHashes(const CBlockHeader* headers, size_t count, uint256* hashes);
+
+/** Number of header X11 evaluations performed so far (cache misses), for benchmarks and tests. */
+uint64_t GetBlockHeaderHashCount();
+
+
 /** Describes a place in the block chain to another node such that if the
  * other node doesn't have the same branch, it can find a recent common trunk.
  * The further back it is, the further before the fork it may be.
@@ -15,6 +15,7 @@
 #include <consensus/validation.h>
 #include <validation.h>
 #include <core_io.h>
+#include <dbwrapper.h>
 #include <uint256.h>
 // #include <rpc/index/txindex.h>
 #include <policy/feerate.h>
@@ -1668,6 +1669,9 @@ UniValue mempoolInfoToJSON()
     ret.push_back(Pair("mempoolminfee", ValueFromAmount(std::max(mempool.GetMinFee(maxmempool), ::minRelayTxFee).GetFeePerK())));
     ret.push_back(Pair("minrelaytxfee", ValueFromAmount(::minRelayTxFee.GetFeePerK())));
     ret.push_back(Pair("instantsendlocks", (int64_t)llmq::quorumInstantSendManager->GetInstantSendLockCount()));
+    ret.push_back(Pair("instantsendpending", (int64_t)llmq::quorumInstantSendManager->GetPendingInstantSendLockCount()));
+    ret.push_back(Pair("instantsenddropped", (int64_t)llmq::quorumInstantSendManager->GetDroppedInstantSendLockCount()));
+    ret.push_back(Pair("instantsendverifytime", llmq::quorumInstantSendManager->GetAverageVerifyTime()));
 
     return ret;
 }
@@ -1687,6 +1691,9 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
             "  \"mempoolminfee\": xxxxx       (numeric) Minimum fee rate in " + CURRENCY_UNIT + "/kB for tx to be accepted. Is the maximum of minrelaytxfee and minimum mempool fee\n"
             "  \"minrelaytxfee\": xxxxx       (numeric) Current minimum relay fee for transactions\n"
             "  \"instantsendlocks\": xxxxx,   (numeric) Number of unconfirmed instant send locks\n"
+            "  \"instantsendpending\": xxxxx, (numeric) Number of received instant send locks waiting for verification\n"
+            "  \"instantsenddropped\": xxxxx, (numeric) Number of instant send locks dropped because too many were waiting for verification\n"
+            "  \"instantsendverifytime\": xxxxx, (numeric) Average verification time per instant send lock in microseconds\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getmempoolinfo", "")
@@ -2261,6 +2268,144 @@ UniValue savemempool(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+static UniValue DBStatsToJSON(const CDBWrapper& dbw)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("name", dbw.GetName()));
+
+    const auto& tuning = dbw.GetTuning();
+    UniValue tuningObj(UniValue::VOBJ);
+    tuningObj.push_back(Pair("maxopenfiles", tuning.nMaxOpenFiles));
+    tuningObj.push_back(Pair("blocksize", (uint64_t)tuning.nBlockSize));
+    tuningObj.push_back(Pair("bloombits", tuning.nBloomBits));
+    tuningObj.push_back(Pair("compression", tuning.fCompression));
+    tuningObj.push_back(Pair("blockcache", tuning.nBlockCachePercent));
+    obj.push_back(Pair("tuning", tuningObj));
+
+    std::string value;
+    if (dbw.GetProperty("leveldb.approximate-memory-usage", value)) {
+        obj.push_back(Pair("memory_usage", atoi64(value)));
+    }
+
+    // Each line after the header of "leveldb.stats" looks like this:
+    // Level  Files Size(MB) Time(sec) Read(MB) Write(MB)
+    UniValue levels(UniValue::VARR);
+    int64_t nReadAmplification = 0;
+    double nCompactionTime = 0;
+    if (dbw.GetProperty("leveldb.stats", value)) {
+        std::istringstream stream(value);
+        std::string line;
+        while (std::getline(stream, line)) {
+            int level, files;
+            double size, time, read, write;
+            if (sscanf(line.c_str(), "%d %d %lf %lf %lf %lf", &level, &files, &size, &time, &read, &write) != 6) {
+                continue;
+            }
+            UniValue levelObj(UniValue::VOBJ);
+            levelObj.push_back(Pair("level", level));
+            levelObj.push_back(Pair("files", files));
+            levelObj.push_back(Pair("size_mb", size));
+            levelObj.push_back(Pair("compaction_time", time));
+            levelObj.push_back(Pair("compaction_read_mb", read));
+            levelObj.push_back(Pair("compaction_write_mb", write));
+            levels.push_back(levelObj);
+
+            // a lookup may have to check every level 0 file, but only one file per other level
+            if (files > 0) {
+                nReadAmplification += level == 0 ? files : 1;
+            }
+            nCompactionTime += time;
+        }
+    }
+    obj.push_back(Pair("levels", levels));
+    obj.push_back(Pair("compaction_time", nCompactionTime));
+    obj.push_back(Pair("read_amplification", nReadAmplification));
+    return obj;
+}
+
+UniValue getdbstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0) {
+        throw std::runtime_error(
+            "getdbstats\n"
+            "\nReturns LevelDB statistics and the tuning profile (see -dbtuning) of each on-disk database.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"name\": \"xxxx\",              (string) Name of the database (index, chainstate, evodb or llmq)\n"
+            "    \"tuning\": {...},              (json object) Tuning profile in use\n"
+            "    \"memory_usage\": xxxxx,        (numeric) Approximate memory used by the block cache and write buffers\n"
+            "    \"levels\": [                   (array) Per level statistics, only for levels with files or compactions\n"
+            "      {\n"
+            "        \"level\": n,               (numeric) The level\n"
+            "        \"files\": n,               (numeric) Number of table files\n"
+            "        \"size_mb\": n,             (numeric) Size of all table files in MB\n"
+            "        \"compaction_time\": n,     (numeric) Seconds spent compacting into this level\n"
+            "        \"compaction_read_mb\": n,  (numeric) MB read by these compactions\n"
+            "        \"compaction_write_mb\": n, (numeric) MB written by these compactions\n"
+            "      }, ...\n"
+            "    ],\n"
+            "    \"compaction_time\": n,         (numeric) Total seconds spent compacting\n"
+            "    \"read_amplification\": n       (numeric) Worst case number of table files checked by a lookup\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+        );
+    }
+
+    UniValue result(UniValue::VARR);
+    ForEachDBWrapper([&](const CDBWrapper& dbw) {
+        result.push_back(DBStatsToJSON(dbw));
+    });
+    return result;
+}
+
+UniValue getcoinsflushstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0) {
+        throw std::runtime_error(
+            "getcoinsflushstats\n"
+            "\nReturns statistics about writing the coins cache to the chainstate database.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"full_flushes\": n,         (numeric) Number of writes of all modified coins which also emptied the cache\n"
+            "  \"syncs\": n,                (numeric) Number of writes of all modified coins which kept the cache\n"
+            "  \"partial_flushes\": n,      (numeric) Number of partial writes between blocks\n"
+            "  \"coins_written\": n,        (numeric) Total number of modified coins written\n"
+            "  \"last_coins_written\": n,   (numeric) Number of modified coins written by the last write\n"
+            "  \"total_time_ms\": n,        (numeric) Total time spent writing, in milliseconds\n"
+            "  \"max_time_ms\": n,          (numeric) Duration of the slowest write, in milliseconds\n"
+            "  \"last_time_ms\": n,         (numeric) Duration of the last write, in milliseconds\n"
+            "  \"cache_usage\": n,          (numeric) Current memory usage of the coins cache\n"
+            "  \"cache_coins\": n           (numeric) Current number of coins in the cache\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getcoinsflushstats", "")
+            + HelpExampleRpc("getcoinsflushstats", "")
+        );
+    }
+
+    CCoinsFlushStats stats = GetCoinsFlushStats();
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("full_flushes", stats.nFullFlushes);
+    result.pushKV("syncs", stats.nSyncs);
+    result.pushKV("partial_flushes", stats.nPartialFlushes);
+    result.pushKV("coins_written", stats.nCoinsWritten);
+    result.pushKV("last_coins_written", stats.nLastCoinsWritten);
+    result.pushKV("total_time_ms", stats.nTotalTime / 1000.0);
+    result.pushKV("max_time_ms", stats.nMaxTime / 1000.0);
+    result.pushKV("last_time_ms", stats.nLastTime / 1000.0);
+    {
+        LOCK(cs_main);
+        result.pushKV("cache_usage", (uint64_t)pcoinsTip->DynamicMemoryUsage());
+        result.pushKV("cache_coins", (uint64_t)pcoinsTip->GetCacheSize());
+    }
+    return result;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
@@ -2277,6 +2422,8 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockheaders",        &getblockheaders,        {"blockhash","count","verbose"} },
     { "blockchain",         "getmerkleblocks",        &getmerkleblocks,        {"filter","blockhash","count"} },
     { "blockchain",         "getchaintips",           &getchaintips,           {"count","branchlen"} },
+    { "blockchain",         "getdbstats",             &getdbstats,             {} },
+    { "blockchain",         "getcoinsflushstats",     &getcoinsflushstats,     {} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          {} },
     { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    {"txid","verbose"} },
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  {"txid","verbose"} },
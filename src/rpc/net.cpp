@@ -9,6 +9,8 @@
 #include <clientversion.h>
 #include <core_io.h>
 #include <validation.h>
+#include <llmq/quorums_signing.h>
+#include <llmq/quorums_signing_shares.h>
 #include <net.h>
 #include <net_processing.h>
 #include <netbase.h>
@@ -114,7 +116,12 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
             "    \"bytesrecv_per_msg\": {\n"
             "       \"addr\": n,              (numeric) The total bytes received aggregated by message type\n"
             "       ...\n"
-            "    }\n"
+            "    },\n"
+            "    \"sigshares_verified\": n,  (numeric) The number of LLMQ signature shares received from the peer and verified.\n"
+            "                               The sigshares_ fields are only present once the peer took part in LLMQ signing\n"
+            "    \"sigshares_invalid\": n,   (numeric) The number of invalid LLMQ signature shares received from the peer\n"
+            "    \"sigshares_verify_time\": n, (numeric) The time in microseconds spent verifying the peer's signature shares\n"
+            "    \"sigshares_per_sec\": n,   (numeric) The peer's signature shares verified per second of verification time\n"
             "  }\n"
             "  ,...\n"
             "]\n"
@@ -193,6 +200,15 @@ UniValue getpeerinfo(const JSONRPCRequest& request)
         }
         obj.push_back(Pair("bytesrecv_per_msg", recvPerMsgCmd));
 
+        int64_t nVerified, nInvalid, nVerifyTimeMicros;
+        if (llmq::quorumSigSharesManager &&
+            llmq::quorumSigSharesManager->GetNodeVerifyStats(stats.nodeid, nVerified, nInvalid, nVerifyTimeMicros)) {
+            obj.push_back(Pair("sigshares_verified", nVerified));
+            obj.push_back(Pair("sigshares_invalid", nInvalid));
+            obj.push_back(Pair("sigshares_verify_time", nVerifyTimeMicros));
+            obj.push_back(Pair("sigshares_per_sec", nVerifyTimeMicros ? nVerified * 1000000 / nVerifyTimeMicros : 0));
+        }
+
         ret.push_back(obj);
     }
 
@@ -440,6 +456,27 @@ UniValue getnetworkinfo(const JSONRPCRequest& request)
             "  \"connections\": xxxxx,                  (numeric) the number of connections\n"
             "  \"networkactive\": true|false,           (bool) whether p2p networking is enabled\n"
             "  \"socketevents\": \"xxx/\",              (string) the socket events mode, either epoll, poll or select\n"
+            "  \"msghandthreads\": [                    (array) the threads processing LLMQ, InstantSend and governance messages\n"
+            "  {\n"
+            "    \"readypeers\": xxx,                   (numeric) number of peers with queued messages\n"
+            "    \"queued\": xxx,                       (numeric) number of queued messages\n"
+            "    \"maxqueued\": xxx,                    (numeric) highest number of queued messages seen\n"
+            "    \"processed\": xxx,                    (numeric) number of processed messages\n"
+            "    \"processtime\": xxx,                  (numeric) total time spent processing messages, in microseconds\n"
+            "  }\n"
+            "  ,...\n"
+            "  ],\n"
+            "  \"recvbuffers\": {                       (json object) reuse of the buffers receiving message data\n"
+            "    \"pooled\": xxx,                       (numeric) number of buffers waiting to be reused\n"
+            "    \"pooledbytes\": xxx,                  (numeric) total size of these buffers\n"
+            "    \"commands\": {                        (json object) received messages per command\n"
+            "      \"command\": {\n"
+            "        \"reused\": xxx,                   (numeric) messages received into a reused buffer\n"
+            "        \"allocated\": xxx,                (numeric) messages for which memory had to be allocated\n"
+            "      }\n"
+            "      ,...\n"
+            "    }\n"
+            "  },\n"
             "  \"networks\": [                          (array) information per network\n"
             "  {\n"
             "    \"name\": \"xxx\",                     (string) network (ipv4, ipv6 or onion)\n"
@@ -494,7 +531,36 @@ UniValue getnetworkinfo(const JSONRPCRequest& request)
                 assert(false);
         }
         obj.push_back(Pair("socketevents", strSocketEvents));
+
+        std::vector<CMessageHandlerShardStats> vShardStats;
+        g_connman->GetMessageHandlerShardStats(vShardStats);
+        UniValue shards(UniValue::VARR);
+        for (const auto& stats : vShardStats) {
+            UniValue shard(UniValue::VOBJ);
+            shard.push_back(Pair("readypeers", (uint64_t)stats.nReadyNodes));
+            shard.push_back(Pair("queued", stats.nQueuedMsgs));
+            shard.push_back(Pair("maxqueued", stats.nMaxQueuedMsgs));
+            shard.push_back(Pair("processed", stats.nProcessedMsgs));
+            shard.push_back(Pair("processtime", stats.nProcessTimeMicros));
+            shards.push_back(shard);
+        }
+        obj.push_back(Pair("msghandthreads", shards));
+    }
+    std::map<std::string, CRecvBufferStats> mapRecvBufferStats;
+    size_t nPooledBuffers, nPooledBytes;
+    g_recv_buffer_pool.GetStats(mapRecvBufferStats, nPooledBuffers, nPooledBytes);
+    UniValue recvBuffers(UniValue::VOBJ);
+    recvBuffers.push_back(Pair("pooled", (uint64_t)nPooledBuffers));
+    recvBuffers.push_back(Pair("pooledbytes", (uint64_t)nPooledBytes));
+    UniValue recvBufferCommands(UniValue::VOBJ);
+    for (const auto& p : mapRecvBufferStats) {
+        UniValue command(UniValue::VOBJ);
+        command.push_back(Pair("reused", p.second.nReused));
+        command.push_back(Pair("allocated", p.second.nAllocated));
+        recvBufferCommands.push_back(Pair(p.first, command));
     }
+    recvBuffers.push_back(Pair("commands", recvBufferCommands));
+    obj.push_back(Pair("recvbuffers", recvBuffers));
     obj.push_back(Pair("networks",      GetNetworksInfo()));
     obj.push_back(Pair("relayfee",      ValueFromAmount(::minRelayTxFee.GetFeePerK())));
     obj.push_back(Pair("incrementalfee", ValueFromAmount(::incrementalRelayFee.GetFeePerK())));
@@ -0,0 +1,175 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+#define BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <list>
+#include <new>
+#include <utility>
+
+/**
+ * A memory resource for node based containers (std::unordered_map, std::list, ...) that allocate many small
+ * blocks of the same few sizes.
+ *
+ * Memory is taken from the system in large chunks and carved into blocks. Freed blocks are put into a free list
+ * per block size and reused by later allocations of the same size. Nothing is given back to the system before the
+ * resource is destroyed. Compared to the system allocator this avoids the per allocation overhead of malloc (which
+ * is why the memory usage can be accounted for exactly, see DynamicMemoryUsage) and keeps nodes that are allocated
+ * together close to each other.
+ *
+ * Allocations larger than MAX_BLOCK_SIZE_BYTES (e.g. the bucket array of a hash map) are forwarded to operator new.
+ *
+ * Not thread-safe. Use PoolAllocator to use it with STL containers.
+ */
+template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+class PoolResource
+{
+    static_assert(ALIGN_BYTES > 0 && (ALIGN_BYTES & (ALIGN_BYTES - 1)) == 0, "ALIGN_BYTES must be a power of two");
+    static_assert(ALIGN_BYTES >= sizeof(void*), "free list entries must fit into the smallest block");
+
+    /** Free list entries live inside of the unused blocks */
+    struct ListNode {
+        ListNode* next;
+    };
+
+    static constexpr std::size_t NUM_FREE_LISTS = MAX_BLOCK_SIZE_BYTES / ALIGN_BYTES + 1;
+
+    const std::size_t chunkSizeBytes;
+    std::list<void*> chunks;
+    std::array<ListNode*, NUM_FREE_LISTS> freeLists{};
+
+    /** Unused range of the most recently allocated chunk */
+    char* availableBegin{nullptr};
+    char* availableEnd{nullptr};
+
+    static constexpr std::size_t RoundedUpBlocks(std::size_t bytes)
+    {
+        return (bytes + ALIGN_BYTES - 1) / ALIGN_BYTES;
+    }
+
+    void PushFree(void* p, std::size_t numBlocks)
+    {
+        auto node = new (p) ListNode{freeLists[numBlocks]};
+        freeLists[numBlocks] = node;
+    }
+
+    void AllocateChunk()
+    {
+        // hand out the rest of the current chunk to the free lists so that it isn't wasted
+        if (availableBegin != availableEnd) {
+            std::size_t numBlocks = (availableEnd - availableBegin) / ALIGN_BYTES;
+            assert(numBlocks < NUM_FREE_LISTS);
+            PushFree(availableBegin, numBlocks);
+        }
+
+        void* chunk = ::operator new(chunkSizeBytes);
+        chunks.emplace_back(chunk);
+        availableBegin = static_cast<char*>(chunk);
+        availableEnd = availableBegin + chunkSizeBytes;
+    }
+
+public:
+    static constexpr std::size_t DEFAULT_CHUNK_SIZE_BYTES = 256 * 1024;
+
+    explicit PoolResource(std::size_t _chunkSizeBytes = DEFAULT_CHUNK_SIZE_BYTES) :
+        chunkSizeBytes(RoundedUpBlocks(_chunkSizeBytes) * ALIGN_BYTES)
+    {
+        assert(chunkSizeBytes >= MAX_BLOCK_SIZE_BYTES);
+    }
+
+    PoolResource(const PoolResource&) = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+
+    ~PoolResource()
+    {
+        for (void* chunk : chunks) {
+            ::operator delete(chunk);
+        }
+    }
+
+    static constexpr bool IsPooled(std::size_t bytes, std::size_t alignment)
+    {
+        return bytes <= MAX_BLOCK_SIZE_BYTES && alignment <= ALIGN_BYTES;
+    }
+
+    void* Allocate(std::size_t bytes, std::size_t alignment)
+    {
+        if (!IsPooled(bytes, alignment)) {
+            return ::operator new(bytes);
+        }
+        std::size_t numBlocks = RoundedUpBlocks(bytes ? bytes : 1);
+        if (freeLists[numBlocks]) {
+            ListNode* node = freeLists[numBlocks];
+            freeLists[numBlocks] = node->next;
+            return node;
+        }
+        if (static_cast<std::size_t>(availableEnd - availableBegin) < numBlocks * ALIGN_BYTES) {
+            AllocateChunk();
+        }
+        void* p = availableBegin;
+        availableBegin += numBlocks * ALIGN_BYTES;
+        return p;
+    }
+
+    void Deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept
+    {
+        if (!IsPooled(bytes, alignment)) {
+            ::operator delete(p);
+            return;
+        }
+        PushFree(p, RoundedUpBlocks(bytes ? bytes : 1));
+    }
+
+    std::size_t NumAllocatedChunks() const { return chunks.size(); }
+    std::size_t ChunkSizeBytes() const { return chunkSizeBytes; }
+};
+
+/**
+ * Allocator that takes its memory from a PoolResource. The resource must outlive all containers using it.
+ */
+template <typename T, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES = alignof(std::max_align_t)>
+class PoolAllocator
+{
+    template <typename U, std::size_t M, std::size_t A>
+    friend class PoolAllocator;
+
+    PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>* resource;
+
+public:
+    typedef T value_type;
+    typedef PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> ResourceType;
+
+    template <typename U>
+    struct rebind {
+        typedef PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> other;
+    };
+
+    PoolAllocator(ResourceType* _resource) noexcept : resource(_resource) {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) noexcept : resource(other.resource) {}
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(resource->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        resource->Deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    ResourceType* GetResource() const noexcept { return resource; }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) const noexcept { return resource == other.resource; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) const noexcept { return resource != other.resource; }
+};
+
+#endif // BITCOIN_SUPPORT_ALLOCATORS_POOL_H
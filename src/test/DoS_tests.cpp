@@ -4,13 +4,20 @@
 
 // Unit tests for denial-of-service detection/prevention code
 
+#include <base58.h>
 #include <chainparams.h>
+#include <hash.h>
 #include <keystore.h>
+#include <llmq/quorums_instantsend.h>
+#include <llmq/quorums_signing_shares.h>
+#include <masternode/activemasternode.h>
 #include <net.h>
 #include <net_processing.h>
+#include <netmessagemaker.h>
 #include <pow.h>
 #include <script/sign.h>
 #include <serialize.h>
+#include <spork.h>
 #include <util.h>
 #include <validation.h>
 
@@ -292,6 +299,104 @@ BOOST_AUTO_TEST_CASE(DoS_bantime)
     peerLogic->FinalizeNode(dummyNode.GetId(), dummy);
 }
 
+// Queue a message for the message handler shards of node, as the socket handler does after receiving it
+static void QueueConcurrentMessage(CNode& node, const CSerializedNetMsg& msg)
+{
+    uint256 hash = Hash(msg.data.data(), msg.data.data() + msg.data.size());
+    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), msg.data.size());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    std::vector<unsigned char> vBytes;
+    CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, vBytes, 0, hdr};
+    vBytes.insert(vBytes.end(), msg.data.begin(), msg.data.end());
+
+    CNetMessage netMsg(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+    const char* pch = (const char*)vBytes.data();
+    unsigned int nBytes = vBytes.size();
+    while (nBytes > 0) {
+        int handled = netMsg.in_data ? netMsg.readData(pch, nBytes) : netMsg.readHeader(pch, nBytes);
+        BOOST_REQUIRE(handled > 0);
+        pch += handled;
+        nBytes -= handled;
+    }
+    BOOST_CHECK(netMsg.complete());
+
+    LOCK(node.cs_vProcessMsg);
+    node.nProcessQueueSize += vBytes.size();
+    node.vProcessMsgConcurrent.emplace_back(std::move(netMsg));
+}
+
+BOOST_AUTO_TEST_CASE(DoS_sharded_messages)
+{
+    std::atomic<bool> interruptDummy(false);
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+
+    connman->ClearBanned();
+
+    // InstantSend and sig shares are only processed with their sporks on
+    CKey sporkKey;
+    sporkKey.MakeNewKey(true);
+    BOOST_CHECK(sporkManager.SetSporkAddress(EncodeDestination(sporkKey.GetPubKey().GetID())));
+    BOOST_CHECK(sporkManager.SetMinSporkKeys(1));
+    BOOST_CHECK(sporkManager.SetPrivKey(CBitcoinSecret(sporkKey).ToString()));
+    BOOST_CHECK(sporkManager.UpdateSpork(SPORK_2_INSTANTSEND_ENABLED, 0, *connman));
+    BOOST_CHECK(sporkManager.UpdateSpork(SPORK_21_QUORUM_ALL_CONNECTED, 0, *connman));
+
+    CAddress addr1(ip(0xa0b0c001), NODE_NONE);
+    CNode dummyNode1(id++, NODE_NETWORK, 0, INVALID_SOCKET, addr1, 0, 0, CAddress(), "", true);
+    dummyNode1.SetSendVersion(PROTOCOL_VERSION);
+    peerLogic->InitializeNode(&dummyNode1);
+    dummyNode1.nVersion = 1;
+    dummyNode1.fSuccessfullyConnected = true;
+
+    // A valid ISLOCK is queued by the InstantSend manager
+    llmq::CInstantSendLock islock;
+    islock.txid = InsecureRand256();
+    islock.inputs.emplace_back(InsecureRand256(), 0);
+    size_t nPending = llmq::quorumInstantSendManager->GetPendingInstantSendLockCount();
+    QueueConcurrentMessage(dummyNode1, msgMaker.Make(NetMsgType::ISLOCK, islock));
+    BOOST_CHECK(peerLogic->ProcessConcurrentMessage(&dummyNode1, interruptDummy));
+    BOOST_CHECK_EQUAL(llmq::quorumInstantSendManager->GetPendingInstantSendLockCount(), nPending + 1);
+    BOOST_CHECK(!dummyNode1.fDisconnect);
+
+    // A truncated one is answered with a REJECT
+    size_t nSendSize = dummyNode1.nSendSize;
+    QueueConcurrentMessage(dummyNode1, msgMaker.Make(NetMsgType::ISLOCK, (uint8_t)1));
+    BOOST_CHECK(peerLogic->ProcessConcurrentMessage(&dummyNode1, interruptDummy));
+    BOOST_CHECK(dummyNode1.nSendSize > nSendSize);
+    BOOST_CHECK(!dummyNode1.fDisconnect);
+
+    // An invalid one gets the peer banned
+    islock.inputs.clear();
+    QueueConcurrentMessage(dummyNode1, msgMaker.Make(NetMsgType::ISLOCK, islock));
+    BOOST_CHECK(peerLogic->ProcessConcurrentMessage(&dummyNode1, interruptDummy));
+    BOOST_CHECK(dummyNode1.fDisconnect);
+    BOOST_CHECK(connman->IsBanned(addr1));
+
+    // So does a QSIGSHARE with too many sig shares, which only masternodes process
+    fMasternodeMode = true;
+    activeMasternodeInfo.proTxHash = InsecureRand256();
+    CAddress addr2(ip(0xa0b0c002), NODE_NONE);
+    CNode dummyNode2(id++, NODE_NETWORK, 0, INVALID_SOCKET, addr2, 1, 1, CAddress(), "", true);
+    dummyNode2.SetSendVersion(PROTOCOL_VERSION);
+    peerLogic->InitializeNode(&dummyNode2);
+    dummyNode2.nVersion = 1;
+    dummyNode2.fSuccessfullyConnected = true;
+
+    std::vector<llmq::CSigShare> sigShares(100);
+    QueueConcurrentMessage(dummyNode2, msgMaker.Make(NetMsgType::QSIGSHARE, sigShares));
+    BOOST_CHECK(peerLogic->ProcessConcurrentMessage(&dummyNode2, interruptDummy));
+    BOOST_CHECK(dummyNode2.fDisconnect);
+    BOOST_CHECK(connman->IsBanned(addr2));
+
+    fMasternodeMode = false;
+    activeMasternodeInfo.proTxHash.SetNull();
+    sporkManager.Clear();
+
+    bool dummy;
+    peerLogic->FinalizeNode(dummyNode1.GetId(), dummy);
+    peerLogic->FinalizeNode(dummyNode2.GetId(), dummy);
+}
+
 CTransactionRef RandomOrphan()
 {
     std::map<uint256, COrphanTx>::iterator it;
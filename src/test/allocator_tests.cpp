@@ -4,10 +4,12 @@
 
 #include <util.h>
 
+#include <support/allocators/pool.h>
 #include <support/allocators/secure.h>
 #include <test/test_zenx.h>
 
 #include <memory>
+#include <unordered_map>
 
 #include <boost/test/unit_test.hpp>
 
@@ -233,4 +235,60 @@ BOOST_AUTO_TEST_CASE(lockedpool_tests_live)
     BOOST_CHECK(pool.stats().used == initial.used);
 }
 
+BOOST_AUTO_TEST_CASE(pool_resource)
+{
+    PoolResource<64, 8> resource(1024);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 0);
+
+    // blocks of the same size are reused after being freed
+    void* a = resource.Allocate(24, 8);
+    void* b = resource.Allocate(24, 8);
+    BOOST_CHECK(a != b);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1);
+    resource.Deallocate(a, 24, 8);
+    BOOST_CHECK(resource.Allocate(20, 8) == a);
+    // but not for a different size
+    resource.Deallocate(b, 24, 8);
+    BOOST_CHECK(resource.Allocate(32, 8) != b);
+
+    // too large or too strictly aligned allocations bypass the pool
+    void* c = resource.Allocate(65, 8);
+    void* d = resource.Allocate(8, 16);
+    resource.Deallocate(c, 65, 8);
+    resource.Deallocate(d, 8, 16);
+
+    // new chunks are allocated as needed and the rest of the old one isn't lost
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 100; i++) {
+        ptrs.emplace_back(resource.Allocate(56, 8));
+        memset(ptrs.back(), i, 56);
+    }
+    BOOST_CHECK(resource.NumAllocatedChunks() > 1);
+    for (int i = 0; i < 100; i++) {
+        BOOST_CHECK_EQUAL(((unsigned char*)ptrs[i])[55], i);
+    }
+    size_t chunks = resource.NumAllocatedChunks();
+    for (void* p : ptrs) {
+        resource.Deallocate(p, 56, 8);
+    }
+    for (int i = 0; i < 100; i++) {
+        resource.Allocate(56, 8);
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), chunks);
+
+    // as used by node based containers
+    typedef PoolAllocator<std::pair<const int, int>, 64, 8> Alloc;
+    PoolResource<64, 8> mapResource;
+    std::unordered_map<int, int, std::hash<int>, std::equal_to<int>, Alloc> map(0, std::hash<int>(), std::equal_to<int>(), Alloc(&mapResource));
+    for (int i = 0; i < 10000; i++) {
+        map.emplace(i, i * 2);
+    }
+    for (int i = 0; i < 10000; i += 2) {
+        map.erase(i);
+    }
+    BOOST_CHECK_EQUAL(map.size(), 5000);
+    BOOST_CHECK_EQUAL(map.at(4321), 8642);
+    BOOST_CHECK_EQUAL(mapResource.NumAllocatedChunks(), 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
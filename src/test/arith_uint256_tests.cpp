@@ -366,6 +366,26 @@ BOOST_AUTO_TEST_CASE( divide )
     BOOST_CHECK(R2L / MaxL == ZeroL);
     BOOST_CHECK(MaxL / R2L == 1);
     BOOST_CHECK_THROW(R2L / ZeroL, uint_error);
+
+    // Division by a single word must match the generic long division
+    BOOST_CHECK_THROW(R1L / (uint32_t)0, uint_error);
+    BOOST_CHECK(MaxL / (uint32_t)1 == MaxL);
+    BOOST_CHECK(MaxL / (uint32_t)0xffffffff == MaxL / arith_uint256(0xffffffff));
+    for (int i = 0; i < 1000; i++) {
+        arith_uint256 a = UintToArith256(InsecureRand256()) >> InsecureRandRange(256);
+        uint32_t b = InsecureRand32() >> InsecureRandRange(32);
+        if (b == 0) continue;
+        BOOST_CHECK(a / b == a / arith_uint256(b));
+    }
+    // wider divisors, like the int64_t timespans in pow.cpp, must not be narrowed
+    BOOST_CHECK(MaxL / (uint64_t)0x100000000ULL == MaxL >> 32);
+    BOOST_CHECK(R1L / (int64_t)0x123456789LL == R1L / arith_uint256(0x123456789ULL));
+    for (int i = 0; i < 1000; i++) {
+        arith_uint256 a = UintToArith256(InsecureRand256()) >> InsecureRandRange(256);
+        uint64_t b = InsecureRandBits(64) >> InsecureRandRange(64);
+        if (b == 0) continue;
+        BOOST_CHECK(a / b == a / arith_uint256(b));
+    }
 }
 
 
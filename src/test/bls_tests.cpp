@@ -152,6 +152,14 @@ BOOST_AUTO_TEST_CASE(batch_verifier_tests)
     // last message invalid from one source
     AddMessage(msgs, 1, 7, 1, false);
     Verify(msgs);
+
+    msgs.clear();
+    // many messages from a single source with a few invalid ones spread out, which must all be found
+    for (uint32_t i = 0; i < 37; i++) {
+        AddMessage(msgs, 1, i, i % 5, i != 0 && i != 17 && i != 18 && i != 36);
+    }
+    AddMessage(msgs, 2, 100, 1, true);
+    Verify(msgs);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
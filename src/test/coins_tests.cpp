@@ -3,7 +3,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <coins.h>
+#include <chainparams.h>
 #include <script/standard.h>
+#include <txdb.h>
 #include <uint256.h>
 #include <undo.h>
 #include <utilstrencodings.h>
@@ -87,6 +89,32 @@ public:
         }
         BOOST_CHECK_EQUAL(GetCacheSize(), count);
         BOOST_CHECK_EQUAL(DynamicMemoryUsage(), ret);
+
+        // The dirty list holds exactly the DIRTY entries
+        size_t nDirty = 0;
+        for (const auto& entry : cacheCoins) {
+            nDirty += (entry.second.flags & CCoinsCacheEntry::DIRTY) != 0;
+        }
+        size_t nLinked = 0;
+        for (const CCoinsMap::value_type* p = dirtySentinel.second.pNextDirty; p != &dirtySentinel; p = p->second.pNextDirty) {
+            BOOST_CHECK(p->second.flags & CCoinsCacheEntry::DIRTY);
+            BOOST_CHECK(p->second.pNextDirty->second.pPrevDirty == p);
+            ++nLinked;
+        }
+        BOOST_CHECK_EQUAL(nLinked, nDirty);
+    }
+
+    // Insert an entry the way the cache itself would, including linking it if it is DIRTY
+    size_t InsertEntry(const COutPoint& outpoint, CCoinsCacheEntry&& entry)
+    {
+        auto inserted = cacheCoins.emplace(outpoint, std::move(entry));
+        assert(inserted.second);
+        if (inserted.first->second.flags & CCoinsCacheEntry::DIRTY) {
+            LinkDirty(*inserted.first);
+        }
+        size_t nUsage = inserted.first->second.coin.DynamicMemoryUsage();
+        cachedCoinsUsage += nUsage;
+        return nUsage;
     }
 
     CCoinsMap& map() const { return cacheCoins; }
@@ -586,7 +614,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map(0, SaltedOutpointHasher(), CCoinsMap::key_equal(), &resource);
     InsertCoinsMapEntry(map, value, flags);
     view.BatchWrite(map, {});
 }
@@ -597,7 +626,12 @@ public:
     SingleEntryCacheTest(CAmount base_value, CAmount cache_value, char cache_flags)
     {
         WriteCoinsViewEntry(base, base_value, base_value == ABSENT ? NO_ENTRY : DIRTY);
-        cache.usage() += InsertCoinsMapEntry(cache.map(), cache_value, cache_flags);
+        if (cache_value != ABSENT) {
+            CCoinsCacheEntry entry;
+            entry.flags = cache_flags;
+            SetCoinsValue(cache_value, entry.coin);
+            cache.InsertEntry(OUTPOINT, std::move(entry));
+        }
     }
 
     CCoinsView root;
@@ -855,4 +889,321 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_prefetch)
+{
+    CCoinsViewTest base;
+    std::vector<COutPoint> outpoints;
+    {
+        CCoinsViewCacheTest filler(&base);
+        for (int i = 0; i < 40; i++) {
+            outpoints.emplace_back(InsecureRand256(), i);
+            Coin coin;
+            coin.out.nValue = 1000 + i;
+            coin.nHeight = 1;
+            filler.AddCoin(outpoints.back(), std::move(coin), false);
+        }
+        BOOST_CHECK(filler.Flush());
+    }
+
+    CCoinsViewCacheTest cache(&base);
+    // already spent in the cache, must not be resurrected from the base
+    cache.AccessCoin(outpoints[0]);
+    BOOST_CHECK(cache.SpendCoin(outpoints[0]));
+
+    CMutableTransaction tx1;
+    for (size_t i = 0; i < 30; i++) {
+        tx1.vin.emplace_back(outpoints[i]);
+    }
+    tx1.vin.emplace_back(COutPoint(InsecureRand256(), 0)); // missing
+    tx1.vout.resize(1);
+    CMutableTransaction tx2;
+    tx2.vin.emplace_back(CTransaction(tx1).GetHash(), 0); // created in the same block
+    tx2.vin.emplace_back(outpoints[5]); // duplicate
+    tx2.vin.emplace_back(outpoints[35]);
+    tx2.vout.resize(1);
+    CBlock block;
+    block.vtx.emplace_back(MakeTransactionRef(tx1));
+    block.vtx.emplace_back(MakeTransactionRef(tx2));
+
+    BOOST_CHECK_EQUAL(PrefetchBlockCoins(block, cache, base), 30);
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 31);
+    BOOST_CHECK(!cache.HaveCoinInCache(outpoints[0]));
+    for (int i = 1; i < 30; i++) {
+        auto it = cache.map().find(outpoints[i]);
+        BOOST_CHECK(it != cache.map().end() && it->second.flags == 0);
+        BOOST_CHECK_EQUAL(it->second.coin.out.nValue, 1000 + i);
+    }
+    BOOST_CHECK(cache.HaveCoinInCache(outpoints[35]));
+    BOOST_CHECK(!cache.HaveCoinInCache(outpoints[36]));
+
+    // nothing left to do
+    BOOST_CHECK_EQUAL(PrefetchBlockCoins(block, cache, base), 0);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_write_dirty)
+{
+    CCoinsViewTest root;
+    CCoinsViewCacheTest base(&root);
+    CCoinsViewCacheTest cache(&base);
+    uint256 hashBlock = InsecureRand256();
+    cache.SetBestBlock(hashBlock);
+
+    // some clean coins, which must stay cached and unmodified
+    std::vector<COutPoint> clean;
+    for (int i = 0; i < 50; i++) {
+        clean.emplace_back(InsecureRand256(), 0);
+        Coin coin;
+        coin.out.nValue = 1;
+        base.AddCoin(clean.back(), std::move(coin), false);
+        cache.AccessCoin(clean.back());
+    }
+    // modified ones: new coins, and spent coins which the base still has
+    std::vector<COutPoint> added;
+    for (int i = 0; i < 200; i++) {
+        added.emplace_back(InsecureRand256(), 1);
+        Coin coin;
+        coin.out.nValue = 1000 + i;
+        cache.AddCoin(added.back(), std::move(coin), false);
+    }
+    for (int i = 0; i < 10; i++) {
+        BOOST_CHECK(cache.SpendCoin(clean[i]));
+    }
+    cache.SelfTest();
+
+    size_t nWritten;
+    BOOST_CHECK(cache.WriteDirtyEntries(80, nWritten));
+    BOOST_CHECK_EQUAL(nWritten, 80);
+    // the base doesn't move on to our best block before all entries are written
+    BOOST_CHECK(base.GetBestBlock() != hashBlock);
+    size_t nTotal = nWritten;
+    while (nWritten != 0) {
+        BOOST_CHECK(cache.WriteDirtyEntries(80, nWritten));
+        nTotal += nWritten;
+    }
+    BOOST_CHECK_EQUAL(nTotal, 210);
+    cache.SelfTest();
+
+    // everything is written and still cached, except for the spent coins
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 240);
+    for (auto& entry : cache.map()) {
+        BOOST_CHECK_EQUAL(entry.second.flags, 0);
+    }
+    for (int i = 0; i < 200; i++) {
+        BOOST_CHECK(base.HaveCoinInCache(added[i]));
+        BOOST_CHECK(cache.HaveCoinInCache(added[i]));
+        BOOST_CHECK_EQUAL(cache.AccessCoin(added[i]).out.nValue, 1000 + i);
+    }
+    for (int i = 0; i < 50; i++) {
+        BOOST_CHECK_EQUAL(base.HaveCoin(clean[i]), i >= 10);
+        BOOST_CHECK_EQUAL(cache.HaveCoinInCache(clean[i]), i >= 10);
+    }
+
+    // Sync writes the rest and completes the transition to our best block
+    Coin coin;
+    coin.out.nValue = 5;
+    cache.AddCoin(clean[20], std::move(coin), true);
+    BOOST_CHECK(cache.Sync(80, nWritten));
+    BOOST_CHECK_EQUAL(nWritten, 1);
+    BOOST_CHECK(base.GetBestBlock() == hashBlock);
+    BOOST_CHECK_EQUAL(base.AccessCoin(clean[20]).out.nValue, 5);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 240);
+    cache.SelfTest();
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_write_dirty_order)
+{
+    CCoinsViewTest root;
+    CCoinsViewCacheTest base(&root);
+    CCoinsViewCacheTest cache(&base);
+    cache.SetBestBlock(InsecureRand256());
+
+    // clean entries are never visited by WriteDirtyEntries
+    for (int i = 0; i < 1000; i++) {
+        COutPoint outpoint(InsecureRand256(), 0);
+        Coin coin;
+        coin.out.nValue = 1;
+        base.AddCoin(outpoint, std::move(coin), false);
+        cache.AccessCoin(outpoint);
+    }
+
+    std::vector<COutPoint> dirty;
+    for (int i = 0; i < 200; i++) {
+        dirty.emplace_back(InsecureRand256(), 0);
+        Coin coin;
+        coin.out.nValue = 1000 + i;
+        cache.AddCoin(dirty.back(), std::move(coin), false);
+    }
+    // modifying an entry again keeps its place in the order
+    Coin coin;
+    coin.out.nValue = 5;
+    cache.AddCoin(dirty[0], std::move(coin), true);
+    cache.SelfTest();
+
+    // the entries are written one at a time in the order in which they were first modified
+    size_t nWritten;
+    for (int i = 0; i < 200; i++) {
+        BOOST_CHECK(cache.WriteDirtyEntries(1, nWritten));
+        BOOST_REQUIRE_EQUAL(nWritten, 1);
+        BOOST_CHECK_EQUAL(cache.map().at(dirty[i]).flags, 0);
+        if (i + 1 < 200) {
+            BOOST_CHECK(cache.map().at(dirty[i + 1]).flags & CCoinsCacheEntry::DIRTY);
+        }
+    }
+    BOOST_CHECK(cache.WriteDirtyEntries(1, nWritten));
+    BOOST_CHECK_EQUAL(nWritten, 0);
+    BOOST_CHECK_EQUAL(base.GetCacheSize(), 1200);
+    BOOST_CHECK_EQUAL(base.AccessCoin(dirty[0]).out.nValue, 5);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 1200);
+    cache.SelfTest();
+
+    // an entry that became clean and is modified again goes to the end of the list
+    BOOST_CHECK(cache.SpendCoin(dirty[1]));
+    BOOST_CHECK(cache.SpendCoin(dirty[0]));
+    BOOST_CHECK(cache.WriteDirtyEntries(1, nWritten));
+    BOOST_CHECK_EQUAL(nWritten, 1);
+    BOOST_CHECK(!cache.HaveCoinInCache(dirty[1]));
+    BOOST_CHECK(!base.HaveCoinInCache(dirty[1]));
+    BOOST_CHECK(base.HaveCoinInCache(dirty[0]));
+    cache.SelfTest();
+}
+
+static void CheckHeadBlocks(const CCoinsView& view, const uint256& hashNew, const uint256& hashOld)
+{
+    std::vector<uint256> heads = view.GetHeadBlocks();
+    BOOST_CHECK(view.GetBestBlock().IsNull());
+    BOOST_REQUIRE_EQUAL(heads.size(), 2);
+    BOOST_CHECK(heads[0] == hashNew);
+    BOOST_CHECK(heads[1] == hashOld);
+}
+
+BOOST_FIXTURE_TEST_CASE(ccoins_db_partial_write, TestingSetup)
+{
+    CCoinsViewDB db(1 << 20, true);
+    uint256 hashOld = InsecureRand256();
+    COutPoint spentOutpoint(InsecureRand256(), 0);
+    {
+        CCoinsViewCache cache(&db);
+        cache.SetBestBlock(hashOld);
+        Coin coin;
+        coin.out.nValue = 1;
+        cache.AddCoin(spentOutpoint, std::move(coin), false);
+        BOOST_CHECK(cache.Flush());
+    }
+    BOOST_CHECK(db.GetBestBlock() == hashOld);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+
+    CCoinsViewCache cache(&db);
+    uint256 hashNew = InsecureRand256();
+    cache.SetBestBlock(hashNew);
+    std::vector<COutPoint> added;
+    for (int i = 0; i < 100; i++) {
+        added.emplace_back(InsecureRand256(), 0);
+        Coin coin;
+        coin.out.nValue = 1000 + i;
+        cache.AddCoin(added.back(), std::move(coin), false);
+    }
+    BOOST_CHECK(cache.SpendCoin(spentOutpoint));
+
+    // a partial write marks the DB as being in the middle of the transition from hashOld to hashNew
+    size_t nWritten;
+    BOOST_CHECK(cache.WriteDirtyEntries(10, nWritten));
+    BOOST_CHECK_EQUAL(nWritten, 10);
+    CheckHeadBlocks(db, hashNew, hashOld);
+
+    // the cache moved on in the meantime. The transition still starts at hashOld, which is the last consistent state
+    uint256 hashNewer = InsecureRand256();
+    cache.SetBestBlock(hashNewer);
+    BOOST_CHECK(cache.WriteDirtyEntries(10, nWritten));
+    BOOST_CHECK_EQUAL(nWritten, 10);
+    CheckHeadBlocks(db, hashNewer, hashOld);
+
+    // exactly the written entries reached the DB
+    size_t nInDB = 0;
+    for (auto& outpoint : added) {
+        nInDB += db.HaveCoin(outpoint);
+    }
+    BOOST_CHECK_EQUAL(nInDB + !db.HaveCoin(spentOutpoint), 20);
+
+    // Sync writes the rest and marks the DB as consistent with hashNewer
+    BOOST_CHECK(cache.Sync(10, nWritten));
+    BOOST_CHECK_EQUAL(nWritten, 81);
+    BOOST_CHECK(db.GetBestBlock() == hashNewer);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    for (int i = 0; i < 100; i++) {
+        Coin coin;
+        BOOST_CHECK(db.GetCoin(added[i], coin));
+        BOOST_CHECK_EQUAL(coin.out.nValue, 1000 + i);
+    }
+    BOOST_CHECK(!db.HaveCoin(spentOutpoint));
+}
+
+BOOST_FIXTURE_TEST_CASE(ccoins_replay_after_partial_flush, TestChain100Setup)
+{
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    FlushStateToDisk();
+    uint256 hashOld;
+    {
+        LOCK(cs_main);
+        hashOld = chainActive.Tip()->GetBlockHash();
+        BOOST_CHECK(pcoinsdbview->GetBestBlock() == hashOld);
+    }
+
+    // connect a few more blocks, one of them spending a mature coinbase
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(coinbaseTxns[0].GetHash(), 0);
+    spend.vout.resize(1);
+    spend.vout[0].nValue = 11 * CENT;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+
+    std::vector<CBlock> blocks;
+    for (int i = 0; i < 5; i++) {
+        std::vector<CMutableTransaction> txns;
+        if (i == 2) {
+            txns.emplace_back(spend);
+        }
+        blocks.emplace_back(CreateAndProcessBlock(txns, scriptPubKey));
+    }
+
+    LOCK(cs_main);
+    uint256 hashNew = chainActive.Tip()->GetBlockHash();
+    BOOST_CHECK(blocks.back().GetHash() == hashNew);
+    BOOST_CHECK(pcoinsTip->GetBestBlock() == hashNew);
+
+    // crash in the middle of a partial flush: only some of the modified coins make it to disk
+    size_t nWritten;
+    BOOST_CHECK(pcoinsTip->WriteDirtyEntries(2, nWritten));
+    BOOST_CHECK_EQUAL(nWritten, 2);
+    CheckHeadBlocks(*pcoinsdbview, hashNew, hashOld);
+    pcoinsTip.reset();
+
+    // on restart, the blocks since the last consistent state are rolled forward again
+    BOOST_CHECK(ReplayBlocks(Params(), pcoinsdbview.get()));
+    BOOST_CHECK(pcoinsdbview->GetBestBlock() == hashNew);
+    BOOST_CHECK(pcoinsdbview->GetHeadBlocks().empty());
+    pcoinsTip.reset(new CCoinsViewCache(pcoinsdbview.get()));
+
+    for (auto& block : blocks) {
+        for (auto& tx : block.vtx) {
+            for (size_t n = 0; n < tx->vout.size(); n++) {
+                if (tx->vout[n].scriptPubKey.IsUnspendable()) {
+                    continue;
+                }
+                Coin coin;
+                BOOST_CHECK(pcoinsTip->GetCoin(COutPoint(tx->GetHash(), n), coin));
+                BOOST_CHECK(coin.out == tx->vout[n]);
+            }
+        }
+    }
+    BOOST_CHECK(!pcoinsTip->HaveCoin(spend.vin[0].prevout));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
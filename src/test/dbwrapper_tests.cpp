@@ -318,5 +318,112 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
 }
 
 
+BOOST_AUTO_TEST_CASE(dbwrapper_tuning)
+{
+    std::string strError;
+    gArgs.ForceSetArg("-dbtuning", "chainstate:maxopenfiles=1");
+    BOOST_CHECK(!CheckDBTuningArgs(strError));
+    // LevelDB would silently raise it to 74
+    gArgs.ForceSetArg("-dbtuning", "chainstate:maxopenfiles=73");
+    BOOST_CHECK(!CheckDBTuningArgs(strError));
+    gArgs.ForceSetArg("-dbtuning", "chainstate:maxopenfiles=74");
+    BOOST_CHECK(CheckDBTuningArgs(strError));
+    gArgs.ForceSetArg("-dbtuning", "foo:blocksize=4096");
+    BOOST_CHECK(!CheckDBTuningArgs(strError));
+    gArgs.ForceSetArg("-dbtuning", "all:compression");
+    BOOST_CHECK(!CheckDBTuningArgs(strError));
+
+    gArgs.ForceSetArg("-dbtuning", "chainstate:maxopenfiles=500,bloombits=0,blockcache=80");
+    BOOST_CHECK(CheckDBTuningArgs(strError));
+    BOOST_CHECK_EQUAL(GetDBTuningExtraFileDescriptors(), 500 - 64);
+
+    fs::path ph = fs::temp_directory_path() / fs::unique_path() / "chainstate";
+    {
+        CDBWrapper dbw(ph, 1 << 20);
+        BOOST_CHECK_EQUAL(dbw.GetName(), "chainstate");
+        BOOST_CHECK_EQUAL(dbw.GetTuning().nMaxOpenFiles, 500);
+        BOOST_CHECK_EQUAL(dbw.GetTuning().nBloomBits, 0);
+        BOOST_CHECK_EQUAL(dbw.GetTuning().nBlockCachePercent, 80);
+        BOOST_CHECK_EQUAL(dbw.GetTuning().nBlockSize, CDBTuningProfile().nBlockSize);
+        BOOST_CHECK(dbw.Write('k', InsecureRand256()));
+
+        bool found = false;
+        ForEachDBWrapper([&](const CDBWrapper& w) {
+            std::string stats;
+            if (&w == &dbw) {
+                found = w.GetProperty("leveldb.stats", stats);
+            }
+        });
+        BOOST_CHECK(found);
+    }
+    ForEachDBWrapper([&](const CDBWrapper& w) {
+        BOOST_CHECK(w.GetName() != "chainstate");
+    });
+    fs::remove_all(ph.parent_path());
+
+    gArgs.ForceRemoveArg("-dbtuning");
+}
+
+template <typename Transaction>
+static std::vector<std::pair<uint32_t, uint32_t>> IterateAll(Transaction& t, uint32_t seekKey)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> ret;
+    auto it = t.NewIteratorUniquePtr();
+    it->Seek(seekKey);
+    for (; it->Valid(); it->Next()) {
+        uint32_t k, v;
+        BOOST_CHECK(it->GetKey(k));
+        BOOST_CHECK(it->GetValue(v));
+        ret.emplace_back(k, v);
+    }
+    return ret;
+}
+
+BOOST_AUTO_TEST_CASE(dbtransaction_flat)
+{
+    // CDBFlatTransaction must behave exactly like CDBTransaction
+    CDBWrapper dbw1(fs::path(), 1 << 20, true);
+    CDBWrapper dbw2(fs::path(), 1 << 20, true);
+    for (uint32_t i = 0; i < 100; i += 2) {
+        dbw1.Write(i, i);
+        dbw2.Write(i, i);
+    }
+
+    CDBBatch batch1(dbw1), batch2(dbw2);
+    CDBTransaction<CDBWrapper, CDBBatch> t1(dbw1, batch1);
+    CDBFlatTransaction<CDBWrapper, CDBBatch> t2(dbw2, batch2);
+
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 1000; i++) {
+            uint32_t k = InsecureRandRange(150);
+            if (InsecureRandBool()) {
+                uint32_t v = InsecureRand32();
+                t1.Write(k, v);
+                t2.Write(k, v);
+            } else {
+                t1.Erase(k);
+                t2.Erase(k);
+            }
+        }
+        BOOST_CHECK_EQUAL(t1.GetMemoryUsage(), t2.GetMemoryUsage());
+        for (uint32_t k = 0; k < 150; k++) {
+            uint32_t v1 = 0, v2 = 0;
+            BOOST_CHECK_EQUAL(t1.Read(k, v1), t2.Read(k, v2));
+            BOOST_CHECK_EQUAL(v1, v2);
+            BOOST_CHECK_EQUAL(t1.Exists(k), t2.Exists(k));
+        }
+        uint32_t seekKey = InsecureRandRange(150);
+        BOOST_CHECK(IterateAll(t1, seekKey) == IterateAll(t2, seekKey));
+
+        t1.Commit();
+        t2.Commit();
+        BOOST_CHECK(t2.IsClean());
+        dbw1.WriteBatch(batch1);
+        dbw2.WriteBatch(batch2);
+        batch1.Clear();
+        batch2.Clear();
+        BOOST_CHECK(IterateAll(t1, 0) == IterateAll(t2, 0));
+    }
+}
 
 BOOST_AUTO_TEST_SUITE_END()
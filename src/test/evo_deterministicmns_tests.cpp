@@ -450,4 +450,120 @@ BOOST_FIXTURE_TEST_CASE(dip3_protx, TestChainDIP3Setup)
 
     const_cast<Consensus::Params&>(Params().GetConsensus()).DIP0003EnforcementHeight = DIP0003EnforcementHeightBackup;
 }
+
+BOOST_FIXTURE_TEST_CASE(dip3_list_cache, TestChainDIP3Setup)
+{
+    auto utxos = BuildSimpleUtxoMap(coinbaseTxns);
+
+    int nStartHeight = chainActive.Height();
+    size_t nStartCount = deterministicMNManager->GetListAtChainTip().GetAllMNsCount();
+    for (size_t i = 0; i < 10; i++) {
+        CKey ownerKey;
+        CBLSSecretKey operatorKey;
+        auto tx = CreateProRegTx(utxos, i + 1, GenerateRandomAddress(), coinbaseKey, ownerKey, operatorKey);
+        CreateAndProcessBlock({tx}, coinbaseKey);
+        deterministicMNManager->UpdatedBlockTip(chainActive.Tip());
+    }
+
+    // Fresh managers have neither the lists built while connecting blocks nor a tip, so every historic list
+    // they are asked for has to be built from diffs. Without an LRU, nothing is remembered in between.
+    CDeterministicMNManager cachedManager(*evoDb, DEFAULT_DMN_LIST_CACHE << 20);
+    CDeterministicMNManager uncachedManager(*evoDb, 0);
+
+    int nLists = chainActive.Height() - nStartHeight + 1;
+    CDeterministicMNListsLRUStats stats;
+
+    // query historic lists twice, the second round is served from the LRU
+    for (int round = 0; round < 2; round++) {
+        for (int nHeight = nStartHeight; nHeight <= chainActive.Height(); nHeight++) {
+            auto mnList = cachedManager.GetListForBlock(chainActive[nHeight]);
+            auto mnListUncached = uncachedManager.GetListForBlock(chainActive[nHeight]);
+            BOOST_CHECK(mnList.GetBlockHash() == chainActive[nHeight]->GetBlockHash());
+            BOOST_CHECK_EQUAL(mnList.GetHeight(), nHeight);
+            BOOST_CHECK_EQUAL(mnList.GetAllMNsCount(), nStartCount + nHeight - nStartHeight);
+            BOOST_CHECK(!mnList.BuildDiff(mnListUncached).HasChanges());
+        }
+
+        auto roundStats = cachedManager.GetListsLRUStats();
+        if (round == 0) {
+            // apart from the first DIP3 lists (which are snapshots on disk), every list was built from diffs
+            // and the LRU has room for all of them
+            BOOST_CHECK(roundStats.nRebuilt >= (uint64_t)nLists - 2);
+            BOOST_CHECK_EQUAL(roundStats.nLists, roundStats.nRebuilt);
+            BOOST_CHECK_EQUAL(roundStats.nEvicted, 0);
+        } else {
+            // every list built from diffs before is a hit now, nothing is built again
+            BOOST_CHECK_EQUAL(roundStats.nRebuilt, stats.nRebuilt);
+            BOOST_CHECK_EQUAL(roundStats.nHits, stats.nHits + stats.nLists);
+            BOOST_CHECK_EQUAL(roundStats.nLists, stats.nLists);
+            BOOST_CHECK_EQUAL(roundStats.nEvicted, 0);
+        }
+        stats = roundStats;
+    }
+
+    auto uncachedStats = uncachedManager.GetListsLRUStats();
+    BOOST_CHECK_EQUAL(uncachedStats.nLists, 0);
+    BOOST_CHECK_EQUAL(uncachedStats.nUsage, 0);
+    BOOST_CHECK_EQUAL(uncachedStats.nHits, 0);
+    BOOST_CHECK_EQUAL(uncachedStats.nRebuilt, 2 * stats.nRebuilt);
+
+    // an LRU with room for about two lists evicts the least recently used ones
+    size_t nMaxUsage = 2 * deterministicMNManager->GetListAtChainTip().EstimateMemoryUsage();
+    CDeterministicMNManager smallManager(*evoDb, nMaxUsage);
+    for (int nHeight = nStartHeight; nHeight <= chainActive.Height(); nHeight++) {
+        smallManager.GetListForBlock(chainActive[nHeight]);
+    }
+    auto smallStats = smallManager.GetListsLRUStats();
+    BOOST_CHECK_EQUAL(smallStats.nRebuilt, stats.nRebuilt);
+    BOOST_CHECK(smallStats.nLists <= 2);
+    BOOST_CHECK_EQUAL(smallStats.nLists + smallStats.nEvicted, smallStats.nRebuilt);
+    BOOST_CHECK(smallStats.nUsage <= nMaxUsage);
+
+    // the most recent list is still cached, the oldest one was evicted and has to be built again
+    smallManager.GetListForBlock(chainActive.Tip());
+    BOOST_CHECK_EQUAL(smallManager.GetListsLRUStats().nHits, smallStats.nHits + 1);
+    BOOST_CHECK_EQUAL(smallManager.GetListsLRUStats().nRebuilt, smallStats.nRebuilt);
+    auto mnList = smallManager.GetListForBlock(chainActive[nStartHeight + 2]);
+    BOOST_CHECK_EQUAL(mnList.GetAllMNsCount(), nStartCount + 2);
+    BOOST_CHECK_EQUAL(smallManager.GetListsLRUStats().nRebuilt, smallStats.nRebuilt + 1);
+}
+
+BOOST_FIXTURE_TEST_CASE(dip3_calculate_quorum, BasicTestingSetup)
+{
+    CDeterministicMNList mnList(uint256(), 0, 0);
+    for (uint64_t i = 0; i < 500; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>(i);
+        dmn->proTxHash = InsecureRand256();
+        dmn->collateralOutpoint = COutPoint(InsecureRand256(), 0);
+        auto dmnState = std::make_shared<CDeterministicMNState>();
+        dmnState->keyIDOwner = CKeyID(uint160(insecure_rand_ctx.randbytes(20)));
+        if (i % 10 != 0) {
+            // leave some MNs unconfirmed, these must not be selected
+            dmnState->UpdateConfirmedHash(dmn->proTxHash, InsecureRand256());
+        }
+        dmn->pdmnState = dmnState;
+        mnList.AddMN(dmn);
+    }
+
+    for (size_t maxSize : {0, 1, 50, 449, 450, 500}) {
+        uint256 modifier = InsecureRand256();
+
+        // reference: full sort of all scores in descending order
+        auto scores = mnList.CalculateScores(modifier);
+        std::sort(scores.rbegin(), scores.rend(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, const std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
+            if (a.first == b.first) {
+                return a.second->collateralOutpoint < b.second->collateralOutpoint;
+            }
+            return a.first < b.first;
+        });
+
+        auto quorum = mnList.CalculateQuorum(maxSize, modifier);
+        BOOST_CHECK_EQUAL(quorum.size(), std::min(maxSize, scores.size()));
+        for (size_t i = 0; i < quorum.size(); i++) {
+            BOOST_CHECK(quorum[i]->proTxHash == scores[i].second->proTxHash);
+            BOOST_CHECK(!quorum[i]->pdmnState->confirmedHash.IsNull());
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
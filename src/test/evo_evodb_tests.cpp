@@ -0,0 +1,132 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/test_zenx.h>
+
+#include <evo/evodb.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(evo_evodb_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(evodb_object_cache)
+{
+    CEvoDB db(1 << 20, true);
+    uint256 v1 = InsecureRand256(), v2 = InsecureRand256(), v;
+
+    {
+        auto dbTx = db.BeginTransaction();
+        db.Write(std::string("a"), v1);
+        db.Write(std::string("b"), v1);
+        dbTx->Commit();
+    }
+    BOOST_CHECK(db.CommitRootTransaction());
+
+    // committed objects are served from the cache
+    auto stats = db.GetObjectCacheStats();
+    BOOST_CHECK_EQUAL(stats.entries, 2);
+    BOOST_CHECK(db.Read(std::string("a"), v) && v == v1);
+    BOOST_CHECK(db.Exists(std::string("b")));
+    BOOST_CHECK_EQUAL(db.GetObjectCacheStats().hits, stats.hits + 2);
+    BOOST_CHECK_EQUAL(db.GetObjectCacheStats().misses, stats.misses);
+
+    // pending writes and erases shadow the cache
+    {
+        auto dbTx = db.BeginTransaction();
+        db.Write(std::string("a"), v2);
+        db.Erase(std::string("b"));
+        BOOST_CHECK(db.Read(std::string("a"), v) && v == v2);
+        BOOST_CHECK(!db.Exists(std::string("b")));
+        dbTx->Rollback();
+    }
+    BOOST_CHECK(db.Read(std::string("a"), v) && v == v1);
+
+    {
+        auto dbTx = db.BeginTransaction();
+        db.Erase(std::string("b"));
+        dbTx->Commit();
+    }
+    BOOST_CHECK(db.CommitRootTransaction());
+    BOOST_CHECK(!db.Exists(std::string("b")));
+    BOOST_CHECK_EQUAL(db.GetObjectCacheStats().entries, 1);
+
+    // direct writes drop the written object from the cache and the new value is read from disk
+    BOOST_CHECK(db.WriteRaw(std::string("a"), v2));
+    BOOST_CHECK_EQUAL(db.GetObjectCacheStats().entries, 0);
+    stats = db.GetObjectCacheStats();
+    BOOST_CHECK(db.Read(std::string("a"), v) && v == v2);
+    BOOST_CHECK_EQUAL(db.GetObjectCacheStats().misses, stats.misses + 1);
+    BOOST_CHECK(db.Read(std::string("a"), v) && v == v2);
+    BOOST_CHECK_EQUAL(db.GetObjectCacheStats().hits, stats.hits + 1);
+}
+
+BOOST_AUTO_TEST_CASE(evodb_object_cache_raw_access)
+{
+    CEvoDB db(1 << 20, true);
+    uint256 v1 = InsecureRand256(), v2 = InsecureRand256(), v;
+
+    {
+        auto dbTx = db.BeginTransaction();
+        db.Write(std::string("a"), v1);
+        db.Write(std::string("b"), v1);
+        dbTx->Commit();
+    }
+    BOOST_CHECK(db.CommitRootTransaction());
+    BOOST_CHECK_EQUAL(db.GetObjectCacheStats().entries, 2);
+
+    // only the object written or erased directly is invalidated
+    BOOST_CHECK(db.EraseRaw(std::string("b")));
+    BOOST_CHECK_EQUAL(db.GetObjectCacheStats().entries, 1);
+    BOOST_CHECK(!db.Exists(std::string("b")));
+    BOOST_CHECK(db.Read(std::string("a"), v) && v == v1);
+
+    // a raw batch may touch any object, so the whole cache is dropped
+    CDBBatch batch(db.GetRawDB());
+    batch.Write(std::string("b"), v2);
+    BOOST_CHECK(db.WriteRawBatch(batch));
+    BOOST_CHECK_EQUAL(db.GetObjectCacheStats().entries, 0);
+    BOOST_CHECK(db.Read(std::string("b"), v) && v == v2);
+}
+
+BOOST_AUTO_TEST_CASE(evodb_object_cache_memory_usage)
+{
+    CDBWrapper dbw(fs::path(), 1 << 20, true);
+    CDBBatch batch(dbw);
+
+    auto makeKey = [](int i) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << std::make_pair(std::string("key"), i);
+        return ssKey;
+    };
+
+    // measure a single object
+    size_t objectUsage;
+    {
+        CEvoDBObjectCache cache(dbw, batch, 1 << 20);
+        cache.Write(makeKey(0), InsecureRand256());
+        objectUsage = cache.GetStats().memoryUsage;
+        batch.Clear();
+    }
+    // the estimate covers the cache's own bookkeeping, not just the serialized key and value
+    BOOST_CHECK(objectUsage > makeKey(0).size() + 32 + sizeof(uint256));
+
+    // the cache stays within its limit by evicting the least recently used objects
+    CEvoDBObjectCache cache(dbw, batch, objectUsage * 10);
+    for (int i = 0; i < 100; i++) {
+        cache.Write(makeKey(i), InsecureRand256());
+    }
+    auto stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.entries, 10);
+    BOOST_CHECK(stats.memoryUsage <= objectUsage * 10);
+
+    // evicted objects are read from disk again
+    BOOST_CHECK(dbw.WriteBatch(batch));
+    uint256 v;
+    BOOST_CHECK(cache.Read(makeKey(89), v));
+    BOOST_CHECK_EQUAL(cache.GetStats().misses, stats.misses + 1);
+    BOOST_CHECK(cache.Read(makeKey(99), v));
+    BOOST_CHECK_EQUAL(cache.GetStats().hits, stats.hits + 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
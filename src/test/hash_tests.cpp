@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <hash.h>
+#include <primitives/block.h>
 #include <utilstrencodings.h>
 #include <test/test_zenx.h>
 
@@ -149,4 +150,79 @@ BOOST_AUTO_TEST_CASE(siphash)
     BOOST_CHECK_EQUAL(SipHashUint256(1, 2, ss.GetHash()), 0x79751e980c2a0a35ULL);
 }
 
+BOOST_AUTO_TEST_CASE(x11)
+{
+    const std::string empty;
+    const std::string fox = "The quick brown fox jumps over the lazy dog";
+    BOOST_CHECK_EQUAL(HashX11(empty.begin(), empty.end()).ToString(), "ba4e5867eb17cdc33dccb6cc7175256320e2b4627ec221a26e5783902072b551");
+    BOOST_CHECK_EQUAL(HashX11(fox.begin(), fox.end()).ToString(), "5cbc66e69d1c11fe78983d2e533bf2c29d440072f7027f44326bf1e4a4364553");
+
+    // The batched version must match the single one for every lane, including
+    // batches that are not a multiple of the lane count.
+    std::vector<unsigned char> in(19 * 176);
+    for (size_t i = 0; i < in.size(); ++i) {
+        in[i] = InsecureRandBits(8);
+    }
+    std::vector<unsigned char> out(19 * 32);
+    HashX11xN(out.data(), in.data(), 176, 19);
+    for (size_t i = 0; i < 19; ++i) {
+        uint256 hash = HashX11(in.begin() + i * 176, in.begin() + (i + 1) * 176);
+        BOOST_CHECK(std::equal(hash.begin(), hash.end(), out.begin() + i * 32));
+    }
+
+    std::vector<CBlockHeader> headers(11);
+    for (CBlockHeader& header : headers) {
+        header.nVersion = InsecureRand32();
+        header.hashPrevBlock = InsecureRand256();
+        header.hashMerkleRoot = InsecureRand256();
+        header.nTime = InsecureRand32();
+        header.nBits = InsecureRand32();
+        header.nNonce = InsecureRand32();
+    }
+    // the hashes computed one by one, before the batch put them into the cache
+    std::vector<uint256> expected;
+    for (const CBlockHeader& header : headers) {
+        expected.push_back(header.GetHash());
+    }
+    std::vector<uint256> hashes = GetBlockHeaderHashes(headers);
+    BOOST_CHECK(hashes == expected);
+}
+
+BOOST_AUTO_TEST_CASE(block_header_hash_cache)
+{
+    CBlockHeader header;
+    header.nVersion = InsecureRand32();
+    header.hashPrevBlock = InsecureRand256();
+    header.hashMerkleRoot = InsecureRand256();
+    header.nTime = InsecureRand32();
+    header.nBits = InsecureRand32();
+    header.nNonce = InsecureRand32();
+
+    uint64_t nCount = GetBlockHeaderHashCount();
+    const uint256 hash = header.GetHash();
+    BOOST_CHECK_EQUAL(GetBlockHeaderHashCount(), nCount + 1);
+    BOOST_CHECK(header.GetHash() == hash);
+    BOOST_CHECK_EQUAL(GetBlockHeaderHashCount(), nCount + 1);
+
+    // the cache is looked up by the header contents, so copies find the hash as well
+    CBlock block(header);
+    BOOST_CHECK(block.GetHash() == hash);
+    BOOST_CHECK(block.GetBlockHeader().GetHash() == hash);
+    BOOST_CHECK_EQUAL(GetBlockHeaderHashCount(), nCount + 1);
+
+    // any change to the header needs a new hash, the previous one is still found when the change is reverted
+    header.nNonce++;
+    const uint256 hash2 = header.GetHash();
+    BOOST_CHECK(hash2 != hash);
+    BOOST_CHECK_EQUAL(GetBlockHeaderHashCount(), nCount + 2);
+    header.nNonce--;
+    BOOST_CHECK(header.GetHash() == hash);
+    BOOST_CHECK_EQUAL(GetBlockHeaderHashCount(), nCount + 2);
+
+    block.nSignature = uint520S("01");
+    BOOST_CHECK(block.GetHash() != hash);
+    block.SetNull();
+    BOOST_CHECK(block.GetHash() == CBlockHeader().GetHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,206 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/test_zenx.h>
+
+#include <bls/bls_worker.h>
+#include <dbwrapper.h>
+#include <llmq/quorums_instantsend.h>
+#include <net.h>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace llmq;
+
+static CInstantSendLock MakeLock(size_t inputCount)
+{
+    CInstantSendLock islock;
+    islock.txid = InsecureRand256();
+    for (size_t i = 0; i < inputCount; i++) {
+        islock.inputs.emplace_back(InsecureRand256(), InsecureRand32());
+    }
+    return islock;
+}
+
+BOOST_FIXTURE_TEST_SUITE(llmq_instantsend_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(islock_index)
+{
+    CDBWrapper dbw(fs::path(), 1 << 20, true);
+    CInstantSendDb db(dbw);
+    db.LoadIndex();
+    BOOST_CHECK(db.GetIndex()->fComplete);
+
+    std::vector<std::pair<uint256, CInstantSendLock>> islocks;
+    for (size_t i = 0; i < 10; i++) {
+        auto islock = MakeLock(1 + i % 3);
+        auto hash = ::SerializeHash(islock);
+        db.WriteNewInstantSendLock(hash, islock);
+        islocks.emplace_back(hash, islock);
+    }
+
+    // a snapshot taken now must not be affected by later modifications
+    auto oldIndex = db.GetIndex();
+
+    CDBBatch batch(dbw);
+    db.RemoveInstantSendLock(batch, islocks[0].first, nullptr);
+    // the index must not run ahead of the DB
+    BOOST_CHECK(db.GetIndex()->GetByHash(islocks[0].first) != nullptr);
+    db.WriteBatch(batch);
+
+    auto index = db.GetIndex();
+    BOOST_CHECK(index->fComplete);
+    BOOST_CHECK(oldIndex->GetByHash(islocks[0].first) != nullptr);
+    BOOST_CHECK(index->GetByHash(islocks[0].first) == nullptr);
+    BOOST_CHECK(index->GetByTxid(islocks[0].second.txid) == nullptr);
+    BOOST_CHECK(index->GetByInput(islocks[0].second.inputs[0]) == nullptr);
+    for (size_t i = 1; i < islocks.size(); i++) {
+        auto& p = islocks[i];
+        BOOST_CHECK(index->GetByHash(p.first) != nullptr);
+        BOOST_CHECK(index->GetByTxid(p.second.txid)->txid == p.second.txid);
+        for (auto& in : p.second.inputs) {
+            BOOST_CHECK(index->GetByInput(in)->txid == p.second.txid);
+        }
+    }
+    BOOST_CHECK(index->GetByTxid(InsecureRand256()) == nullptr);
+
+    // a fresh index loaded from the DB must match
+    CInstantSendDb db2(dbw);
+    db2.LoadIndex();
+    auto index2 = db2.GetIndex();
+    BOOST_CHECK(index2->fComplete);
+    BOOST_CHECK_EQUAL(index2->byHash.size(), islocks.size() - 1);
+    BOOST_CHECK_EQUAL(index2->byTxid.size(), islocks.size() - 1);
+    BOOST_CHECK_EQUAL(index2->byOutpoint.size(), index->byOutpoint.size());
+    BOOST_CHECK(index2->GetByHash(islocks[0].first) == nullptr);
+    BOOST_CHECK(index2->GetByTxid(islocks[5].second.txid) != nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(islock_index_bound)
+{
+    const size_t maxIndexed = 5;
+    CDBWrapper dbw(fs::path(), 1 << 20, true);
+    CInstantSendDb db(dbw, maxIndexed);
+    db.LoadIndex();
+
+    std::vector<std::pair<uint256, CInstantSendLock>> islocks;
+    for (size_t i = 0; i < maxIndexed + 3; i++) {
+        auto islock = MakeLock(1);
+        auto hash = ::SerializeHash(islock);
+        db.WriteNewInstantSendLock(hash, islock);
+        islocks.emplace_back(hash, islock);
+    }
+
+    // islocks beyond the bound are not indexed and the index stops claiming to be complete
+    auto index = db.GetIndex();
+    BOOST_CHECK(!index->fComplete);
+    BOOST_CHECK_EQUAL(index->byHash.size(), maxIndexed);
+    BOOST_CHECK_EQUAL(index->byTxid.size(), maxIndexed);
+    BOOST_CHECK_EQUAL(index->byOutpoint.size(), maxIndexed);
+    for (size_t i = 0; i < islocks.size(); i++) {
+        auto& p = islocks[i];
+        BOOST_CHECK_EQUAL(index->GetByHash(p.first) != nullptr, i < maxIndexed);
+        // misses are served from the DB
+        BOOST_CHECK(db.GetInstantSendLockByHash(p.first) != nullptr);
+        BOOST_CHECK(db.GetInstantSendLockByTxid(p.second.txid) != nullptr);
+        BOOST_CHECK(db.GetInstantSendLockByInput(p.second.inputs[0]) != nullptr);
+    }
+
+    // removing an indexed islock frees a slot which is taken by the next new islock, the index stays bounded
+    CDBBatch batch(dbw);
+    db.RemoveInstantSendLock(batch, islocks[0].first, nullptr);
+    db.WriteBatch(batch);
+    BOOST_CHECK_EQUAL(db.GetIndex()->byHash.size(), maxIndexed - 1);
+    auto islock = MakeLock(1);
+    db.WriteNewInstantSendLock(::SerializeHash(islock), islock);
+    auto islock2 = MakeLock(1);
+    db.WriteNewInstantSendLock(::SerializeHash(islock2), islock2);
+    index = db.GetIndex();
+    BOOST_CHECK(!index->fComplete);
+    BOOST_CHECK_EQUAL(index->byHash.size(), maxIndexed);
+    BOOST_CHECK(index->GetByHash(islocks[0].first) == nullptr);
+    BOOST_CHECK(index->GetByTxid(islock.txid) != nullptr);
+    BOOST_CHECK(index->GetByTxid(islock2.txid) == nullptr);
+    BOOST_CHECK(db.GetInstantSendLockByTxid(islock2.txid) != nullptr);
+
+    // a fresh index loaded from the DB is bounded as well
+    CInstantSendDb db2(dbw, maxIndexed);
+    db2.LoadIndex();
+    BOOST_CHECK(!db2.GetIndex()->fComplete);
+    BOOST_CHECK_EQUAL(db2.GetIndex()->byHash.size(), maxIndexed);
+
+    // and complete again once everything fits
+    CInstantSendDb db3(dbw, islocks.size() + 1);
+    db3.LoadIndex();
+    BOOST_CHECK(db3.GetIndex()->fComplete);
+    BOOST_CHECK_EQUAL(db3.GetIndex()->byHash.size(), islocks.size() + 1);
+
+    // the bounded index recovers as soon as all remaining islocks fit into it again
+    CDBBatch batch2(dbw);
+    for (size_t i = 1; i < maxIndexed; i++) {
+        db.RemoveInstantSendLock(batch2, islocks[i].first, nullptr);
+    }
+    db.WriteBatch(batch2);
+    index = db.GetIndex();
+    BOOST_CHECK(index->fComplete);
+    BOOST_CHECK_EQUAL(index->byHash.size(), maxIndexed);
+    BOOST_CHECK(index->GetByTxid(islock2.txid) != nullptr);
+    for (size_t i = maxIndexed; i < islocks.size(); i++) {
+        BOOST_CHECK(index->GetByHash(islocks[i].first) != nullptr);
+    }
+
+    // and becomes incomplete again when exceeding it
+    auto islock3 = MakeLock(1);
+    db.WriteNewInstantSendLock(::SerializeHash(islock3), islock3);
+    BOOST_CHECK(!db.GetIndex()->fComplete);
+    // removing the unindexed islock makes it complete without touching the indexed ones
+    CDBBatch batch3(dbw);
+    db.RemoveInstantSendLock(batch3, ::SerializeHash(islock3), nullptr);
+    db.WriteBatch(batch3);
+    BOOST_CHECK(db.GetIndex()->fComplete);
+    BOOST_CHECK_EQUAL(db.GetIndex()->byHash.size(), maxIndexed);
+}
+
+BOOST_AUTO_TEST_CASE(islock_pending_cap)
+{
+    CDBWrapper dbw(fs::path(), 1 << 20, true);
+    CBLSWorker blsWorker;
+    CInstantSendManager isman(dbw, blsWorker);
+    CConnman connman(0x1337, 0x1337);
+    CAddress addr(CService(CNetAddr(), 7777), NODE_NETWORK);
+    CNode node(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", true);
+
+    const size_t maxPending = CInstantSendManager::MAX_PENDING_INSTANTSEND_LOCKS;
+    for (size_t i = 0; i < maxPending - 1; i++) {
+        isman.ProcessMessageInstantSendLock(&node, MakeLock(1), connman);
+    }
+    BOOST_CHECK_EQUAL(isman.GetPendingInstantSendLockCount(), maxPending - 1);
+    BOOST_CHECK(!isman.IsPendingQueueFull());
+
+    auto lastLock = MakeLock(1);
+    isman.ProcessMessageInstantSendLock(&node, lastLock, connman);
+    BOOST_CHECK_EQUAL(isman.GetPendingInstantSendLockCount(), maxPending);
+    BOOST_CHECK(isman.IsPendingQueueFull());
+    BOOST_CHECK_EQUAL(isman.GetDroppedInstantSendLockCount(), 0);
+
+    // islocks arriving while the queue is full are dropped and counted
+    for (size_t i = 0; i < 10; i++) {
+        isman.ProcessMessageInstantSendLock(&node, MakeLock(1), connman);
+    }
+    BOOST_CHECK_EQUAL(isman.GetPendingInstantSendLockCount(), maxPending);
+    BOOST_CHECK_EQUAL(isman.GetDroppedInstantSendLockCount(), 10);
+
+    // a duplicate of a queued islock is not a drop
+    isman.ProcessMessageInstantSendLock(&node, lastLock, connman);
+    BOOST_CHECK_EQUAL(isman.GetDroppedInstantSendLockCount(), 10);
+
+    // neither is an invalid one, it's rejected before it could be queued
+    CInstantSendLock invalidLock = MakeLock(1);
+    invalidLock.inputs.clear();
+    isman.ProcessMessageInstantSendLock(&node, invalidLock, connman);
+    BOOST_CHECK_EQUAL(isman.GetPendingInstantSendLockCount(), maxPending);
+    BOOST_CHECK_EQUAL(isman.GetDroppedInstantSendLockCount(), 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
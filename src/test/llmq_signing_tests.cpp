@@ -0,0 +1,278 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/test_zenx.h>
+
+#include <bls/bls_worker.h>
+#include <chainparams.h>
+#include <evo/deterministicmns.h>
+#include <evo/evodb.h>
+#include <llmq/quorums.h>
+#include <llmq/quorums_dkgsessionmgr.h>
+#include <llmq/quorums_init.h>
+#include <llmq/quorums_signing.h>
+#include <llmq/quorums_signing_shares.h>
+#include <llmq/quorums_utils.h>
+#include <masternode/activemasternode.h>
+#include <net.h>
+#include <protocol.h>
+#include <utiltime.h>
+#include <validation.h>
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+#include <boost/test/unit_test.hpp>
+
+namespace llmq
+{
+extern CBLSWorker* blsWorker;
+} // namespace llmq
+
+using namespace llmq;
+
+namespace {
+
+/** Serves quorums that were never mined, so that the signing managers can run without a chain */
+class CMockQuorumManager : public CQuorumManager
+{
+public:
+    std::vector<CQuorumCPtr> quorums;
+
+    CMockQuorumManager() : CQuorumManager(*::evoDb, *llmq::blsWorker, *llmq::quorumDKGSessionManager) {}
+
+    CQuorumCPtr GetQuorum(Consensus::LLMQType llmqType, const uint256& quorumHash) override
+    {
+        for (auto& quorum : quorums) {
+            if (quorum->params.type == llmqType && quorum->qc.quorumHash == quorumHash) {
+                return quorum;
+            }
+        }
+        return nullptr;
+    }
+
+    std::vector<CQuorumCPtr> ScanQuorums(Consensus::LLMQType llmqType, size_t maxCount) override
+    {
+        std::vector<CQuorumCPtr> result;
+        for (auto& quorum : quorums) {
+            if (quorum->params.type == llmqType && result.size() < maxCount) {
+                result.emplace_back(quorum);
+            }
+        }
+        return result;
+    }
+};
+
+/** Records when each recovered sig reaches the listeners of CSigningManager */
+class CRecoveryTimes : public CRecoveredSigsListener
+{
+public:
+    CCriticalSection cs;
+    std::map<uint256, int64_t> times;
+
+    void HandleNewRecoveredSig(const CRecoveredSig& recoveredSig) override
+    {
+        LOCK(cs);
+        times.emplace(recoveredSig.id, GetTimeMicros());
+    }
+
+    size_t Count()
+    {
+        LOCK(cs);
+        return times.size();
+    }
+};
+
+int64_t GetPeakRSSKilobytes()
+{
+#ifndef WIN32
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return usage.ru_maxrss;
+    }
+#endif
+    return 0;
+}
+
+CQuorumCPtr MakeQuorum(const Consensus::LLMQParams& params, BLSSecretKeyVector& skSharesRet)
+{
+    std::vector<CDeterministicMNCPtr> members;
+    BLSIdVector ids;
+    for (int i = 0; i < params.size; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>(i);
+        dmn->proTxHash = InsecureRand256();
+        ids.emplace_back(CBLSId::FromHash(dmn->proTxHash));
+        members.emplace_back(dmn);
+    }
+
+    BLSVerificationVectorPtr vvec;
+    BOOST_REQUIRE(blsWorker->GenerateContributions(params.threshold, ids, vvec, skSharesRet));
+
+    CFinalCommitment qc(params, InsecureRand256());
+    qc.signers.assign(params.size, true);
+    qc.validMembers.assign(params.size, true);
+    qc.quorumPublicKey = (*vvec)[0];
+    qc.quorumVvecHash = ::SerializeHash(*vvec);
+
+    auto quorum = std::make_shared<CQuorum>(params, *blsWorker);
+    LOCK(cs_main);
+    quorum->Init(qc, chainActive.Tip(), InsecureRand256(), members);
+    quorum->quorumVvec = vvec;
+    return quorum;
+}
+
+int64_t Percentile(const std::vector<int64_t>& sorted, size_t percent)
+{
+    return sorted[std::min(sorted.size() - 1, sorted.size() * percent / 100)];
+}
+
+/**
+ * Network-free harness for the receiving side of LLMQ signing. We are member 0 of a mock quorum, the other members'
+ * shares for a burst of sign requests arrive from nPeers fake peers as QSIGSESANN and QBSIGSHARES messages. They pass
+ * through CSigSharesManager::ProcessMessage, the batched verification of the worker thread, TryRecoverSig and finally
+ * CSigningManager, exactly like shares from the network. Reports share throughput, the latency from the first share
+ * of a request to its recovered sig and the growth of the peak RSS; run with --log_level=message to see them.
+ */
+void RunSigningHarness(CConnman& connman, Consensus::LLMQType llmqType, size_t nRequests, size_t nPeers)
+{
+    const auto& params = Params().GetConsensus().llmqs.at(llmqType);
+    const int64_t nPeakRSSBefore = GetPeakRSSKilobytes();
+
+    blsWorker->Start();
+
+    CMockQuorumManager mockQuorumManager;
+    BLSSecretKeyVector skShares;
+    auto quorum = MakeQuorum(params, skShares);
+    mockQuorumManager.quorums.emplace_back(quorum);
+
+    // sign everything upfront, so that only the receiving side is measured
+    std::vector<std::pair<uint256, uint256>> requests;
+    std::vector<std::vector<CBatchedSigShares>> batches(nRequests, std::vector<CBatchedSigShares>(nPeers));
+    for (size_t r = 0; r < nRequests; r++) {
+        requests.emplace_back(InsecureRand256(), InsecureRand256());
+        auto signHash = CLLMQUtils::BuildSignHash(llmqType, quorum->qc.quorumHash, requests[r].first, requests[r].second);
+        for (size_t p = 0; p < nPeers; p++) {
+            batches[r][p].sessionId = (uint32_t)r;
+        }
+        for (int m = 1; m < params.size; m++) {
+            CBLSLazySignature sigShare;
+            sigShare.Set(skShares[m].Sign(signHash));
+            batches[r][m % nPeers].sigShares.emplace_back((uint16_t)m, sigShare);
+        }
+    }
+
+    std::vector<std::unique_ptr<CNode>> nodes;
+    for (size_t p = 0; p < nPeers; p++) {
+        CAddress addr(CService(CNetAddr(), (unsigned short)(10000 + p)), NODE_NONE);
+        nodes.emplace_back(new CNode(1000 + p, NODE_NETWORK, 0, INVALID_SOCKET, addr, p, p, CAddress(), "", true));
+        nodes.back()->nVersion = PROTOCOL_VERSION;
+        nodes.back()->SetSendVersion(PROTOCOL_VERSION);
+        nodes.back()->fSuccessfullyConnected = true;
+        CConnmanTest::AddNode(*nodes.back());
+    }
+
+    CQuorumManager* prevQuorumManager = quorumManager;
+    bool prevMasternodeMode = fMasternodeMode;
+    uint256 prevProTxHash = activeMasternodeInfo.proTxHash;
+    quorumManager = &mockQuorumManager;
+    fMasternodeMode = true;
+    activeMasternodeInfo.proTxHash = quorum->members[0]->proTxHash;
+
+    CRecoveryTimes recoveryTimes;
+    quorumSigningManager->RegisterRecoveredSigsListener(&recoveryTimes);
+    quorumSigSharesManager->RegisterAsRecoveredSigsListener();
+    quorumSigSharesManager->StartWorkerThread();
+
+    // every peer announces all sessions, then the shares arrive request by request
+    for (auto& node : nodes) {
+        for (size_t r = 0; r < nRequests; r += 100) {
+            std::vector<CSigSesAnn> anns;
+            for (size_t i = r; i < std::min(r + 100, nRequests); i++) {
+                CSigSesAnn ann;
+                ann.sessionId = (uint32_t)i;
+                ann.llmqType = llmqType;
+                ann.quorumHash = quorum->qc.quorumHash;
+                ann.id = requests[i].first;
+                ann.msgHash = requests[i].second;
+                anns.emplace_back(ann);
+            }
+            CDataStream vRecv(SER_NETWORK, PROTOCOL_VERSION);
+            vRecv << anns;
+            quorumSigSharesManager->ProcessMessage(node.get(), NetMsgType::QSIGSESANN, vRecv, connman);
+        }
+    }
+
+    std::vector<int64_t> firstShareTimes(nRequests);
+    const int64_t nStart = GetTimeMicros();
+    for (size_t r = 0; r < nRequests; r++) {
+        firstShareTimes[r] = GetTimeMicros();
+        for (size_t p = 0; p < nPeers; p++) {
+            CDataStream vRecv(SER_NETWORK, PROTOCOL_VERSION);
+            vRecv << std::vector<CBatchedSigShares>{batches[r][p]};
+            quorumSigSharesManager->ProcessMessage(nodes[p].get(), NetMsgType::QBSIGSHARES, vRecv, connman);
+        }
+    }
+
+    const int64_t nDeadline = GetTimeMillis() + 120 * 1000;
+    while (recoveryTimes.Count() < nRequests && GetTimeMillis() < nDeadline) {
+        MilliSleep(1);
+    }
+    const int64_t nElapsed = GetTimeMicros() - nStart;
+    const int64_t nPeakRSSAfter = GetPeakRSSKilobytes();
+
+    quorumSigSharesManager->InterruptWorkerThread();
+    quorumSigSharesManager->StopWorkerThread();
+    quorumSigSharesManager->UnregisterAsRecoveredSigsListener();
+    quorumSigningManager->UnregisterRecoveredSigsListener(&recoveryTimes);
+
+    int64_t nVerified = 0;
+    for (auto& node : nodes) {
+        int64_t nNodeVerified, nNodeInvalid, nNodeVerifyTime;
+        BOOST_REQUIRE(quorumSigSharesManager->GetNodeVerifyStats(node->GetId(), nNodeVerified, nNodeInvalid, nNodeVerifyTime));
+        BOOST_CHECK_EQUAL(nNodeInvalid, 0);
+        nVerified += nNodeVerified;
+    }
+
+    quorumManager = prevQuorumManager;
+    fMasternodeMode = prevMasternodeMode;
+    activeMasternodeInfo.proTxHash = prevProTxHash;
+    CConnmanTest::ClearNodes();
+
+    // every request was recovered from valid shares and the recovered sigs are valid for the quorum
+    BOOST_REQUIRE_EQUAL(recoveryTimes.Count(), nRequests);
+    BOOST_CHECK(nVerified >= (int64_t)(nRequests * params.threshold));
+    std::vector<int64_t> latencies;
+    for (size_t r = 0; r < nRequests; r++) {
+        CRecoveredSig recoveredSig;
+        BOOST_REQUIRE(quorumSigningManager->GetRecoveredSigForId(llmqType, requests[r].first, recoveredSig));
+        BOOST_CHECK(recoveredSig.msgHash == requests[r].second);
+        BOOST_CHECK(recoveredSig.sig.Get().VerifyInsecure(quorum->qc.quorumPublicKey, CLLMQUtils::BuildSignHash(recoveredSig)));
+        latencies.emplace_back(recoveryTimes.times.at(requests[r].first) - firstShareTimes[r]);
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    BOOST_TEST_MESSAGE(strprintf("%s: %d requests, %d of %d shares verified from %d peers in %d ms, %d shares/s",
+        params.name, nRequests, nVerified, nRequests * (params.size - 1), nPeers, nElapsed / 1000,
+        nElapsed ? nVerified * 1000000 / nElapsed : 0));
+    BOOST_TEST_MESSAGE(strprintf("%s: recovery latency p50=%d us, p90=%d us, p99=%d us, max=%d us, peak RSS growth=%d kB",
+        params.name, Percentile(latencies, 50), Percentile(latencies, 90), Percentile(latencies, 99), latencies.back(),
+        nPeakRSSAfter - nPeakRSSBefore));
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(llmq_signing_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(sigshares_recovery_small_quorum)
+{
+    RunSigningHarness(*connman, Consensus::LLMQ_50_60, 100, 8);
+}
+
+BOOST_AUTO_TEST_CASE(sigshares_recovery_large_quorum)
+{
+    RunSigningHarness(*connman, Consensus::LLMQ_400_60, 8, 8);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <script/standard.h>
 #include <txmempool.h>
 #include <util.h>
 
@@ -570,4 +571,60 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolAddressSpentIndexTest)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+    CCoinsView viewDummy;
+    CCoinsViewCache view(&viewDummy);
+
+    CKeyID keyId1(uint160(std::vector<unsigned char>(20, 1)));
+    CKeyID keyId2(uint160(std::vector<unsigned char>(20, 2)));
+    COutPoint prevout(InsecureRand256(), 0);
+    view.AddCoin(prevout, Coin(CTxOut(10 * COIN, GetScriptForDestination(keyId1)), 1, false), false);
+
+    CMutableTransaction tx1;
+    tx1.vin.emplace_back(prevout);
+    tx1.vout.emplace_back(9 * COIN, GetScriptForDestination(keyId2));
+    tx1.vout.emplace_back(1 * COIN, GetScriptForDestination(keyId1));
+    CTxMemPoolEntry entry1 = entry.FromTx(tx1);
+    pool.addUnchecked(tx1.GetHash(), entry1);
+    pool.addAddressIndex(entry1, view);
+    pool.addSpentIndex(entry1, view);
+
+    // a conflicting spend must not take over (or later remove) the spent index entry of tx1
+    CMutableTransaction tx2;
+    tx2.vin.emplace_back(prevout);
+    tx2.vout.emplace_back(10 * COIN, GetScriptForDestination(keyId2));
+    CTxMemPoolEntry entry2 = entry.FromTx(tx2);
+    pool.addUnchecked(tx2.GetHash(), entry2);
+    pool.addSpentIndex(entry2, view);
+
+    std::vector<std::pair<uint160, int>> addresses{{keyId1, 1}};
+    std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>> deltas;
+    pool.getAddressIndex(addresses, deltas);
+    BOOST_CHECK_EQUAL(deltas.size(), 2U);
+    BOOST_CHECK_EQUAL(deltas[0].first.index, 0U);
+    BOOST_CHECK_EQUAL(deltas[0].first.spending, 1);
+    BOOST_CHECK_EQUAL(deltas[0].second.amount, -10 * COIN);
+    BOOST_CHECK_EQUAL(deltas[1].first.index, 1U);
+    BOOST_CHECK_EQUAL(deltas[1].first.spending, 0);
+    BOOST_CHECK_EQUAL(deltas[1].second.amount, 1 * COIN);
+
+    CSpentIndexKey spentKey(prevout.hash, prevout.n);
+    CSpentIndexValue spentValue;
+    pool.removeRecursive(tx2);
+    BOOST_CHECK(pool.getSpentIndex(spentKey, spentValue));
+    BOOST_CHECK(spentValue.txid == tx1.GetHash());
+    BOOST_CHECK_EQUAL(spentValue.satoshis, 10 * COIN);
+
+    // removal cleans up all indexes
+    pool.removeRecursive(tx1);
+    BOOST_CHECK(!pool.getSpentIndex(spentKey, spentValue));
+    deltas.clear();
+    addresses.emplace_back(keyId2, 1);
+    pool.getAddressIndex(addresses, deltas);
+    BOOST_CHECK(deltas.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -9,8 +9,11 @@
 #include <serialize.h>
 #include <streams.h>
 #include <net.h>
+#include <net_processing.h>
 #include <netbase.h>
+#include <netmessagemaker.h>
 #include <chainparams.h>
+#include <txmempool.h>
 #include <util.h>
 
 #include <memory>
@@ -73,6 +76,173 @@ CDataStream AddrmanToStream(CAddrManSerializationMock& _addrman)
     return CDataStream(vchData, SER_DISK, CLIENT_VERSION);
 }
 
+#ifdef USE_EPOLL
+// Answers every PING with a PONG carrying nPongSize bytes, but only while fProcess is set. Leaving it unset lets the
+// process queue of a peer grow until the socket reactor pauses receiving from it.
+class ReactorTestMsgProc : public NetEventsInterface
+{
+public:
+    CConnman* connman{nullptr};
+    std::atomic<bool> fProcess{true};
+    std::atomic<size_t> nPongSize{8};
+    std::atomic<int> nPings{0};
+    std::atomic<int> nFinalized{0};
+    CCriticalSection cs;
+    std::vector<CNode*> vNodes;
+
+    bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) override
+    {
+        if (!fProcess) {
+            return false;
+        }
+        std::list<CNetMessage> msgs;
+        {
+            LOCK(pnode->cs_vProcessMsg);
+            msgs.swap(pnode->vProcessMsg);
+            pnode->nProcessQueueSize = 0;
+            pnode->fPauseRecv = false;
+        }
+        const CNetMsgMaker msgMaker(INIT_PROTO_VERSION);
+        for (auto& msg : msgs) {
+            if (msg.hdr.GetCommand() == NetMsgType::PING) {
+                nPings++;
+                connman->PushMessage(pnode, msgMaker.Make(NetMsgType::PONG, std::vector<unsigned char>(nPongSize)));
+            }
+        }
+        return false;
+    }
+    bool SendMessages(CNode* pnode, std::atomic<bool>& interrupt) override { return true; }
+    bool IsConcurrentMessage(const std::string& strCommand) const override { return false; }
+    bool ProcessConcurrentMessage(CNode* pnode, std::atomic<bool>& interrupt) override { return false; }
+    void InitializeNode(CNode* pnode) override
+    {
+        LOCK(cs);
+        vNodes.emplace_back(pnode);
+    }
+    void FinalizeNode(NodeId id, bool& update_connection_time) override { nFinalized++; }
+
+    size_t GetPongBytes() const
+    {
+        return CMessageHeader::HEADER_SIZE + ::GetSerializeSize(std::vector<unsigned char>(nPongSize), SER_NETWORK, INIT_PROTO_VERSION);
+    }
+};
+
+// Runs a CConnman with two epoll socket reactors on a loopback port and connects plain sockets to it
+struct ReactorTestingSetup : public TestingSetup {
+    ReactorTestMsgProc msgProc;
+    CConnman reactorConnman{0x1337, 0x1337};
+    CScheduler reactorScheduler;
+    struct sockaddr_in sockaddr{};
+    std::vector<SOCKET> vClients;
+
+    ReactorTestingSetup()
+    {
+        gArgs.ForceSetArg("-dnsseed", "0");
+        msgProc.connman = &reactorConnman;
+
+        // let the OS pick a free port
+        SOCKET hProbe = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr.sin_family = AF_INET;
+        sockaddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(sockaddr);
+        BOOST_REQUIRE(bind(hProbe, (struct sockaddr*)&sockaddr, len) == 0);
+        BOOST_REQUIRE(getsockname(hProbe, (struct sockaddr*)&sockaddr, &len) == 0);
+        CloseSocket(hProbe);
+    }
+
+    ~ReactorTestingSetup()
+    {
+        for (SOCKET& hSocket : vClients) {
+            CloseSocket(hSocket);
+        }
+        reactorConnman.Interrupt();
+        reactorConnman.Stop();
+        gArgs.ForceSetArg("-dnsseed", "");
+    }
+
+    void StartConnman(unsigned int nReceiveFloodSize)
+    {
+        CConnman::Options options;
+        options.nMaxConnections = 16;
+        options.nMaxAddnode = MAX_ADDNODE_CONNECTIONS;
+        options.m_msgproc = &msgProc;
+        options.nSendBufferMaxSize = 1000 * DEFAULT_MAXSENDBUFFER;
+        options.nReceiveFloodSize = nReceiveFloodSize;
+        options.vWhiteBinds.emplace_back(CService(CNetAddr(sockaddr.sin_addr), ntohs(sockaddr.sin_port)));
+        options.m_use_addrman_outgoing = false;
+        options.socketEventsMode = CConnman::SOCKETEVENTS_EPOLL;
+        options.nSocketThreads = 2;
+        BOOST_REQUIRE(reactorConnman.Start(reactorScheduler, options));
+    }
+
+    void ConnectClients(size_t nClients)
+    {
+        struct timeval timeout = MillisToTimeval(10 * 1000);
+        for (size_t i = 0; i < nClients; i++) {
+            SOCKET hSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            BOOST_REQUIRE(connect(hSocket, (struct sockaddr*)&sockaddr, sizeof(sockaddr)) == 0);
+            SetSocketNoDelay(hSocket);
+            setsockopt(hSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+            setsockopt(hSocket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+            vClients.emplace_back(hSocket);
+        }
+        BOOST_REQUIRE(WaitFor([&] { return reactorConnman.GetNodeCount(CConnman::CONNECTIONS_IN) == nClients; }));
+        BOOST_REQUIRE(WaitFor([&] { LOCK(msgProc.cs); return msgProc.vNodes.size() == nClients; }));
+    }
+
+    template <typename Callable>
+    static bool WaitFor(Callable&& cond)
+    {
+        for (int i = 0; i < 1000; i++) {
+            if (cond()) {
+                return true;
+            }
+            MilliSleep(10);
+        }
+        return cond();
+    }
+
+    static std::vector<unsigned char> MakePings(size_t nPings)
+    {
+        CSendMsgBufferRef ping = MakeSendMsgBuffer(CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::PING, (uint64_t)0));
+        std::vector<unsigned char> vPing(ping->header.begin(), ping->header.end());
+        vPing.insert(vPing.end(), ping->data.begin(), ping->data.end());
+        std::vector<unsigned char> vPings;
+        for (size_t i = 0; i < nPings; i++) {
+            vPings.insert(vPings.end(), vPing.begin(), vPing.end());
+        }
+        return vPings;
+    }
+
+    static bool SendAll(SOCKET hSocket, const std::vector<unsigned char>& vData)
+    {
+        size_t nSent = 0;
+        while (nSent < vData.size()) {
+            ssize_t nBytes = send(hSocket, vData.data() + nSent, vData.size() - nSent, MSG_NOSIGNAL);
+            if (nBytes <= 0) {
+                return false;
+            }
+            nSent += nBytes;
+        }
+        return true;
+    }
+
+    static size_t RecvAll(SOCKET hSocket, size_t nExpected)
+    {
+        unsigned char buf[4096];
+        size_t nReceived = 0;
+        while (nReceived < nExpected) {
+            ssize_t nBytes = recv(hSocket, buf, std::min(sizeof(buf), nExpected - nReceived), 0);
+            if (nBytes <= 0) {
+                break;
+            }
+            nReceived += nBytes;
+        }
+        return nReceived;
+    }
+};
+#endif // USE_EPOLL
+
 BOOST_FIXTURE_TEST_SUITE(net_tests, BasicTestingSetup)
 
 BOOST_AUTO_TEST_CASE(cnode_listen_port)
@@ -201,4 +371,244 @@ BOOST_AUTO_TEST_CASE(PoissonNextSend)
     g_mock_deterministic_tests = false;
 }
 
+#ifndef WIN32
+BOOST_AUTO_TEST_CASE(send_shared_msg_buffer)
+{
+    CConnman connman(0x1337, 0x1337);
+    CAddress addr(CService(CNetAddr(), 7777), NODE_NETWORK);
+
+    CSerializedNetMsg small;
+    small.command = NetMsgType::PING;
+    small.data.assign(8, 0x42);
+    CSendMsgBufferRef smallMsg = MakeSendMsgBuffer(std::move(small));
+    BOOST_CHECK_EQUAL(smallMsg->command, NetMsgType::PING);
+    BOOST_CHECK_EQUAL(smallMsg->size(), CMessageHeader::HEADER_SIZE + 8);
+
+    // too big for the socket buffer, so it can only be sent partially
+    CSerializedNetMsg big;
+    big.command = NetMsgType::BLOCK;
+    big.data.resize(1024 * 1024);
+    for (size_t i = 0; i < big.data.size(); i++) {
+        big.data[i] = (unsigned char)i;
+    }
+    CSendMsgBufferRef bigMsg = MakeSendMsgBuffer(std::move(big));
+    const CNetMsgMaker msgMaker(INIT_PROTO_VERSION);
+    CSendMsgBufferRef verackMsg = MakeSendMsgBuffer(msgMaker.Make(NetMsgType::VERACK));
+    BOOST_CHECK(verackMsg->data.empty());
+
+    std::vector<unsigned char> expected;
+    std::vector<std::pair<std::unique_ptr<CNode>, SOCKET>> nodes;
+    for (NodeId id = 0; id < 2; id++) {
+        int fds[2];
+        BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+        nodes.emplace_back(std::unique_ptr<CNode>(new CNode(id, NODE_NETWORK, 0, fds[0], addr, 0, 0, CAddress(), "", false)), fds[1]);
+
+        // more messages than fit into a single sendmsg() call, the same buffers queued for both peers
+        CNode& node = *nodes.back().first;
+        expected.clear();
+        for (int i = 0; i < 100; i++) {
+            const CSendMsgBufferRef& msg = i == 50 ? bigMsg : smallMsg;
+            connman.PushMessage(&node, msg);
+            expected.insert(expected.end(), msg->header.begin(), msg->header.end());
+            expected.insert(expected.end(), msg->data.begin(), msg->data.end());
+        }
+        connman.PushMessage(&node, msgMaker.Make(NetMsgType::VERACK));
+        expected.insert(expected.end(), verackMsg->header.begin(), verackMsg->header.end());
+    }
+    BOOST_CHECK_EQUAL(smallMsg.use_count(), 1 + 2 * 99);
+    BOOST_CHECK_EQUAL(bigMsg.use_count(), 1 + 2);
+
+    for (auto& p : nodes) {
+        CNode& node = *p.first;
+        std::vector<unsigned char> received;
+        for (int i = 0; i < 1000 && received.size() < expected.size(); i++) {
+            CConnmanTest::SocketSendData(connman, node);
+            unsigned char buf[64 * 1024];
+            ssize_t n;
+            while ((n = recv(p.second, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+                received.insert(received.end(), buf, buf + n);
+            }
+        }
+        close(p.second);
+
+        BOOST_REQUIRE_EQUAL(received.size(), expected.size());
+        BOOST_CHECK(received == expected);
+        LOCK(node.cs_vSend);
+        BOOST_CHECK(node.vSendMsg.empty());
+        BOOST_CHECK_EQUAL(node.nSendSize, 0U);
+        BOOST_CHECK_EQUAL(node.nSendBytes, expected.size());
+    }
+    BOOST_CHECK_EQUAL(smallMsg.use_count(), 1);
+    BOOST_CHECK_EQUAL(bigMsg.use_count(), 1);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(recv_buffer_pool)
+{
+    const uint64_t nonce = 0x0123456789abcdef;
+    CSendMsgBufferRef msg = MakeSendMsgBuffer(CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::PING, nonce));
+    std::vector<unsigned char> bytes(msg->header.begin(), msg->header.end());
+    bytes.insert(bytes.end(), msg->data.begin(), msg->data.end());
+
+    auto receive = [&]() {
+        CNetMessage netmsg(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+        // one byte at a time, so that both the header and the checksum are put together incrementally
+        for (unsigned char c : bytes) {
+            int handled = netmsg.in_data ? netmsg.readData((const char*)&c, 1) : netmsg.readHeader((const char*)&c, 1);
+            BOOST_REQUIRE_EQUAL(handled, 1);
+        }
+        BOOST_REQUIRE(netmsg.complete());
+        BOOST_CHECK_EQUAL(netmsg.hdr.GetCommand(), NetMsgType::PING);
+        BOOST_CHECK(memcmp(netmsg.GetMessageHash().begin(), netmsg.hdr.pchChecksum, CMessageHeader::CHECKSUM_SIZE) == 0);
+        uint64_t nonceRecv;
+        netmsg.vRecv >> nonceRecv;
+        BOOST_CHECK_EQUAL(nonceRecv, nonce);
+        return netmsg.fAllocated;
+    };
+
+    receive();
+    std::map<std::string, CRecvBufferStats> mapStats;
+    size_t nBuffers, nBytes;
+    g_recv_buffer_pool.GetStats(mapStats, nBuffers, nBytes);
+    BOOST_CHECK(nBuffers >= 1);
+    BOOST_CHECK(nBytes >= msg->data.size());
+
+    // the buffer of the first message is reused
+    BOOST_CHECK(!receive());
+    size_t nBuffers2;
+    g_recv_buffer_pool.GetStats(mapStats, nBuffers2, nBytes);
+    BOOST_CHECK_EQUAL(nBuffers2, nBuffers);
+}
+
+BOOST_AUTO_TEST_CASE(tx_relay_order)
+{
+    CTxMemPool pool;
+    TestMemPoolEntryHelper entry;
+    std::vector<CTransactionRef> txs;
+    for (CAmount nFee : {1000, 3000, 2000}) {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(COutPoint(InsecureRand256(), 0));
+        tx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+        txs.emplace_back(MakeTransactionRef(tx));
+        pool.addUnchecked(txs.back()->GetHash(), entry.Fee(nFee).FromTx(tx));
+    }
+    // a child pays the highest fee, but is announced after its parent
+    CMutableTransaction child;
+    child.vin.emplace_back(COutPoint(txs[1]->GetHash(), 0));
+    child.vout.emplace_back(COIN, CScript() << OP_TRUE);
+    txs.emplace_back(MakeTransactionRef(child));
+    pool.addUnchecked(txs.back()->GetHash(), entry.Fee(10000).FromTx(child));
+
+    CTxRelayOrder txRelayOrder;
+    std::vector<uint256> vQueue{txs[0]->GetHash(), txs[3]->GetHash(), txs[1]->GetHash(), txs[2]->GetHash(), txs[1]->GetHash(), InsecureRand256()};
+    std::vector<uint256> vAnnounced;
+    auto announce = [&](const CTransactionRef& tx) {
+        vAnnounced.push_back(tx->GetHash());
+        return true;
+    };
+
+    LOCK(pool.cs);
+    txRelayOrder.Select(pool, vQueue, 3, std::chrono::microseconds{1}, announce);
+    BOOST_CHECK(vAnnounced == std::vector<uint256>({txs[1]->GetHash(), txs[2]->GetHash(), txs[0]->GetHash()}));
+    BOOST_CHECK(vQueue == std::vector<uint256>({txs[3]->GetHash()}));
+
+    // the cached order still knows the child, but it isn't announced anymore once it left the mempool
+    pool.removeRecursive(*txs[3]);
+    vAnnounced.clear();
+    txRelayOrder.Select(pool, vQueue, 3, std::chrono::microseconds{1}, announce);
+    BOOST_CHECK(vAnnounced.empty());
+    BOOST_CHECK(vQueue.empty());
+}
+
+#ifdef USE_EPOLL
+BOOST_FIXTURE_TEST_CASE(socket_reactor_send_recv, ReactorTestingSetup)
+{
+    StartConnman(DEFAULT_MAXRECEIVEBUFFER * 1000);
+    ConnectClients(4);
+    {
+        LOCK(msgProc.cs);
+        for (CNode* pnode : msgProc.vNodes) {
+            BOOST_CHECK(pnode->nSocketReactor >= 0 && pnode->nSocketReactor < 2);
+        }
+    }
+
+    const std::vector<unsigned char> vPing = MakePings(1);
+    for (int nRound = 0; nRound < 3; nRound++) {
+        for (SOCKET hSocket : vClients) {
+            BOOST_REQUIRE(SendAll(hSocket, vPing));
+        }
+        for (SOCKET hSocket : vClients) {
+            BOOST_CHECK_EQUAL(RecvAll(hSocket, msgProc.GetPongBytes()), msgProc.GetPongBytes());
+        }
+    }
+    BOOST_CHECK_EQUAL(msgProc.nPings, 3 * 4);
+}
+
+BOOST_FIXTURE_TEST_CASE(socket_reactor_flood_pause, ReactorTestingSetup)
+{
+    // each read from the socket (64 KiB) overflows the flood limit
+    StartConnman(1000);
+    msgProc.fProcess = false;
+    ConnectClients(1);
+    CNode* pnode;
+    {
+        LOCK(msgProc.cs);
+        pnode = msgProc.vNodes.front();
+    }
+
+    const size_t nPings = 4000;
+    const std::vector<unsigned char> vPings = MakePings(nPings);
+    BOOST_REQUIRE(SendAll(vClients[0], vPings));
+
+    // the reactor stops reading as long as the message handler does not catch up
+    BOOST_REQUIRE(WaitFor([&] { return pnode->fPauseRecv.load(); }));
+    MilliSleep(100);
+    BOOST_CHECK(pnode->fPauseRecv);
+    {
+        LOCK(pnode->cs_vRecv);
+        BOOST_CHECK(pnode->nRecvBytes > 1000);
+        BOOST_CHECK(pnode->nRecvBytes < vPings.size());
+    }
+
+    // and resumes on its own once the process queue was drained
+    msgProc.fProcess = true;
+    reactorConnman.WakeMessageHandler();
+    BOOST_CHECK_EQUAL(RecvAll(vClients[0], nPings * msgProc.GetPongBytes()), nPings * msgProc.GetPongBytes());
+    BOOST_CHECK_EQUAL(msgProc.nPings, (int)nPings);
+    LOCK(pnode->cs_vRecv);
+    BOOST_CHECK_EQUAL(pnode->nRecvBytes, vPings.size());
+}
+
+BOOST_FIXTURE_TEST_CASE(socket_reactor_disconnect_pending, ReactorTestingSetup)
+{
+    StartConnman(DEFAULT_MAXRECEIVEBUFFER * 1000);
+    // much more than the socket buffers can hold, and the clients never read it
+    msgProc.nPongSize = 16 * 1024 * 1024;
+    ConnectClients(2);
+
+    const std::vector<unsigned char> vPing = MakePings(1);
+    for (SOCKET hSocket : vClients) {
+        BOOST_REQUIRE(SendAll(hSocket, vPing));
+    }
+    BOOST_REQUIRE(WaitFor([&] { return msgProc.nPings == 2; }));
+    std::vector<CNode*> vNodes;
+    {
+        LOCK(msgProc.cs);
+        vNodes = msgProc.vNodes;
+    }
+    BOOST_REQUIRE(WaitFor([&] { return vNodes[0]->nSendMsgSize != 0 && vNodes[1]->nSendMsgSize != 0; }));
+    MilliSleep(100);
+    BOOST_CHECK(vNodes[0]->nSendMsgSize != 0);
+    BOOST_CHECK(vNodes[1]->nSendMsgSize != 0);
+
+    // disconnected by us, the send buffer can't be flushed and the linger time runs out
+    vNodes[0]->fDisconnect = true;
+    // disconnected by the other side
+    CloseSocket(vClients[1]);
+
+    BOOST_CHECK(WaitFor([&] { return reactorConnman.GetNodeCount(CConnman::CONNECTIONS_ALL) == 0; }));
+    BOOST_CHECK(WaitFor([&] { return msgProc.nFinalized == 2; }));
+}
+#endif // USE_EPOLL
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,13 +2,19 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <chain.h>
 #include <policy/fees.h>
+#include <primitives/block.h>
 #include <txmempool.h>
 #include <uint256.h>
 #include <util.h>
+#include <validationinterface.h>
 
 #include <test/test_zenx.h>
 
+#include <deque>
+#include <future>
+
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(policyestimator_tests, BasicTestingSetup)
@@ -73,6 +79,7 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
             }
         }
         mpool.removeForBlock(block, ++blocknum);
+        feeEst.processBlock(blocknum, block);
         block.clear();
         // Check after just a few txs that combining buckets works as expected
         if (blocknum == 3) {
@@ -110,8 +117,10 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
 
     // Mine 50 more blocks with no transactions happening, estimates shouldn't change
     // We haven't decayed the moving average enough so we still have enough data points in every bucket
-    while (blocknum < 250)
+    while (blocknum < 250) {
         mpool.removeForBlock(block, ++blocknum);
+        feeEst.processBlock(blocknum, block);
+    }
 
     BOOST_CHECK(feeEst.estimateFee(1) == CFeeRate(0));
     for (int i = 2; i < 10;i++) {
@@ -132,6 +141,7 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
             }
         }
         mpool.removeForBlock(block, ++blocknum);
+        feeEst.processBlock(blocknum, block);
     }
 
     for (int i = 1; i < 10;i++) {
@@ -149,6 +159,7 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
         }
     }
     mpool.removeForBlock(block, 266);
+    feeEst.processBlock(266, block);
     block.clear();
     BOOST_CHECK(feeEst.estimateFee(1) == CFeeRate(0));
     for (int i = 2; i < 10;i++) {
@@ -170,6 +181,7 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
             }
         }
         mpool.removeForBlock(block, ++blocknum);
+        feeEst.processBlock(blocknum, block);
         block.clear();
     }
     BOOST_CHECK(feeEst.estimateFee(1) == CFeeRate(0));
@@ -178,4 +190,55 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(BlockPolicyEstimatesFromScheduler, TestingSetup)
+{
+    // Blocks reach the estimator through the validation interface queue, while txs are handed to it as soon as
+    // they enter the mempool. Txs entering right after a block was connected must still be tracked.
+    CBlockPolicyEstimator feeEst;
+    CTxMemPool mpool(&feeEst);
+    RegisterValidationInterface(&feeEst);
+    TestMemPoolEntryHelper entry;
+    CAmount fee(20000);
+
+    CScript garbage;
+    for (unsigned int i = 0; i < 128; i++)
+        garbage.push_back('X');
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = garbage;
+    tx.vout.resize(1);
+    tx.vout[0].nValue=0LL;
+
+    std::vector<CTransactionRef> block;
+    std::deque<CBlockIndex> blockIndexes;
+    for (int blocknum = 1; blocknum <= 20; blocknum++) {
+        // Hold the queue back until the txs below entered the mempool
+        std::promise<void> promise;
+        std::shared_future<void> future(promise.get_future());
+        CallFunctionInValidationInterfaceQueue([future] { future.wait(); });
+
+        // Every tx is mined in the block after the one it entered at
+        mpool.removeForBlock(block, blocknum);
+        auto pblock = std::make_shared<CBlock>();
+        pblock->vtx = block;
+        blockIndexes.emplace_back();
+        blockIndexes.back().nHeight = blocknum;
+        GetMainSignals().BlockConnected(pblock, &blockIndexes.back(), std::make_shared<const std::vector<CTransactionRef>>());
+        block.clear();
+
+        for (int k = 0; k < 10; k++) {
+            tx.vin[0].prevout.n = 100*blocknum+k;
+            uint256 hash = tx.GetHash();
+            mpool.addUnchecked(hash, entry.Fee(fee).Time(GetTime()).Height(blocknum).FromTx(tx));
+            block.push_back(mpool.get(hash));
+        }
+
+        promise.set_value();
+        SyncWithValidationInterfaceQueue();
+    }
+
+    BOOST_CHECK(feeEst.estimateFee(2) != CFeeRate(0));
+    UnregisterValidationInterface(&feeEst);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
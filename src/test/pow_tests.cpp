@@ -7,6 +7,7 @@
 #include <pow.h>
 #include <random.h>
 #include <util.h>
+#include <primitives/block.h>
 #include <test/test_zenx.h>
 
 #include <boost/test/unit_test.hpp>
@@ -179,6 +180,157 @@ BOOST_AUTO_TEST_CASE(get_next_work)
 //     BOOST_CHECK_EQUAL(CalculateNextWorkRequired(&pindexLast, nLastRetargetTime, chainParams->GetConsensus()), 0x1d00e1fd);
 // }
 
+// Copies of KimotoGravityWell and DarkGravityWave as they were before arith_uint256
+// got its single word division, to check the results stay the same bit for bit.
+static unsigned int ReferenceKimotoGravityWell(const CBlockIndex* pindexLast, const Consensus::Params& params)
+{
+    const CBlockIndex *BlockLastSolved = pindexLast;
+    const CBlockIndex *BlockReading = pindexLast;
+    uint64_t PastBlocksMass = 0;
+    int64_t PastRateActualSeconds = 0;
+    int64_t PastRateTargetSeconds = 0;
+    double PastRateAdjustmentRatio = double(1);
+    arith_uint256 PastDifficultyAverage;
+    arith_uint256 PastDifficultyAveragePrev;
+
+    uint64_t pastSecondsMin = params.nPowTargetTimespan * 0.025;
+    uint64_t pastSecondsMax = params.nPowTargetTimespan * 7;
+    uint64_t PastBlocksMin = pastSecondsMin / params.nPowTargetSpacing;
+    uint64_t PastBlocksMax = pastSecondsMax / params.nPowTargetSpacing;
+
+    if (BlockLastSolved == nullptr || BlockLastSolved->nHeight == 0 || (uint64_t)BlockLastSolved->nHeight < PastBlocksMin) { return UintToArith256(params.powLimit).GetCompact(); }
+
+    for (unsigned int i = 1; BlockReading && BlockReading->nHeight > 0; i++) {
+        if (PastBlocksMax > 0 && i > PastBlocksMax) { break; }
+        PastBlocksMass++;
+
+        PastDifficultyAverage.SetCompact(BlockReading->nBits);
+        if (i > 1) {
+            if(PastDifficultyAverage >= PastDifficultyAveragePrev)
+                PastDifficultyAverage = ((PastDifficultyAverage - PastDifficultyAveragePrev) / arith_uint256(i)) + PastDifficultyAveragePrev;
+            else
+                PastDifficultyAverage = PastDifficultyAveragePrev - ((PastDifficultyAveragePrev - PastDifficultyAverage) / arith_uint256(i));
+        }
+        PastDifficultyAveragePrev = PastDifficultyAverage;
+
+        PastRateActualSeconds = BlockLastSolved->GetBlockTime() - BlockReading->GetBlockTime();
+        PastRateTargetSeconds = params.nPowTargetSpacing * PastBlocksMass;
+        PastRateAdjustmentRatio = double(1);
+        if (PastRateActualSeconds < 0) { PastRateActualSeconds = 0; }
+        if (PastRateActualSeconds != 0 && PastRateTargetSeconds != 0) {
+            PastRateAdjustmentRatio = double(PastRateTargetSeconds) / double(PastRateActualSeconds);
+        }
+        double EventHorizonDeviation = 1 + (0.7084 * pow((double(PastBlocksMass)/double(28.2)), -1.228));
+        double EventHorizonDeviationFast = EventHorizonDeviation;
+        double EventHorizonDeviationSlow = 1 / EventHorizonDeviation;
+
+        if (PastBlocksMass >= PastBlocksMin) {
+            if ((PastRateAdjustmentRatio <= EventHorizonDeviationSlow) || (PastRateAdjustmentRatio >= EventHorizonDeviationFast)) { break; }
+        }
+        if (BlockReading->pprev == nullptr) { break; }
+        BlockReading = BlockReading->pprev;
+    }
+
+    arith_uint256 bnNew(PastDifficultyAverage);
+    if (PastRateActualSeconds != 0 && PastRateTargetSeconds != 0) {
+        bnNew *= PastRateActualSeconds;
+        bnNew /= arith_uint256(PastRateTargetSeconds);
+    }
+
+    if (bnNew > UintToArith256(params.powLimit)) {
+        bnNew = UintToArith256(params.powLimit);
+    }
+
+    return bnNew.GetCompact();
+}
+
+static unsigned int ReferenceDarkGravityWave(const CBlockIndex* pindexLast, const Consensus::Params& params)
+{
+    const arith_uint256 bnPowLimit = UintToArith256(params.powBalloonLimit);
+
+    if (pindexLast->nHeight > 1628 && pindexLast->nHeight < 1660)
+        return bnPowLimit.GetCompact();
+
+    int64_t nPastBlocks = 24;
+
+    if (!pindexLast || pindexLast->nHeight < nPastBlocks) {
+        return bnPowLimit.GetCompact();
+    }
+
+    const CBlockIndex *pindex = pindexLast;
+    arith_uint256 bnPastTargetAvg;
+
+    for (unsigned int nCountBlocks = 1; nCountBlocks <= nPastBlocks; nCountBlocks++) {
+        arith_uint256 bnTarget = arith_uint256().SetCompact(pindex->nBits);
+        if (nCountBlocks == 1) {
+            bnPastTargetAvg = bnTarget;
+        } else {
+            bnPastTargetAvg = (bnPastTargetAvg * nCountBlocks + bnTarget) / arith_uint256(nCountBlocks + 1);
+        }
+
+        if(nCountBlocks != nPastBlocks) {
+            pindex = pindex->pprev;
+        }
+    }
+
+    arith_uint256 bnNew(bnPastTargetAvg);
+
+    int64_t nActualTimespan = pindexLast->GetBlockTime() - pindex->GetBlockTime();
+    int64_t nTargetTimespan = nPastBlocks * params.nPowTargetSpacing;
+
+    if (nActualTimespan < nTargetTimespan/3)
+        nActualTimespan = nTargetTimespan/3;
+    if (nActualTimespan > nTargetTimespan*3)
+        nActualTimespan = nTargetTimespan*3;
+
+    bnNew *= nActualTimespan;
+    bnNew /= arith_uint256(nTargetTimespan);
+
+    if (bnNew > bnPowLimit) {
+        bnNew = bnPowLimit;
+    }
+
+    return bnNew.GetCompact();
+}
+
+/** Build a chain with random targets below limit and jittery block times. */
+static void BuildRandomChain(std::vector<CBlockIndex>& blocks, const arith_uint256& limit, const Consensus::Params& params)
+{
+    for (size_t i = 0; i < blocks.size(); i++) {
+        blocks[i].pprev = i ? &blocks[i - 1] : nullptr;
+        blocks[i].nHeight = i;
+        blocks[i].nTime = i ? blocks[i - 1].nTime + InsecureRandRange(params.nPowTargetSpacing * 4) - params.nPowTargetSpacing / 2 : 1546300800;
+        blocks[i].nBits = arith_uint256(limit >> InsecureRandRange(64)).GetCompact();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(get_next_work_random_chain)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = chainParams->GetConsensus();
+    CBlockHeader header;
+
+    // DGW is used from the start on mainnet
+    BOOST_CHECK_EQUAL(params.nPowDGWHeight, 0);
+    std::vector<CBlockIndex> blocks(3000);
+    BuildRandomChain(blocks, UintToArith256(params.powBalloonLimit), params);
+    for (const CBlockIndex& block : blocks) {
+        header.nTime = block.nTime + params.nPowTargetSpacing;
+        BOOST_CHECK_EQUAL(GetNextWorkRequired(&block, &header, params), ReferenceDarkGravityWave(&block, params));
+    }
+
+    // KGW, on a sample of heights as its window is much longer
+    Consensus::Params paramsKGW = params;
+    paramsKGW.nPowDGWHeight = std::numeric_limits<int>::max();
+    std::vector<CBlockIndex> blocksKGW(1000);
+    BuildRandomChain(blocksKGW, UintToArith256(params.powLimit), params);
+    for (int i = 0; i < 100; i++) {
+        const CBlockIndex* pindex = &blocksKGW[InsecureRandRange(blocksKGW.size())];
+        header.nTime = pindex->nTime + params.nPowTargetSpacing;
+        BOOST_CHECK_EQUAL(GetNextWorkRequired(pindex, &header, paramsKGW), ReferenceKimotoGravityWell(pindex, paramsKGW));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
 {
     const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
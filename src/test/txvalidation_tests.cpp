@@ -8,7 +8,13 @@
 #include <consensus/validation.h>
 #include <primitives/transaction.h>
 #include <script/script.h>
+#include <script/sign.h>
 #include <test/test_zenx.h>
+#include <util.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
 
 #include <boost/test/unit_test.hpp>
 
@@ -57,4 +63,71 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_reject_coinbase, TestChain100Setup)
     BOOST_CHECK_EQUAL(nDoS, 100);
 }
 
+/**
+ * Ensure that a dumped mempool is loaded again, and that a tampered dump doesn't get its scripts skipped.
+ */
+BOOST_FIXTURE_TEST_CASE(tx_mempool_dump_roundtrip, TestChain100Setup)
+{
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // A chain of three transactions, each spending the single output of the one before it
+    std::vector<CMutableTransaction> txs(3);
+    COutPoint prevout(coinbaseTxns[0].GetHash(), 0);
+    CAmount nValue = coinbaseTxns[0].vout[0].nValue;
+    for (auto& tx : txs) {
+        nValue -= CENT;
+        tx.nVersion = 1;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = prevout;
+        tx.vout.resize(1);
+        tx.vout[0].nValue = nValue;
+        tx.vout[0].scriptPubKey = scriptPubKey;
+
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, tx, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        tx.vin[0].scriptSig << vchSig;
+
+        CValidationState state;
+        LOCK(cs_main);
+        BOOST_CHECK(AcceptToMemoryPool(mempool, state, MakeTransactionRef(tx), nullptr /* pfMissingInputs */,
+                                       false /* bypass_limits */, 0 /* nAbsurdFee */));
+        prevout = COutPoint(tx.GetHash(), 0);
+    }
+    BOOST_CHECK_EQUAL(mempool.size(), txs.size());
+
+    BOOST_CHECK(DumpMempool());
+    mempool.clear();
+    BOOST_CHECK(LoadMempool());
+    BOOST_CHECK_EQUAL(mempool.size(), txs.size());
+    for (const auto& tx : txs) {
+        BOOST_CHECK(mempool.exists(tx.GetHash()));
+    }
+
+    // Break the signature of the last transaction. Fee and sigop count don't change, so only the checksum tells
+    // that the file can't be trusted anymore.
+    const fs::path path = GetDataDir() / "mempool.dat";
+    std::vector<char> vData;
+    {
+        std::ifstream file(path.string(), std::ios::binary);
+        vData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    const CScript& scriptSig = txs.back().vin[0].scriptSig;
+    auto it = std::search(vData.begin(), vData.end(), scriptSig.begin(), scriptSig.end());
+    BOOST_REQUIRE(it != vData.end());
+    *(it + 10) ^= 1;
+    {
+        std::ofstream file(path.string(), std::ios::binary | std::ios::trunc);
+        file.write(vData.data(), vData.size());
+    }
+
+    mempool.clear();
+    BOOST_CHECK(LoadMempool());
+    BOOST_CHECK_EQUAL(mempool.size(), txs.size() - 1);
+    BOOST_CHECK(mempool.exists(txs[0].GetHash()));
+    BOOST_CHECK(mempool.exists(txs[1].GetHash()));
+    BOOST_CHECK(!mempool.exists(txs[2].GetHash()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
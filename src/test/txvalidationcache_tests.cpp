@@ -103,6 +103,48 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_block_doublespend, TestChain100Setup)
     BOOST_CHECK_EQUAL(mempool.size(), 0);
 }
 
+BOOST_FIXTURE_TEST_CASE(tx_mempool_preverify, TestChain100Setup)
+{
+    CScript scriptPubKey = CScript() <<  ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    std::vector<CTransactionRef> spends;
+    for (int i = 0; i < 3; i++) {
+        CMutableTransaction spend;
+        spend.nVersion = 1;
+        spend.vin.resize(1);
+        spend.vin[0].prevout = COutPoint(coinbaseTxns[i].GetHash(), 0);
+        spend.vout.resize(1);
+        spend.vout[0].nValue = 11*CENT;
+        spend.vout[0].scriptPubKey = scriptPubKey;
+
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        if (i == 2) {
+            // invalid signature
+            vchSig[10] ^= 1;
+        }
+        spend.vin[0].scriptSig << vchSig;
+        spends.emplace_back(MakeTransactionRef(spend));
+    }
+
+    // all of them get verified, but only once
+    BOOST_CHECK_EQUAL(PreVerifyTransactions(mempool, spends), 3U);
+    BOOST_CHECK_EQUAL(PreVerifyTransactions(mempool, spends), 0U);
+
+    // pre-verification must not change the outcome of AcceptToMemoryPool
+    {
+        LOCK(cs_main);
+        for (int i = 0; i < 3; i++) {
+            CValidationState state;
+            BOOST_CHECK_EQUAL(AcceptToMemoryPool(mempool, state, spends[i], nullptr /* pfMissingInputs */,
+                                                 true /* bypass_limits */, 0 /* nAbsurdFee */), i != 2);
+        }
+    }
+    mempool.clear();
+}
+
 // Run CheckInputs (using pcoinsTip) on the given transaction, for all script
 // flags.  Test that CheckInputs passes for all flags that don't overlap with
 // the failing_flags argument, but otherwise fails.
@@ -0,0 +1,57 @@
+// Copyright (c) 2020 The Dash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <validation.h>
+#include <versionbits.h>
+#include <test/test_zenx.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(validation_headers_tests, TestingSetup)
+
+static std::vector<CBlockHeader> MakeHeaders(const CBlockHeader& prev, size_t count)
+{
+    std::vector<CBlockHeader> headers(count);
+    uint256 hashPrev = prev.GetHash();
+    uint32_t nTime = prev.nTime;
+    for (CBlockHeader& header : headers) {
+        header.nVersion = VERSIONBITS_TOP_BITS;
+        header.hashPrevBlock = hashPrev;
+        header.hashMerkleRoot = InsecureRand256();
+        header.nTime = nTime += 60;
+        header.nBits = prev.nBits;
+        hashPrev = header.GetHash();
+    }
+    return headers;
+}
+
+BOOST_AUTO_TEST_CASE(process_new_block_headers)
+{
+    // Enough headers to be spread over several header check threads
+    const std::vector<CBlockHeader> headers = MakeHeaders(Params().GenesisBlock(), 100);
+    CValidationState state;
+    const CBlockIndex* pindex = nullptr;
+    BOOST_CHECK(ProcessNewBlockHeaders(headers, state, Params(), &pindex));
+    BOOST_CHECK_EQUAL(pindex->nHeight, 100);
+    BOOST_CHECK(pindex->GetBlockHash() == headers.back().GetHash());
+    {
+        LOCK(cs_main);
+        for (const CBlockHeader& header : headers) {
+            BOOST_CHECK(mapBlockIndex.count(header.GetHash()));
+        }
+    }
+
+    // Headers before the first invalid one are still accepted
+    std::vector<CBlockHeader> more = MakeHeaders(headers.back(), 50);
+    more[30].nTime = Params().GenesisBlock().nTime;
+    CBlockHeader first_invalid;
+    BOOST_CHECK(!ProcessNewBlockHeaders(more, state, Params(), &pindex, &first_invalid));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "time-too-old");
+    BOOST_CHECK(first_invalid.GetHash() == more[30].GetHash());
+    BOOST_CHECK_EQUAL(pindex->nHeight, 130);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -418,31 +418,45 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     // Invalid ProTxes should never get this far because transactions should be
     // fully checked by AcceptToMemoryPool() at this point, so we just assume that
     // everything is fine here.
+    auto addProTxRef = [&](const uint256& proTxHash, const uint256& txHash) {
+        mapProTxRefs.emplace(proTxHash, txHash);
+        mapIndexedKeys[hash].proTxRefs.emplace_back(proTxHash, txHash);
+    };
+    // only remember keys we actually own, so that removal can't drop another TX's entry
+    auto addProTxKey = [&](auto& map, auto& keys, const auto& key) {
+        if (map.emplace(key, hash).second) {
+            keys.emplace_back(key);
+        }
+    };
+
     if (tx.nType == TRANSACTION_PROVIDER_REGISTER) {
         CProRegTx proTx;
         bool ok = GetTxPayload(tx, proTx);
         assert(ok);
+        auto& keys = mapIndexedKeys[hash];
         if (!proTx.collateralOutpoint.hash.IsNull()) {
-            mapProTxRefs.emplace(tx.GetHash(), proTx.collateralOutpoint.hash);
+            addProTxRef(tx.GetHash(), proTx.collateralOutpoint.hash);
         }
-        mapProTxAddresses.emplace(proTx.addr, tx.GetHash());
-        mapProTxPubKeyIDs.emplace(proTx.keyIDOwner, tx.GetHash());
-        mapProTxBlsPubKeyHashes.emplace(proTx.pubKeyOperator.GetHash(), tx.GetHash());
+        addProTxKey(mapProTxAddresses, keys.proTxAddresses, proTx.addr);
+        addProTxKey(mapProTxPubKeyIDs, keys.proTxPubKeyIDs, proTx.keyIDOwner);
+        addProTxKey(mapProTxBlsPubKeyHashes, keys.proTxBlsPubKeyHashes, proTx.pubKeyOperator.GetHash());
         if (!proTx.collateralOutpoint.hash.IsNull()) {
-            mapProTxCollaterals.emplace(proTx.collateralOutpoint, tx.GetHash());
+            addProTxKey(mapProTxCollaterals, keys.proTxCollaterals, proTx.collateralOutpoint);
         }
     } else if (tx.nType == TRANSACTION_PROVIDER_UPDATE_SERVICE) {
         CProUpServTx proTx;
         bool ok = GetTxPayload(tx, proTx);
         assert(ok);
-        mapProTxRefs.emplace(proTx.proTxHash, tx.GetHash());
-        mapProTxAddresses.emplace(proTx.addr, tx.GetHash());
+        auto& keys = mapIndexedKeys[hash];
+        addProTxRef(proTx.proTxHash, tx.GetHash());
+        addProTxKey(mapProTxAddresses, keys.proTxAddresses, proTx.addr);
     } else if (tx.nType == TRANSACTION_PROVIDER_UPDATE_REGISTRAR) {
         CProUpRegTx proTx;
         bool ok = GetTxPayload(tx, proTx);
         assert(ok);
-        mapProTxRefs.emplace(proTx.proTxHash, tx.GetHash());
-        mapProTxBlsPubKeyHashes.emplace(proTx.pubKeyOperator.GetHash(), tx.GetHash());
+        auto& keys = mapIndexedKeys[hash];
+        addProTxRef(proTx.proTxHash, tx.GetHash());
+        addProTxKey(mapProTxBlsPubKeyHashes, keys.proTxBlsPubKeyHashes, proTx.pubKeyOperator.GetHash());
         auto dmn = deterministicMNManager->GetListAtChainTip().GetMN(proTx.proTxHash);
         assert(dmn);
         newit->validForProTxKey = ::SerializeHash(dmn->pdmnState->pubKeyOperator);
@@ -453,7 +467,7 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
         CProUpRevTx proTx;
         bool ok = GetTxPayload(tx, proTx);
         assert(ok);
-        mapProTxRefs.emplace(proTx.proTxHash, tx.GetHash());
+        addProTxRef(proTx.proTxHash, tx.GetHash());
         auto dmn = deterministicMNManager->GetListAtChainTip().GetMN(proTx.proTxHash);
         assert(dmn);
         newit->validForProTxKey = ::SerializeHash(dmn->pdmnState->pubKeyOperator);
@@ -480,19 +494,19 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
             std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(2, uint160(hashBytes), txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
+            mapAddress[std::make_pair(key.type, key.addressBytes)].emplace(key, delta);
             inserted.push_back(key);
         } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
             std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
             CMempoolAddressDeltaKey key(1, uint160(hashBytes), txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
+            mapAddress[std::make_pair(key.type, key.addressBytes)].emplace(key, delta);
             inserted.push_back(key);
         } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
             uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
             CMempoolAddressDeltaKey key(1, hashBytes, txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
+            mapAddress[std::make_pair(key.type, key.addressBytes)].emplace(key, delta);
             inserted.push_back(key);
         }
     }
@@ -502,24 +516,25 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
         if (out.scriptPubKey.IsPayToScriptHash()) {
             std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(2, uint160(hashBytes), txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
+            mapAddress[std::make_pair(key.type, key.addressBytes)].emplace(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
             inserted.push_back(key);
         } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
             std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-            std::pair<addressDeltaMap::iterator,bool> ret;
             CMempoolAddressDeltaKey key(1, uint160(hashBytes), txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
+            mapAddress[std::make_pair(key.type, key.addressBytes)].emplace(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
             inserted.push_back(key);
         } else if (out.scriptPubKey.IsPayToPublicKey()) {
             uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-            std::pair<addressDeltaMap::iterator,bool> ret;
             CMempoolAddressDeltaKey key(1, hashBytes, txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
+            mapAddress[std::make_pair(key.type, key.addressBytes)].emplace(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
             inserted.push_back(key);
         }
     }
 
-    mapAddressInserted.insert(std::make_pair(txhash, inserted));
+    if (!inserted.empty()) {
+        auto& keys = mapIndexedKeys[txhash].addressDeltas;
+        keys.insert(keys.end(), inserted.begin(), inserted.end());
+    }
 }
 
 bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresses,
@@ -527,10 +542,9 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresse
 {
     LOCK(cs);
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
-            results.push_back(*ait);
-            ait++;
+        addressDeltaIndex::const_iterator ait = mapAddress.find(std::make_pair((*it).second, (*it).first));
+        if (ait != mapAddress.end()) {
+            results.insert(results.end(), ait->second.begin(), ait->second.end());
         }
     }
     return true;
@@ -539,14 +553,19 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresse
 bool CTxMemPool::removeAddressIndex(const uint256 txhash)
 {
     LOCK(cs);
-    addressDeltaMapInserted::iterator it = mapAddressInserted.find(txhash);
-
-    if (it != mapAddressInserted.end()) {
-        std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
-        for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapAddress.erase(*mit);
+    auto it = mapIndexedKeys.find(txhash);
+
+    if (it != mapIndexedKeys.end()) {
+        for (const auto& key : it->second.addressDeltas) {
+            auto ait = mapAddress.find(std::make_pair(key.type, key.addressBytes));
+            if (ait != mapAddress.end()) {
+                ait->second.erase(key);
+                if (ait->second.empty()) {
+                    mapAddress.erase(ait);
+                }
+            }
         }
-        mapAddressInserted.erase(it);
+        it->second.addressDeltas.clear();
     }
 
     return true;
@@ -584,12 +603,15 @@ void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCac
         CSpentIndexKey key = CSpentIndexKey(input.prevout.hash, input.prevout.n);
         CSpentIndexValue value = CSpentIndexValue(txhash, j, -1, prevout.nValue, addressType, addressHash);
 
-        mapSpent.insert(std::make_pair(key, value));
-        inserted.push_back(key);
-
+        if (mapSpent.emplace(key, value).second) {
+            inserted.push_back(key);
+        }
     }
 
-    mapSpentInserted.insert(make_pair(txhash, inserted));
+    if (!inserted.empty()) {
+        auto& keys = mapIndexedKeys[txhash].spentOutpoints;
+        keys.insert(keys.end(), inserted.begin(), inserted.end());
+    }
 }
 
 bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
@@ -608,19 +630,53 @@ bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 bool CTxMemPool::removeSpentIndex(const uint256 txhash)
 {
     LOCK(cs);
-    mapSpentIndexInserted::iterator it = mapSpentInserted.find(txhash);
+    auto it = mapIndexedKeys.find(txhash);
 
-    if (it != mapSpentInserted.end()) {
-        std::vector<CSpentIndexKey> keys = (*it).second;
-        for (std::vector<CSpentIndexKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapSpent.erase(*mit);
+    if (it != mapIndexedKeys.end()) {
+        for (const auto& key : it->second.spentOutpoints) {
+            mapSpent.erase(key);
         }
-        mapSpentInserted.erase(it);
+        it->second.spentOutpoints.clear();
     }
 
     return true;
 }
 
+void CTxMemPool::removeIndexedKeys(const uint256& txhash)
+{
+    auto it = mapIndexedKeys.find(txhash);
+    if (it == mapIndexedKeys.end()) {
+        return;
+    }
+
+    removeAddressIndex(txhash);
+    removeSpentIndex(txhash);
+
+    const IndexedKeys& keys = it->second;
+    for (const auto& p : keys.proTxRefs) {
+        auto its = mapProTxRefs.equal_range(p.first);
+        for (auto refIt = its.first; refIt != its.second; ++refIt) {
+            if (refIt->second == p.second) {
+                mapProTxRefs.erase(refIt);
+                break;
+            }
+        }
+    }
+    for (const auto& addr : keys.proTxAddresses) {
+        mapProTxAddresses.erase(addr);
+    }
+    for (const auto& keyId : keys.proTxPubKeyIDs) {
+        mapProTxPubKeyIDs.erase(keyId);
+    }
+    for (const auto& pubKeyHash : keys.proTxBlsPubKeyHashes) {
+        mapProTxBlsPubKeyHashes.erase(pubKeyHash);
+    }
+    for (const auto& outpoint : keys.proTxCollaterals) {
+        mapProTxCollaterals.erase(outpoint);
+    }
+    mapIndexedKeys.erase(it);
+}
+
 void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 {
     NotifyEntryRemoved(it->GetSharedTx(), reason);
@@ -637,50 +693,7 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     } else
         vTxHashes.clear();
 
-    auto eraseProTxRef = [&](const uint256& proTxHash, const uint256& txHash) {
-        auto its = mapProTxRefs.equal_range(proTxHash);
-        for (auto it = its.first; it != its.second;) {
-            if (it->second == txHash) {
-                it = mapProTxRefs.erase(it);
-            } else {
-                ++it;
-            }
-        }
-    };
-
-    if (it->GetTx().nType == TRANSACTION_PROVIDER_REGISTER) {
-        CProRegTx proTx;
-        if (!GetTxPayload(it->GetTx(), proTx)) {
-            assert(false);
-        }
-        if (!proTx.collateralOutpoint.IsNull()) {
-            eraseProTxRef(it->GetTx().GetHash(), proTx.collateralOutpoint.hash);
-        }
-        mapProTxAddresses.erase(proTx.addr);
-        mapProTxPubKeyIDs.erase(proTx.keyIDOwner);
-        mapProTxBlsPubKeyHashes.erase(proTx.pubKeyOperator.GetHash());
-        mapProTxCollaterals.erase(proTx.collateralOutpoint);
-    } else if (it->GetTx().nType == TRANSACTION_PROVIDER_UPDATE_SERVICE) {
-        CProUpServTx proTx;
-        if (!GetTxPayload(it->GetTx(), proTx)) {
-            assert(false);
-        }
-        eraseProTxRef(proTx.proTxHash, it->GetTx().GetHash());
-        mapProTxAddresses.erase(proTx.addr);
-    } else if (it->GetTx().nType == TRANSACTION_PROVIDER_UPDATE_REGISTRAR) {
-        CProUpRegTx proTx;
-        if (!GetTxPayload(it->GetTx(), proTx)) {
-            assert(false);
-        }
-        eraseProTxRef(proTx.proTxHash, it->GetTx().GetHash());
-        mapProTxBlsPubKeyHashes.erase(proTx.pubKeyOperator.GetHash());
-    } else if (it->GetTx().nType == TRANSACTION_PROVIDER_UPDATE_REVOKE) {
-        CProUpRevTx proTx;
-        if (!GetTxPayload(it->GetTx(), proTx)) {
-            assert(false);
-        }
-        eraseProTxRef(proTx.proTxHash, it->GetTx().GetHash());
-    }
+    removeIndexedKeys(hash);
 
     totalTxSize -= it->GetTxSize();
     cachedInnerUsage -= it->DynamicMemoryUsage();
@@ -688,9 +701,8 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     mapLinks.erase(it);
     mapTx.erase(it);
     nTransactionsUpdated++;
-    if (minerPolicyEstimator) {minerPolicyEstimator->removeTx(hash, false);}
-    removeAddressIndex(hash);
-    removeSpentIndex(hash);
+    // txs included in a block are handed to the estimator by its BlockConnected callback
+    if (minerPolicyEstimator && reason != MemPoolRemovalReason::BLOCK) {minerPolicyEstimator->removeTx(hash, false);}
 }
 
 // Calculates descendants of entry that are not already in setDescendants, and adds to
@@ -948,22 +960,12 @@ void CTxMemPool::removeProTxConflicts(const CTransaction &tx)
 }
 
 /**
- * Called when a block is connected. Removes from mempool and updates the miner fee estimator.
+ * Called when a block is connected. Removes from mempool. The miner fee estimator learns about
+ * the block through the validation interface.
  */
 void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight)
 {
     LOCK(cs);
-    std::vector<const CTxMemPoolEntry*> entries;
-    for (const auto& tx : vtx)
-    {
-        uint256 hash = tx->GetHash();
-
-        indexed_transaction_set::iterator i = mapTx.find(hash);
-        if (i != mapTx.end())
-            entries.push_back(&*i);
-    }
-    // Before the txs in the new block have been removed from the mempool, update policy estimates
-    if (minerPolicyEstimator) {minerPolicyEstimator->processBlock(nBlockHeight, entries);}
     for (const auto& tx : vtx)
     {
         txiter it = mapTx.find(tx->GetHash());
@@ -985,8 +987,14 @@ void CTxMemPool::_clear()
     mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
+    mapAddress.clear();
+    mapSpent.clear();
+    mapProTxRefs.clear();
     mapProTxAddresses.clear();
     mapProTxPubKeyIDs.clear();
+    mapProTxBlsPubKeyHashes.clear();
+    mapProTxCollaterals.clear();
+    mapIndexedKeys.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
     lastRollingFeeUpdate = GetTime();
@@ -1191,7 +1199,8 @@ void CTxMemPool::queryHashes(std::vector<uint256>& vtxid)
 }
 
 static TxMempoolInfo GetInfo(CTxMemPool::indexed_transaction_set::const_iterator it) {
-    return TxMempoolInfo{it->GetSharedTx(), it->GetTime(), CFeeRate(it->GetFee(), it->GetTxSize()), it->GetModifiedFee() - it->GetFee()};
+    return TxMempoolInfo{it->GetSharedTx(), it->GetTime(), CFeeRate(it->GetFee(), it->GetTxSize()), it->GetModifiedFee() - it->GetFee(),
+                         it->GetFee(), it->GetSigOpCount()};
 }
 
 std::vector<TxMempoolInfo> CTxMemPool::infoAll() const
@@ -9,6 +9,7 @@
 #include <memory>
 #include <set>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 #include <string>
@@ -23,6 +24,7 @@
 #include <sync.h>
 #include <random.h>
 #include <netaddress.h>
+#include <saltedhasher.h>
 #include <bls/bls.h>
 #include <pubkey.h>
 
@@ -341,6 +343,12 @@ struct TxMempoolInfo
 
     /** The fee delta. */
     int64_t nFeeDelta;
+
+    /** The fee of the transaction itself, without the fee delta. */
+    CAmount nFee;
+
+    /** Sigop count of the transaction. */
+    unsigned int nSigOpCount;
 };
 
 /** Reason why a transaction was removed from the mempool,
@@ -369,6 +377,46 @@ public:
     }
 };
 
+/** Hashers for the keys of the mempool's secondary indexes */
+template<>
+struct SaltedHasherImpl<std::pair<int, uint160>>
+{
+    static std::size_t CalcHash(const std::pair<int, uint160>& v, uint64_t k0, uint64_t k1)
+    {
+        return CSipHasher(k0, k1).Write((uint64_t)v.first).Write(v.second.begin(), v.second.size()).Finalize();
+    }
+};
+
+template<>
+struct SaltedHasherImpl<CSpentIndexKey>
+{
+    static std::size_t CalcHash(const CSpentIndexKey& v, uint64_t k0, uint64_t k1)
+    {
+        return SipHashUint256Extra(k0, k1, v.txid, v.outputIndex);
+    }
+};
+
+template<>
+struct SaltedHasherImpl<CKeyID>
+{
+    static std::size_t CalcHash(const CKeyID& v, uint64_t k0, uint64_t k1)
+    {
+        return CSipHasher(k0, k1).Write(v.begin(), v.size()).Finalize();
+    }
+};
+
+template<>
+struct SaltedHasherImpl<CService>
+{
+    static std::size_t CalcHash(const CService& v, uint64_t k0, uint64_t k1)
+    {
+        // same fields as CService::GetKey(), without building a vector
+        struct in6_addr addr;
+        v.GetIn6Addr(&addr);
+        return CSipHasher(k0, k1).Write(addr.s6_addr, sizeof(addr.s6_addr)).Write(v.GetPort()).Finalize();
+    }
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain transactions
  * that may be included in the next block.
@@ -511,23 +559,38 @@ private:
     typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
     txlinksMap mapLinks;
 
+    // deltas of a single address, ordered the way getAddressIndex returns them
     typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
-    addressDeltaMap mapAddress;
-
-    typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
-    addressDeltaMapInserted mapAddressInserted;
+    // (address type, address hash) -> deltas of that address
+    typedef std::unordered_map<std::pair<int, uint160>, addressDeltaMap, StaticSaltedHasher> addressDeltaIndex;
+    addressDeltaIndex mapAddress;
 
-    typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
+    typedef std::unordered_map<CSpentIndexKey, CSpentIndexValue, StaticSaltedHasher> mapSpentIndex;
     mapSpentIndex mapSpent;
 
-    typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
-    mapSpentIndexInserted mapSpentInserted;
+    std::unordered_multimap<uint256, uint256, StaticSaltedHasher> mapProTxRefs; // proTxHash -> transaction (all TXs that refer to an existing proTx)
+    std::unordered_map<CService, uint256, StaticSaltedHasher> mapProTxAddresses;
+    std::unordered_map<CKeyID, uint256, StaticSaltedHasher> mapProTxPubKeyIDs;
+    std::unordered_map<uint256, uint256, StaticSaltedHasher> mapProTxBlsPubKeyHashes;
+    std::unordered_map<COutPoint, uint256, SaltedOutpointHasher> mapProTxCollaterals;
+
+    /**
+     * The keys a transaction owns in the secondary indexes above. Only transactions which own at least one key have
+     * an entry. removeUnchecked uses this to clean up the indexes without re-parsing payloads or re-deriving
+     * addresses, and to never erase a key that another transaction owns.
+     */
+    struct IndexedKeys {
+        std::vector<CMempoolAddressDeltaKey> addressDeltas;
+        std::vector<CSpentIndexKey> spentOutpoints;
+        std::vector<std::pair<uint256, uint256>> proTxRefs;
+        std::vector<CService> proTxAddresses;
+        std::vector<CKeyID> proTxPubKeyIDs;
+        std::vector<uint256> proTxBlsPubKeyHashes;
+        std::vector<COutPoint> proTxCollaterals;
+    };
+    std::unordered_map<uint256, IndexedKeys, StaticSaltedHasher> mapIndexedKeys;
 
-    std::multimap<uint256, uint256> mapProTxRefs; // proTxHash -> transaction (all TXs that refer to an existing proTx)
-    std::map<CService, uint256> mapProTxAddresses;
-    std::map<CKeyID, uint256> mapProTxPubKeyIDs;
-    std::map<uint256, uint256> mapProTxBlsPubKeyHashes;
-    std::map<COutPoint, uint256> mapProTxCollaterals;
+    void removeIndexedKeys(const uint256& txhash);
 
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
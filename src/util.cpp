@@ -36,8 +36,10 @@
 
 #include <algorithm>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #else
 
@@ -1190,6 +1192,54 @@ void AllocateFileRange(FILE *file, unsigned int offset, unsigned int length) {
 #endif
 }
 
+CMappedFile::CMappedFile(const fs::path& path)
+{
+#ifndef WIN32
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            posix_madvise(p, st.st_size, POSIX_MADV_SEQUENTIAL);
+            pdata = static_cast<const unsigned char*>(p);
+            nSize = st.st_size;
+            fMapped = true;
+        }
+    }
+    close(fd);
+    if (fMapped) {
+        return;
+    }
+#endif
+    // Fallback version
+    FILE* file = fsbridge::fopen(path, "rb");
+    if (!file) {
+        return;
+    }
+    unsigned char buf[65536];
+    size_t nRead;
+    while ((nRead = fread(buf, 1, sizeof(buf), file)) > 0) {
+        vBuffer.insert(vBuffer.end(), buf, buf + nRead);
+    }
+    fclose(file);
+    if (!vBuffer.empty()) {
+        pdata = vBuffer.data();
+        nSize = vBuffer.size();
+    }
+}
+
+CMappedFile::~CMappedFile()
+{
+#ifndef WIN32
+    if (fMapped) {
+        munmap(const_cast<unsigned char*>(pdata), nSize);
+    }
+#endif
+}
+
 void ShrinkDebugFile()
 {
     // Amount of debug.log to save at end when shrinking (must fit in memory)
@@ -233,6 +233,31 @@ void AllocateFileRange(FILE *file, unsigned int offset, unsigned int length);
 bool RenameOver(fs::path src, fs::path dest);
 bool LockDirectory(const fs::path& directory, const std::string lockfile_name, bool probe_only=false);
 
+/**
+ * Read-only view of the whole content of a file. The file is memory mapped where possible and read into memory
+ * otherwise. IsNull() is true if the file can't be opened or is empty.
+ */
+class CMappedFile
+{
+private:
+    const unsigned char* pdata{nullptr};
+    size_t nSize{0};
+    bool fMapped{false};
+    std::vector<unsigned char> vBuffer;
+
+public:
+    explicit CMappedFile(const fs::path& path);
+    ~CMappedFile();
+
+    CMappedFile(const CMappedFile&) = delete;
+    CMappedFile& operator=(const CMappedFile&) = delete;
+
+    bool IsNull() const { return pdata == nullptr; }
+    const unsigned char* begin() const { return pdata; }
+    const unsigned char* end() const { return pdata + nSize; }
+    size_t size() const { return nSize; }
+};
+
 /** Release all directory locks. This is used for unit testing only, at runtime
  * the global destructor will take care of the locks.
  */
@@ -25,6 +25,7 @@
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <reverse_iterator.h>
+#include <saltedhasher.h>
 #include <script/script.h>
 #include <script/sigcache.h>
 #include <script/standard.h>
@@ -34,6 +35,7 @@
 #include <txmempool.h>
 #include <ui_interface.h>
 #include <undo.h>
+#include <unordered_lru_cache.h>
 #include <util.h>
 #include <spork.h>
 #include <utilmoneystr.h>
@@ -56,6 +58,7 @@
 
 #include <future>
 #include <sstream>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -170,6 +173,7 @@ public:
     bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams, std::shared_ptr<const CBlock> pblock);
 
     bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex);
+    bool AcceptBlockHeader(const CBlockHeader& block, const uint256& hash, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex);
     bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock);
 
     // Block (dis)connection on a given view:
@@ -707,7 +711,8 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, CValidationSt
 
 static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx,
                                      bool* pfMissingInputs, int64_t nAcceptTime, bool bypass_limits,
-                                     const CAmount& nAbsurdFee, std::vector<COutPoint>& coins_to_uncache, bool fDryRun)
+                                     const CAmount& nAbsurdFee, std::vector<COutPoint>& coins_to_uncache, bool fDryRun,
+                                     bool fSkipScriptChecks)
 {
     const CTransaction& tx = *ptx;
     const uint256 hash = tx.GetHash();
@@ -898,8 +903,10 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
 
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
+        // Only skipped when the caller knows the scripts were verified against exactly these inputs and flags
+        // before (see LoadMempool).
         PrecomputedTransactionData txdata(tx);
-        if (!CheckInputs(tx, state, view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true, false, txdata))
+        if (!fSkipScriptChecks && !CheckInputs(tx, state, view, true, STANDARD_SCRIPT_VERIFY_FLAGS, true, false, txdata))
             return false; // state filled in by CheckInputs
 
         // Check again against the current block tip's script verification
@@ -918,7 +925,7 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         // invalid blocks (using TestBlockValidity), however allowing such
         // transactions into the mempool can be exploited as a DoS attack.
         unsigned int currentBlockScriptVerifyFlags = GetBlockScriptFlags(chainActive.Tip(), chainparams.GetConsensus());
-        if (!CheckInputsFromMempoolAndCache(tx, state, view, pool, currentBlockScriptVerifyFlags, true, txdata)) {
+        if (!fSkipScriptChecks && !CheckInputsFromMempoolAndCache(tx, state, view, pool, currentBlockScriptVerifyFlags, true, txdata)) {
             return error("%s: BUG! PLEASE REPORT THIS! CheckInputs failed against latest-block but not STANDARD flags %s, %s",
                     __func__, hash.ToString(), FormatStateMessage(state));
         }
@@ -959,10 +966,10 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
 /** (try to) add transaction to memory pool with a specified acceptance time **/
 static bool AcceptToMemoryPoolWithTime(const CChainParams& chainparams, CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx,
                         bool* pfMissingInputs, int64_t nAcceptTime, bool bypass_limits,
-                        const CAmount nAbsurdFee, bool fDryRun)
+                        const CAmount nAbsurdFee, bool fDryRun, bool fSkipScriptChecks)
 {
     std::vector<COutPoint> coins_to_uncache;
-    bool res = AcceptToMemoryPoolWorker(chainparams, pool, state, tx, pfMissingInputs, nAcceptTime, bypass_limits, nAbsurdFee, coins_to_uncache, fDryRun);
+    bool res = AcceptToMemoryPoolWorker(chainparams, pool, state, tx, pfMissingInputs, nAcceptTime, bypass_limits, nAbsurdFee, coins_to_uncache, fDryRun, fSkipScriptChecks);
     if (!res || fDryRun) {
         if(!res) LogPrint(BCLog::MEMPOOL, "%s: %s %s (%s)\n", __func__, tx->GetHash().ToString(), state.GetRejectReason(), state.GetDebugMessage());
         for (const COutPoint& hashTx : coins_to_uncache)
@@ -1880,6 +1887,219 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+static CCriticalSection cs_preVerifiedTxs;
+static unordered_lru_cache<uint256, bool, StaticSaltedHasher, 8192> preVerifiedTxs GUARDED_BY(cs_preVerifiedTxs);
+
+bool IsTransactionPreVerified(const uint256& txid)
+{
+    LOCK(cs_preVerifiedTxs);
+    return preVerifiedTxs.exists(txid);
+}
+
+size_t PreVerifyTransactions(CTxMemPool& pool, const std::vector<CTransactionRef>& txs)
+{
+    if (!nScriptCheckThreads) {
+        return 0;
+    }
+
+    int64_t nTimeStart = GetTimeMicros();
+
+    // Spent outputs of the transactions to verify. The remaining steps don't need any locks, so everything they need
+    // is copied out here.
+    std::vector<CTransactionRef> vTxs;
+    std::vector<std::vector<CTxOut>> vSpentOutputs;
+    std::vector<COutPoint> coinsToUncache;
+    size_t nChecks = 0;
+    {
+        LOCK2(cs_main, pool.cs);
+        CCoinsViewMemPool viewMemPool(pcoinsTip.get(), pool);
+        CCoinsViewCache view(&viewMemPool);
+
+        for (const auto& ptx : txs) {
+            const CTransaction& tx = *ptx;
+            {
+                LOCK(cs_preVerifiedTxs);
+                if (preVerifiedTxs.exists(tx.GetHash())) {
+                    continue;
+                }
+                preVerifiedTxs.insert(tx.GetHash(), true);
+            }
+
+            CValidationState state;
+            std::string reason;
+            if (tx.IsCoinBase() || pool.exists(tx.GetHash()) || !CheckTransaction(tx, state) ||
+                (fRequireStandard && !IsStandardTx(tx, reason))) {
+                continue;
+            }
+
+            std::vector<CTxOut> spentOutputs;
+            std::vector<COutPoint> txCoinsToUncache;
+            CAmount nValueIn = 0;
+            for (const CTxIn& txin : tx.vin) {
+                if (!pcoinsTip->HaveCoinInCache(txin.prevout)) {
+                    txCoinsToUncache.emplace_back(txin.prevout);
+                }
+                const Coin& coin = view.AccessCoin(txin.prevout);
+                if (coin.IsSpent()) {
+                    break;
+                }
+                spentOutputs.emplace_back(coin.out);
+                nValueIn += coin.out.nValue;
+            }
+            unsigned int nSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+            if (spentOutputs.size() != tx.vin.size() || !MoneyRange(nValueIn) || nValueIn < tx.GetValueOut() ||
+                nValueIn - tx.GetValueOut() < ::minRelayTxFee.GetFee(nSize) ||
+                (fRequireStandard && !AreInputsStandard(tx, view))) {
+                // don't let transactions we won't accept anyway keep coins in our cache
+                for (const COutPoint& outpoint : txCoinsToUncache) {
+                    pcoinsTip->Uncache(outpoint);
+                }
+                continue;
+            }
+
+            nChecks += spentOutputs.size();
+            coinsToUncache.insert(coinsToUncache.end(), txCoinsToUncache.begin(), txCoinsToUncache.end());
+            vTxs.emplace_back(ptx);
+            vSpentOutputs.emplace_back(std::move(spentOutputs));
+        }
+    }
+
+    // A single input isn't worth the overhead, AcceptToMemoryPool will verify it anyway
+    if (nChecks < 2) {
+        return 0;
+    }
+
+    int64_t nTimeCollect = GetTimeMicros();
+
+    std::vector<PrecomputedTransactionData> vTxData;
+    vTxData.reserve(vTxs.size());
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    for (size_t i = 0; i < vTxs.size(); i++) {
+        const CTransaction& tx = *vTxs[i];
+        vTxData.emplace_back(tx);
+        std::vector<CScriptCheck> vChecks;
+        vChecks.reserve(tx.vin.size());
+        for (unsigned int j = 0; j < tx.vin.size(); j++) {
+            vChecks.emplace_back(vSpentOutputs[i][j], tx, j, STANDARD_SCRIPT_VERIFY_FLAGS, true /* cacheStore */, &vTxData.back());
+        }
+        control.Add(vChecks);
+    }
+    bool fValid = control.Wait();
+
+    if (!fValid) {
+        // Somebody sent us garbage. Don't let it keep coins in our cache, AcceptToMemoryPool will sort out which
+        // transactions were actually invalid.
+        LOCK(cs_main);
+        for (const COutPoint& outpoint : coinsToUncache) {
+            pcoinsTip->Uncache(outpoint);
+        }
+    }
+
+    int64_t nTimeEnd = GetTimeMicros();
+    LogPrint(BCLog::BENCHMARK, "%s: %u txs, %u inputs, valid=%d: collect %.2fms, verify %.2fms\n", __func__,
+             vTxs.size(), nChecks, fValid, 0.001 * (nTimeCollect - nTimeStart), 0.001 * (nTimeEnd - nTimeCollect));
+
+    return vTxs.size();
+}
+
+/**
+ * Closure reading a run of consecutive outpoints from the UTXO database, see PrefetchBlockCoins.
+ */
+class CCoinsPrefetchCheck
+{
+private:
+    const CCoinsView* pbase;
+    const COutPoint* poutpoints;
+    Coin* pcoins;
+    uint8_t* pfound;
+    size_t nCount;
+
+public:
+    CCoinsPrefetchCheck(): pbase(nullptr), poutpoints(nullptr), pcoins(nullptr), pfound(nullptr), nCount(0) {}
+    CCoinsPrefetchCheck(const CCoinsView& base, const COutPoint* poutpointsIn, Coin* pcoinsIn, uint8_t* pfoundIn, size_t nCountIn) :
+        pbase(&base), poutpoints(poutpointsIn), pcoins(pcoinsIn), pfound(pfoundIn), nCount(nCountIn) {}
+
+    bool operator()()
+    {
+        for (size_t i = 0; i < nCount; i++) {
+            try {
+                pfound[i] = pbase->GetCoin(poutpoints[i], pcoins[i]);
+            } catch (const std::exception&) {
+                // leave read errors to the regular (serial) code path, which knows how to handle them
+                pfound[i] = false;
+            }
+        }
+        return true;
+    }
+
+    void swap(CCoinsPrefetchCheck& check)
+    {
+        std::swap(pbase, check.pbase);
+        std::swap(poutpoints, check.poutpoints);
+        std::swap(pcoins, check.pcoins);
+        std::swap(pfound, check.pfound);
+        std::swap(nCount, check.nCount);
+    }
+};
+
+/** Number of outpoints read by a single CCoinsPrefetchCheck */
+static const size_t COINS_PREFETCH_BATCH_SIZE = 8;
+
+static CCheckQueue<CCoinsPrefetchCheck> coinsprefetchqueue(4);
+
+void ThreadCoinsPrefetch() {
+    RenameThread("zenx-coinpref");
+    coinsprefetchqueue.Thread();
+}
+
+size_t PrefetchBlockCoins(const CBlock& block, CCoinsViewCache& cache, const CCoinsView& base)
+{
+    // outputs created by the block itself can't be in the UTXO database yet
+    std::unordered_set<uint256, StaticSaltedHasher> blockTxids;
+    blockTxids.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        blockTxids.emplace(tx->GetHash());
+    }
+
+    std::unordered_set<COutPoint, SaltedOutpointHasher> seen;
+    std::vector<COutPoint> outpoints;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) {
+            continue;
+        }
+        for (const auto& in : tx->vin) {
+            if (blockTxids.count(in.prevout.hash) || cache.HaveCoinInCache(in.prevout) || !seen.emplace(in.prevout).second) {
+                continue;
+            }
+            outpoints.emplace_back(in.prevout);
+        }
+    }
+    if (outpoints.empty()) {
+        return 0;
+    }
+
+    std::vector<Coin> coins(outpoints.size());
+    std::vector<uint8_t> found(outpoints.size(), 0);
+    {
+        CCheckQueueControl<CCoinsPrefetchCheck> control(&coinsprefetchqueue);
+        std::vector<CCoinsPrefetchCheck> checks;
+        for (size_t i = 0; i < outpoints.size(); i += COINS_PREFETCH_BATCH_SIZE) {
+            size_t nCount = std::min(COINS_PREFETCH_BATCH_SIZE, outpoints.size() - i);
+            checks.emplace_back(base, &outpoints[i], &coins[i], &found[i], nCount);
+        }
+        control.Add(checks);
+        control.Wait();
+    }
+
+    size_t nFetched = 0;
+    for (size_t i = 0; i < outpoints.size(); i++) {
+        if (found[i] && cache.AddFetchedCoin(outpoints[i], std::move(coins[i]))) {
+            nFetched++;
+        }
+    }
+    return nFetched;
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2425,11 +2645,54 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     return true;
 }
 
+static CCoinsFlushStats coinsFlushStats; // Protected by cs_main
+
+CCoinsFlushStats GetCoinsFlushStats()
+{
+    LOCK(cs_main);
+    return coinsFlushStats;
+}
+
+static void UpdateCoinsFlushStats(uint64_t& nCounter, size_t nWritten, int64_t nTime)
+{
+    nCounter++;
+    coinsFlushStats.nCoinsWritten += nWritten;
+    coinsFlushStats.nLastCoinsWritten = nWritten;
+    coinsFlushStats.nTotalTime += nTime;
+    coinsFlushStats.nMaxTime = std::max(coinsFlushStats.nMaxTime, nTime);
+    coinsFlushStats.nLastTime = nTime;
+}
+
+/**
+ * A crash after partial writes to the coins database is recovered from by rolling forward from the last fully
+ * written block (see ReplayBlocks), which only works as long as it and the block of the last partial write are on
+ * the active chain.
+ */
+static bool CoinsDBIsOnActiveChain()
+{
+    AssertLockHeld(cs_main);
+    std::vector<uint256> hashes = pcoinsdbview->GetHeadBlocks();
+    if (hashes.empty()) {
+        hashes.emplace_back(pcoinsdbview->GetBestBlock());
+    }
+    for (const auto& hash : hashes) {
+        BlockMap::const_iterator it = mapBlockIndex.find(hash);
+        if (it == mapBlockIndex.end() || !chainActive.Contains(it->second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /**
  * Update the on-disk chain state.
  * The caches and indexes are flushed depending on the mode we're called with
  * if they're too large, if it's been a while since the last write,
  * or always and in all cases if we're in prune mode and are deleting files.
+ *
+ * Modified coins are written in batches of COINS_FLUSH_BATCH_ENTRIES. Once the coins cache fills up, they are also
+ * written out a batch at a time between blocks (partial flushes), so that the full flush has less to do. Unless
+ * the cache is too large, it keeps its entries after being written.
  */
 bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &state, FlushStateMode mode, int nManualPruneHeight) {
     int64_t nMempoolUsage = mempool.DynamicMemoryUsage();
@@ -2437,6 +2700,7 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
     static int64_t nLastWrite = 0;
     static int64_t nLastFlush = 0;
     static int64_t nLastSetChain = 0;
+    static int64_t nLastPartialFlush = 0;
     std::set<int> setFilesToPrune;
     bool fFlushForPrune = false;
     bool fDoFullFlush = false;
@@ -2482,10 +2746,23 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
         bool fPeriodicWrite = mode == FLUSH_STATE_PERIODIC && nNow > nLastWrite + (int64_t)DATABASE_WRITE_INTERVAL * 1000000;
         // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
         bool fPeriodicFlush = mode == FLUSH_STATE_PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
+        // The cache is filling up, write some of the modified coins now so that the full flush has less to do.
+        bool fPartialFlush = false;
+        // A reorg went past partially written blocks, which a crash couldn't be recovered from.
+        bool fPartialFlushStale = false;
+        if (mode == FLUSH_STATE_PERIODIC && nNow > nLastPartialFlush + (int64_t)COINS_PARTIAL_FLUSH_INTERVAL * 1000000) {
+            nLastPartialFlush = nNow;
+            if (CoinsDBIsOnActiveChain()) {
+                fPartialFlush = cacheSize > nTotalSpace * COINS_PARTIAL_FLUSH_THRESHOLD / 100;
+            } else {
+                fPartialFlushStale = !pcoinsdbview->GetHeadBlocks().empty();
+            }
+        }
         // Combine all conditions that result in a full cache flush.
-        fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
+        fDoFullFlush = (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune || fPartialFlushStale;
+        fPartialFlush = fPartialFlush && !fDoFullFlush;
         // Write blocks and block index to disk.
-        if (fDoFullFlush || fPeriodicWrite) {
+        if (fDoFullFlush || fPeriodicWrite || fPartialFlush) {
             // Depend on nMinDiskSpace to ensure we can write block index
             if (!CheckDiskSpace(0))
                 return state.Error("out of disk space");
@@ -2523,13 +2800,30 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
             // overwrite one. Still, use a conservative safety factor of 2.
             if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
-            // Flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
+            // Flush the chainstate (which may refer to block index entries). The cache is only emptied if it has
+            // grown too large, otherwise it stays warm.
+            int64_t nFlushStart = GetTimeMicros();
+            bool fEmptyCache = fCacheLarge || fCacheCritical;
+            size_t nWritten;
+            if (!pcoinsTip->Sync(COINS_FLUSH_BATCH_ENTRIES, nWritten) || (fEmptyCache && !pcoinsTip->Flush()))
                 return AbortNode(state, "Failed to write to coin database");
         if (!evoDb->CommitRootTransaction()) {
             return AbortNode(state, "Failed to commit EvoDB");
         }
+            int64_t nFlushTime = GetTimeMicros() - nFlushStart;
+            UpdateCoinsFlushStats(fEmptyCache ? coinsFlushStats.nFullFlushes : coinsFlushStats.nSyncs, nWritten, nFlushTime);
+            LogPrint(BCLog::COINDB, "Wrote %u modified coins in %.2fms%s\n", nWritten, nFlushTime * MILLI, fEmptyCache ? ", emptied cache" : "");
             nLastFlush = nNow;
+        } else if (fPartialFlush && !pcoinsTip->GetBestBlock().IsNull()) {
+            if (!CheckDiskSpace(48 * 2 * 2 * COINS_FLUSH_BATCH_ENTRIES))
+                return state.Error("out of disk space");
+            int64_t nFlushStart = GetTimeMicros();
+            size_t nWritten;
+            if (!pcoinsTip->WriteDirtyEntries(COINS_FLUSH_BATCH_ENTRIES, nWritten))
+                return AbortNode(state, "Failed to write to coin database");
+            int64_t nFlushTime = GetTimeMicros() - nFlushStart;
+            UpdateCoinsFlushStats(coinsFlushStats.nPartialFlushes, nWritten, nFlushTime);
+            LogPrint(BCLog::COINDB, "Partial flush: wrote %u modified coins in %.2fms\n", nWritten, nFlushTime * MILLI);
         }
     }
     if (fDoFullFlush || ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000)) {
@@ -2617,6 +2911,8 @@ void static UpdateTip(const CBlockIndex *pindexNew, const CChainParams& chainPar
       DateTimeStrFormat("%Y-%m-%d %H:%M:%S", pindexNew->GetBlockTime()),
       GuessVerificationProgress(chainParams.TxData(), pindexNew), pcoinsTip->DynamicMemoryUsage() * (1.0 / (1<<20)), pcoinsTip->GetCacheSize());
     strMessage += strprintf(" evodb_cache=%.1fMiB", evoDb->GetMemoryUsage() * (1.0 / (1<<20)));
+    auto evoCacheStats = evoDb->GetObjectCacheStats();
+    strMessage += strprintf(" evodb_objcache=%.1fMiB(%d hits, %d misses)", evoCacheStats.memoryUsage * (1.0 / (1<<20)), evoCacheStats.hits, evoCacheStats.misses);
     if (!warningMessages.empty())
         strMessage += strprintf(" warning='%s'", boost::algorithm::join(warningMessages, ", "));
     LogPrintf("%s\n", strMessage);
@@ -2682,6 +2978,7 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -2777,6 +3074,13 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCHMARK, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    if (nScriptCheckThreads) {
+        // Fault the spent coins into pcoinsTip in parallel instead of one LevelDB read at a time in ConnectBlock
+        size_t nPrefetched = PrefetchBlockCoins(blockConnecting, *pcoinsTip, *pcoinsdbview);
+        int64_t nTimePrefetched = GetTimeMicros(); nTimePrefetch += nTimePrefetched - nTime2;
+        LogPrint(BCLog::BENCHMARK, "  - Prefetch coins: %.2fms (%u coins) [%.2fs]\n", (nTimePrefetched - nTime2) * MILLI, nPrefetched, nTimePrefetch * MICRO);
+        nTime2 = nTimePrefetched;
+    }
     {
         auto dbTx = evoDb->BeginTransaction();
 
@@ -3417,16 +3721,16 @@ static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos,
     return true;
 }
 
-static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
+static bool CheckBlockHeader(const CBlockHeader& block, const uint256& hash, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
 {
     // Check proof of work matches claimed amount
-    if (fCheckPOW && !CheckProofOfWork(block.GetHash(), block.nBits, block.nTime, consensusParams))
+    if (fCheckPOW && !CheckProofOfWork(hash, block.nBits, block.nTime, consensusParams))
         return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
 
     // Check DevNet
     if (!consensusParams.hashDevnetGenesisBlock.IsNull() &&
             block.hashPrevBlock == consensusParams.hashGenesisBlock &&
-            block.GetHash() != consensusParams.hashDevnetGenesisBlock) {
+            hash != consensusParams.hashDevnetGenesisBlock) {
         return state.DoS(100, error("CheckBlockHeader(): wrong devnet genesis"),
                          REJECT_INVALID, "devnet-genesis");
     }
@@ -3443,7 +3747,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
 
     // Check that the header is valid (particularly PoW).  This is mostly
     // redundant with the call in AcceptBlockHeader.
-    if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW))
+    if (!CheckBlockHeader(block, block.GetHash(), state, consensusParams, fCheckPOW))
         return false;
 
     // Check the merkle root.
@@ -3622,10 +3926,14 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
 }
 
 bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+{
+    return AcceptBlockHeader(block, block.GetHash(), state, chainparams, ppindex);
+}
+
+bool CChainState::AcceptBlockHeader(const CBlockHeader& block, const uint256& hash, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
-    uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = nullptr;
 
@@ -3642,7 +3950,7 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (!CheckBlockHeader(block, hash, state, chainparams.GetConsensus()))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -3699,15 +4007,98 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
     return true;
 }
 
+/**
+ * Closure representing the context-free checks of a run of consecutive headers:
+ * hashing them (several at a time, see GetBlockHeaderHashes) and CheckBlockHeader.
+ */
+class CHeaderCheck
+{
+private:
+    const CBlockHeader* pheaders;
+    uint256* phashes;
+    size_t nCount;
+    const Consensus::Params* pconsensusParams;
+
+public:
+    CHeaderCheck(): pheaders(nullptr), phashes(nullptr), nCount(0), pconsensusParams(nullptr) {}
+    CHeaderCheck(const CBlockHeader* pheadersIn, uint256* phashesIn, size_t nCountIn, const Consensus::Params& consensusParams) :
+        pheaders(pheadersIn), phashes(phashesIn), nCount(nCountIn), pconsensusParams(&consensusParams) {}
+
+    bool operator()()
+    {
+        GetBlockHeaderHashes(pheaders, nCount, phashes);
+        for (size_t i = 0; i < nCount; i++) {
+            CValidationState state;
+            if (!CheckBlockHeader(pheaders[i], phashes[i], state, *pconsensusParams)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void swap(CHeaderCheck& check)
+    {
+        std::swap(pheaders, check.pheaders);
+        std::swap(phashes, check.phashes);
+        std::swap(nCount, check.nCount);
+        std::swap(pconsensusParams, check.pconsensusParams);
+    }
+};
+
+/** Number of headers handled by a single CHeaderCheck, matching the X11 lane count */
+static const size_t HEADER_CHECK_BATCH_SIZE = 8;
+
+static CCheckQueue<CHeaderCheck> headercheckqueue(4);
+
+void ThreadHeaderCheck() {
+    RenameThread("zenx-headerch");
+    headercheckqueue.Thread();
+}
+
+/**
+ * Hash and run the context-free checks on a headers message, in parallel on the
+ * header check threads. Returns false if any header failed, in which case hashes
+ * may be incomplete.
+ */
+static bool CheckBlockHeaders(const std::vector<CBlockHeader>& headers, std::vector<uint256>& hashes, const Consensus::Params& consensusParams)
+{
+    hashes.resize(headers.size());
+    std::vector<CHeaderCheck> vChecks;
+    vChecks.reserve((headers.size() + HEADER_CHECK_BATCH_SIZE - 1) / HEADER_CHECK_BATCH_SIZE);
+    for (size_t i = 0; i < headers.size(); i += HEADER_CHECK_BATCH_SIZE) {
+        vChecks.emplace_back(&headers[i], &hashes[i], std::min(HEADER_CHECK_BATCH_SIZE, headers.size() - i), consensusParams);
+    }
+
+    if (nScriptCheckThreads == 0 || vChecks.size() < 2) {
+        for (CHeaderCheck& check : vChecks) {
+            if (!check()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    CCheckQueueControl<CHeaderCheck> control(&headercheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
     if (first_invalid != nullptr) first_invalid->SetNull();
+    // Do the expensive part (X11 and the PoW checks) outside of cs_main, so that
+    // only linking the headers into the block index is serialized. If a header
+    // failed, the serial pass below finds it again and reports it.
+    std::vector<uint256> hashes;
+    const bool fChecked = CheckBlockHeaders(headers, hashes, chainparams.GetConsensus());
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        for (size_t i = 0; i < headers.size(); i++) {
+            const CBlockHeader& header = headers[i];
+            const uint256 hash = fChecked ? hashes[i] : header.GetHash();
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!g_chainstate.AcceptBlockHeader(header, hash, state, chainparams, &pindex)) {
                 if (first_invalid) *first_invalid = header;
                 return false;
             }
@@ -4925,14 +5316,112 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
     return VersionBitsStateSinceHeight(chainActive.Tip(), params, pos, versionbitscache);
 }
 
-static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+static const uint64_t MEMPOOL_DUMP_VERSION_LEGACY = 1;
+/**
+ * Version 2 starts with the chain tip and script verification flags the mempool was valid for. It is followed by
+ * one length prefixed record per transaction (parents before children), carrying the state that was validated
+ * when the transaction was accepted. The records can be walked without parsing them, so the file is read through
+ * a memory mapping instead of being copied through a stream. The file ends with a SipHash of everything before it,
+ * keyed with the secret in MEMPOOL_DUMP_KEY_FILE. Scripts are only skipped when loading a file with a valid checksum
+ * and unchanged script flags, for all transactions if the tip is unchanged and otherwise for those which are
+ * InstantSend locked both in the file and on load.
+ */
+static const uint64_t MEMPOOL_DUMP_VERSION = 2;
+/** Name of the per-datadir file holding the secret the mempool dump checksum is keyed with */
+static const char* const MEMPOOL_DUMP_KEY_FILE = "mempool.key";
+
+struct CMempoolDumpEntry
+{
+    CTransactionRef tx;
+    int64_t nTime;
+    int64_t nFeeDelta;
+    CAmount nFee;
+    uint32_t nSigOpCount;
+    bool fInstantSendLocked;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(tx);
+        READWRITE(nTime);
+        READWRITE(nFeeDelta);
+        READWRITE(nFee);
+        READWRITE(nSigOpCount);
+        READWRITE(fInstantSendLocked);
+    }
+};
+
+/**
+ * Read the secret which keys the mempool dump checksum. If it doesn't exist (or can't be read) and fCreate is set,
+ * a new one is generated, which invalidates the checksums of all earlier dumps.
+ */
+static bool GetMempoolDumpKey(uint64_t& k0, uint64_t& k1, bool fCreate)
+{
+    const fs::path path = GetDataDir() / MEMPOOL_DUMP_KEY_FILE;
+    {
+        CAutoFile filein(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        if (!filein.IsNull()) {
+            try {
+                filein >> k0 >> k1;
+                return true;
+            } catch (const std::exception&) {
+                LogPrintf("%s: failed to read %s\n", __func__, path.string());
+            }
+        }
+    }
+    if (!fCreate) {
+        return false;
+    }
+
+    GetRandBytes((unsigned char*)&k0, sizeof(k0));
+    GetRandBytes((unsigned char*)&k1, sizeof(k1));
+    const fs::path pathTmp = GetDataDir() / (std::string(MEMPOOL_DUMP_KEY_FILE) + ".new");
+    CAutoFile fileout(fsbridge::fopen(pathTmp, "wb"), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull()) {
+        return false;
+    }
+    fileout << k0 << k1;
+    FileCommit(fileout.Get());
+    fileout.fclose();
+    return RenameOver(pathTmp, path);
+}
+
+/** Writes to a file and keeps a keyed SipHash of everything written, see MEMPOOL_DUMP_VERSION */
+class CMempoolDumpWriter
+{
+private:
+    CAutoFile& file;
+    CSipHasher hasher;
+
+public:
+    CMempoolDumpWriter(CAutoFile& fileIn, uint64_t k0, uint64_t k1) : file(fileIn), hasher(k0, k1) {}
+
+    int GetType() const { return file.GetType(); }
+    int GetVersion() const { return file.GetVersion(); }
+
+    void write(const char* pch, size_t nSize)
+    {
+        file.write(pch, nSize);
+        hasher.Write((const unsigned char*)pch, nSize);
+    }
+
+    template<typename T>
+    CMempoolDumpWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return *this;
+    }
+
+    uint64_t GetChecksum() const { return hasher.Finalize(); }
+};
 
 bool LoadMempool(void)
 {
     const CChainParams& chainparams = Params();
     int64_t nExpiryTimeout = gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60;
-    FILE* filestr = fsbridge::fopen(GetDataDir() / "mempool.dat", "rb");
-    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    CMappedFile file(GetDataDir() / "mempool.dat");
     if (file.IsNull()) {
         LogPrintf("Failed to open mempool file from disk. Continuing anyway.\n");
         return false;
@@ -4942,54 +5431,146 @@ bool LoadMempool(void)
     int64_t expired = 0;
     int64_t failed = 0;
     int64_t already_there = 0;
+    int64_t trusted = 0;
+    int64_t islocked = 0;
     int64_t nNow = GetTime();
+    int64_t nStart = GetTimeMicros();
+
+    auto acceptTx = [&](const CTransactionRef& tx, int64_t nTime, int64_t nFeeDelta, bool fSkipScriptChecks) {
+        CAmount amountdelta = nFeeDelta;
+        if (amountdelta) {
+            mempool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+        }
+        CValidationState state;
+        if (nTime + nExpiryTimeout > nNow) {
+            LOCK(cs_main);
+            AcceptToMemoryPoolWithTime(chainparams, mempool, state, tx, nullptr /* pfMissingInputs */, nTime,
+                                       false /* bypass_limits */, 0 /* nAbsurdFee */, false /* fDryRun */, fSkipScriptChecks);
+            if (state.IsValid()) {
+                ++count;
+                return true;
+            }
+            // mempool may contain the transaction already, e.g. from
+            // wallet(s) having loaded it while we were processing
+            // mempool transactions; consider these as valid, instead of
+            // failed, but mark them as 'already there'
+            if (mempool.exists(tx->GetHash())) {
+                ++already_there;
+            } else {
+                ++failed;
+            }
+        } else {
+            ++expired;
+        }
+        return false;
+    };
 
     try {
-        uint64_t version;
-        file >> version;
-        if (version != MEMPOOL_DUMP_VERSION) {
-            return false;
+        // Only a version 2 file carrying a valid checksum was written by this node
+        const unsigned char* pend = file.end();
+        bool fChecksumValid = false;
+        if (file.size() >= 2 * sizeof(uint64_t) && ReadLE64(file.begin()) == MEMPOOL_DUMP_VERSION) {
+            pend -= sizeof(uint64_t);
+            uint64_t k0, k1;
+            fChecksumValid = GetMempoolDumpKey(k0, k1, false) &&
+                             CSipHasher(k0, k1).Write(file.begin(), pend - file.begin()).Finalize() == ReadLE64(pend);
         }
-        uint64_t num;
-        file >> num;
-        while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
-            if (amountdelta) {
-                mempool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+
+        CSpanReader stream(SER_DISK, CLIENT_VERSION, file.begin(), pend);
+        uint64_t version;
+        stream >> version;
+        if (version == MEMPOOL_DUMP_VERSION_LEGACY) {
+            uint64_t num;
+            stream >> num;
+            while (num--) {
+                CTransactionRef tx;
+                int64_t nTime;
+                int64_t nFeeDelta;
+                stream >> tx;
+                stream >> nTime;
+                stream >> nFeeDelta;
+                acceptTx(tx, nTime, nFeeDelta, false);
+                if (ShutdownRequested())
+                    return false;
             }
-            CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
+        } else if (version == MEMPOOL_DUMP_VERSION) {
+            uint256 hashTip;
+            uint32_t nStandardFlags;
+            uint32_t nBlockFlags;
+            uint64_t num;
+            stream >> hashTip >> nStandardFlags >> nBlockFlags >> num;
+
+            // All scripts were verified against this tip with these flags already, and as the transactions are
+            // loaded in the same order, each of them spends exactly the same coins as back then
+            bool fTrusted;
+            bool fTipMatches;
+            {
                 LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, mempool, state, tx, nullptr /* pfMissingInputs */, nTime,
-                                           false /* bypass_limits */, 0 /* nAbsurdFee */);
-                if (state.IsValid()) {
-                    ++count;
-                } else {
-                    // mempool may contain the transaction already, e.g. from
-                    // wallet(s) having loaded it while we were processing
-                    // mempool transactions; consider these as valid, instead of
-                    // failed, but mark them as 'already there'
-                    if (mempool.exists(tx->GetHash())) {
-                        ++already_there;
-                    } else {
-                        ++failed;
+                fTrusted = fChecksumValid && chainActive.Tip() != nullptr &&
+                           nStandardFlags == STANDARD_SCRIPT_VERIFY_FLAGS &&
+                           nBlockFlags == GetBlockScriptFlags(chainActive.Tip(), chainparams.GetConsensus());
+                fTipMatches = chainActive.Tip() != nullptr && chainActive.Tip()->GetBlockHash() == hashTip;
+            }
+            LogPrintf("Loading mempool dump of %u transactions for block %s, %s\n", num, hashTip.ToString(),
+                      !fChecksumValid ? "checksum invalid, verifying all scripts" :
+                      !fTrusted ? "script flags changed, verifying all scripts" :
+                      fTipMatches ? "skipping script verification" :
+                      "tip changed, only skipping script verification of InstantSend locked transactions");
+
+            // Entries accepted without script verification so far. They are verified after all if a later entry
+            // shows that the file doesn't match the current chain state.
+            std::vector<CMempoolDumpEntry> vTrustedEntries;
+
+            while (num--) {
+                uint32_t nRecordSize;
+                stream >> nRecordSize;
+                if (nRecordSize > stream.size()) {
+                    throw std::ios_base::failure("truncated mempool record");
+                }
+                CSpanReader record(SER_DISK, CLIENT_VERSION, stream.data(), stream.data() + nRecordSize);
+                stream.ignore(nRecordSize);
+
+                CMempoolDumpEntry entry;
+                record >> entry;
+                // The inputs of a transaction which is still InstantSend locked can't have been spent by anything
+                // else since the dump, so its scripts are still valid with unchanged flags even if the tip moved
+                bool fLocked = entry.fInstantSendLocked && llmq::quorumInstantSendManager &&
+                               llmq::quorumInstantSendManager->IsLocked(entry.tx->GetHash());
+                if (fLocked) {
+                    ++islocked;
+                }
+                bool fSkipScripts = fTrusted && (fTipMatches || fLocked);
+                if (acceptTx(entry.tx, entry.nTime, entry.nFeeDelta, fSkipScripts) && fSkipScripts) {
+                    ++trusted;
+                    vTrustedEntries.emplace_back(entry);
+                    // A different fee or sigop count means that different coins were spent. Don't trust this
+                    // transaction, the ones before it and the rest of the file any longer. The transactions accepted
+                    // so far are evicted (children first) and accepted again with full verification.
+                    TxMempoolInfo info = mempool.info(entry.tx->GetHash());
+                    if (info.nFee != entry.nFee || info.nSigOpCount != entry.nSigOpCount) {
+                        LogPrintf("%s: state of %s does not match the mempool dump, verifying all %d loaded and remaining scripts\n",
+                                  __func__, entry.tx->GetHash().ToString(), vTrustedEntries.size());
+                        fTrusted = false;
+                        for (auto it = vTrustedEntries.rbegin(); it != vTrustedEntries.rend(); ++it) {
+                            mempool.removeRecursive(*it->tx);
+                        }
+                        count -= trusted;
+                        trusted = 0;
+                        for (const auto& trustedEntry : vTrustedEntries) {
+                            // the fee delta is still known to the mempool
+                            acceptTx(trustedEntry.tx, trustedEntry.nTime, 0, false);
+                        }
+                        vTrustedEntries.clear();
                     }
                 }
-            } else {
-                ++expired;
+                if (ShutdownRequested())
+                    return false;
             }
-            if (ShutdownRequested())
-                return false;
+        } else {
+            return false;
         }
         std::map<uint256, CAmount> mapDeltas;
-        file >> mapDeltas;
+        stream >> mapDeltas;
 
         for (const auto& i : mapDeltas) {
             mempool.PrioritiseTransaction(i.first, i.second);
@@ -4999,7 +5580,8 @@ bool LoadMempool(void)
         return false;
     }
 
-    LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there\n", count, failed, expired, already_there);
+    LogPrintf("Imported mempool transactions from disk in %.2fs: %i succeeded (%i without script verification, %i InstantSend locked), %i failed, %i expired, %i already there\n",
+              (GetTimeMicros() - nStart) * MICRO, count, trusted, islocked, failed, expired, already_there);
     return true;
 }
 
@@ -5009,9 +5591,15 @@ bool DumpMempool(void)
 
     std::map<uint256, CAmount> mapDeltas;
     std::vector<TxMempoolInfo> vinfo;
+    uint256 hashTip;
+    uint32_t nBlockFlags = 0;
 
     {
-        LOCK(mempool.cs);
+        LOCK2(cs_main, mempool.cs);
+        if (chainActive.Tip()) {
+            hashTip = chainActive.Tip()->GetBlockHash();
+            nBlockFlags = GetBlockScriptFlags(chainActive.Tip(), Params().GetConsensus());
+        }
         for (const auto &i : mempool.mapDeltas) {
             mapDeltas[i.first] = i.second;
         }
@@ -5021,27 +5609,48 @@ bool DumpMempool(void)
     int64_t mid = GetTimeMicros();
 
     try {
+        uint64_t k0, k1;
+        if (!GetMempoolDumpKey(k0, k1, true)) {
+            LogPrintf("Failed to create %s\n", MEMPOOL_DUMP_KEY_FILE);
+            return false;
+        }
+
         FILE* filestr = fsbridge::fopen(GetDataDir() / "mempool.dat.new", "wb");
         if (!filestr) {
             return false;
         }
 
-        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        CAutoFile fileout(filestr, SER_DISK, CLIENT_VERSION);
+        CMempoolDumpWriter file(fileout, k0, k1);
 
         uint64_t version = MEMPOOL_DUMP_VERSION;
         file << version;
+        file << hashTip;
+        file << (uint32_t)STANDARD_SCRIPT_VERIFY_FLAGS;
+        file << nBlockFlags;
 
         file << (uint64_t)vinfo.size();
+        std::vector<unsigned char> vRecord;
         for (const auto& i : vinfo) {
-            file << *(i.tx);
-            file << (int64_t)i.nTime;
-            file << (int64_t)i.nFeeDelta;
+            CMempoolDumpEntry entry;
+            entry.tx = i.tx;
+            entry.nTime = i.nTime;
+            entry.nFeeDelta = i.nFeeDelta;
+            entry.nFee = i.nFee;
+            entry.nSigOpCount = i.nSigOpCount;
+            entry.fInstantSendLocked = llmq::quorumInstantSendManager && llmq::quorumInstantSendManager->IsLocked(i.tx->GetHash());
+
+            vRecord.clear();
+            CVectorWriter(SER_DISK, CLIENT_VERSION, vRecord, 0, entry);
+            file << (uint32_t)vRecord.size();
+            file.write((const char*)vRecord.data(), vRecord.size());
             mapDeltas.erase(i.tx->GetHash());
         }
 
         file << mapDeltas;
-        FileCommit(file.Get());
-        file.fclose();
+        fileout << file.GetChecksum();
+        FileCommit(fileout.Get());
+        fileout.fclose();
         RenameOver(GetDataDir() / "mempool.dat.new", GetDataDir() / "mempool.dat");
         int64_t last = GetTimeMicros();
         LogPrintf("Dumped mempool: %gs to copy, %gs to dump\n", (mid-start)*MICRO, (last-mid)*MICRO);
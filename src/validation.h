@@ -67,6 +67,8 @@ static const CAmount DEFAULT_TRANSACTION_MAXFEE = 0.1 * COIN;
 static const CAmount HIGH_TX_FEE_PER_KB = 0.01 * COIN;
 //! -maxtxfee will warn if called with a higher fee than this amount (in duffs)
 static const CAmount HIGH_MAX_TX_FEE = 100 * HIGH_TX_FEE_PER_KB;
+/** Maximum number of queued transactions of a peer which are pre-verified together, see PreVerifyTransactions */
+static const unsigned int MAX_TX_PREVERIFY_BATCH = 32;
 /** Default for -limitancestorcount, max number of in-mempool ancestors */
 static const unsigned int DEFAULT_ANCESTOR_LIMIT = 25;
 /** Default for -limitancestorsize, maximum kilobytes of tx + all in-mempool ancestors */
@@ -111,6 +113,12 @@ static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
 /** Time to wait (in seconds) between flushing chainstate to disk. */
 static const unsigned int DATABASE_FLUSH_INTERVAL = 24 * 60 * 60;
+/** Once the coins cache is this full (in percent of its limit), modified coins are written out between blocks. */
+static const int COINS_PARTIAL_FLUSH_THRESHOLD = 50;
+/** Time to wait (in seconds) between two partial flushes of the coins cache. */
+static const unsigned int COINS_PARTIAL_FLUSH_INTERVAL = 5;
+/** Maximum number of modified coins written in one go, by partial and full flushes. */
+static const size_t COINS_FLUSH_BATCH_ENTRIES = 100000;
 /** Maximum length of reject messages. */
 static const unsigned int MAX_REJECT_MESSAGE_LENGTH = 111;
 /** Block download timeout base, expressed in millionths of the block interval (i.e. 2.5 min) */
@@ -287,6 +295,16 @@ bool LoadChainTip(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the header checking thread */
+void ThreadHeaderCheck();
+/** Run an instance of the coins prefetching thread */
+void ThreadCoinsPrefetch();
+/**
+ * Read the coins spent by a block from base in parallel (on the coins prefetching threads) and add them to cache
+ * as unmodified entries. Outputs created by the block itself and coins already in cache are skipped. Returns the
+ * number of coins added.
+ */
+size_t PrefetchBlockCoins(const CBlock& block, CCoinsViewCache& cache, const CCoinsView& base);
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
@@ -316,6 +334,23 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune);
 
 /** Flush all state, indexes and buffers to disk. */
 void FlushStateToDisk();
+
+/** Statistics about writing the coins cache to the chainstate database, see FlushStateToDisk */
+struct CCoinsFlushStats
+{
+    //! Writes of the whole cache which emptied it (nFullFlushes) or kept it (nSyncs), and partial writes
+    uint64_t nFullFlushes{0};
+    uint64_t nSyncs{0};
+    uint64_t nPartialFlushes{0};
+    //! Modified coins written in total and by the last write
+    uint64_t nCoinsWritten{0};
+    uint64_t nLastCoinsWritten{0};
+    //! Time spent (in microseconds) in total, by the slowest and by the last write
+    int64_t nTotalTime{0};
+    int64_t nMaxTime{0};
+    int64_t nLastTime{0};
+};
+CCoinsFlushStats GetCoinsFlushStats();
 /** Prune block files and flush state to disk. */
 void PruneAndFlush();
 /** Prune block files up to a given height */
@@ -327,7 +362,16 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
                         const CAmount nAbsurdFee, bool fDryRun=false);
 static bool AcceptToMemoryPoolWithTime(const CChainParams& chainparams, CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx,
                                        bool* pfMissingInputs, int64_t nAcceptTime, bool bypass_limits,
-                                       const CAmount nAbsurdFee, bool fDryRun = false);
+                                       const CAmount nAbsurdFee, bool fDryRun = false, bool fSkipScriptChecks = false);
+/**
+ * Verify the scripts of a batch of relayed transactions in parallel on the script checking threads, without holding
+ * cs_main. This only warms the signature cache, so that the (serial) AcceptToMemoryPool calls which follow find
+ * the signatures already verified. Transactions which are obviously unacceptable (non-standard, missing inputs,
+ * insufficient fee) or were pre-verified recently are skipped. Returns the number of transactions verified.
+ */
+size_t PreVerifyTransactions(CTxMemPool& pool, const std::vector<CTransactionRef>& txs);
+/** Whether txid was handed to PreVerifyTransactions recently (successfully verified or not) */
+bool IsTransactionPreVerified(const uint256& txid);
 
 bool GetUTXOCoin(const COutPoint& outpoint, Coin& coin);
 int GetUTXOHeight(const COutPoint& outpoint);
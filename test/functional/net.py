@@ -21,6 +21,7 @@ class NetTest(BitcoinTestFramework):
     def set_test_params(self):
         self.setup_clean_chain = True
         self.num_nodes = 2
+        self.extra_args = [["-socketthreads=2"], ["-msghandthreads=0"]]
 
     def run_test(self):
         # Wait for one ping/pong to finish so that we can be sure that there is no chatter between nodes for some time
@@ -71,6 +72,8 @@ class NetTest(BitcoinTestFramework):
     def _test_getnetworkinginfo(self):
         assert_equal(self.nodes[0].getnetworkinfo()['networkactive'], True)
         assert_equal(self.nodes[0].getnetworkinfo()['connections'], 2)
+        assert_equal(len(self.nodes[0].getnetworkinfo()['msghandthreads']), 2)
+        assert_equal(len(self.nodes[1].getnetworkinfo()['msghandthreads']), 0)
 
         self.nodes[0].setnetworkactive(False)
         assert_equal(self.nodes[0].getnetworkinfo()['networkactive'], False)